@@ -0,0 +1,204 @@
+#include "BufferPool.h"
+
+#include <QMutexLocker>
+#include <QtMath>
+
+namespace
+{
+const qint64 defaultCapacity = 32 * 1024 * 1024;
+}
+
+BufferPool::Buffer::Buffer(Buffer &&other)
+    : pool(other.pool)
+    , bytes(other.bytes)
+    , bytesSize(other.bytesSize)
+{
+    other.pool = nullptr;
+    other.bytes = nullptr;
+    other.bytesSize = 0;
+}
+
+BufferPool::Buffer &BufferPool::Buffer::operator=(Buffer &&other)
+{
+    if (this != &other)
+    {
+        release();
+        pool = other.pool;
+        bytes = other.bytes;
+        bytesSize = other.bytesSize;
+        other.pool = nullptr;
+        other.bytes = nullptr;
+        other.bytesSize = 0;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer()
+{
+    release();
+}
+
+void BufferPool::Buffer::release()
+{
+    if (pool && bytes)
+    {
+        pool->giveBack(bytes, bytesSize);
+    }
+    pool = nullptr;
+    bytes = nullptr;
+    bytesSize = 0;
+}
+
+
+BufferPool::BufferPool(const qint64 capacity)
+    : capacityBytes(qMax<qint64>(1, capacity))
+{
+}
+
+BufferPool::~BufferPool()
+{
+    trim();
+}
+
+BufferPool &BufferPool::global()
+{
+    static BufferPool pool(defaultCapacity);
+    return pool;
+}
+
+void BufferPool::setCapacity(const qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    capacityBytes = qMax<qint64>(1, bytes);
+    released.wakeAll();
+}
+
+qint64 BufferPool::capacity() const
+{
+    QMutexLocker locker(&mutex);
+    return capacityBytes;
+}
+
+BufferPool::Buffer BufferPool::acquire(const qint64 size)
+{
+    const qint64 allocation = allocationSize(size);
+    QMutexLocker locker(&mutex);
+    while (!hasRoom(allocation))
+    {
+        released.wait(&mutex);
+    }
+    return take(allocation);
+}
+
+BufferPool::Buffer BufferPool::tryAcquire(const qint64 size)
+{
+    const qint64 allocation = allocationSize(size);
+    QMutexLocker locker(&mutex);
+    if (!hasRoom(allocation))
+    {
+        return Buffer();
+    }
+    return take(allocation);
+}
+
+qint64 BufferPool::inUse() const
+{
+    QMutexLocker locker(&mutex);
+    return usedBytes;
+}
+
+qint64 BufferPool::peakUsage() const
+{
+    QMutexLocker locker(&mutex);
+    return peakBytes;
+}
+
+void BufferPool::resetPeak()
+{
+    QMutexLocker locker(&mutex);
+    peakBytes = usedBytes;
+}
+
+void BufferPool::trim()
+{
+    QMutexLocker locker(&mutex);
+    for (auto &buffers : freeBuffers)
+    {
+        for (char *bytes : buffers)
+        {
+            qFreeAligned(bytes);
+        }
+        buffers.clear();
+    }
+    cachedBytes = 0;
+}
+
+qint64 BufferPool::allocationSize(const qint64 size)
+{
+    return qMax<qint64>(pageSize, static_cast<qint64>(qNextPowerOfTwo(static_cast<quint64>(qMax<qint64>(1, size) - 1))));
+}
+
+bool BufferPool::hasRoom(const qint64 allocation) const
+{
+    return usedBytes == 0 || usedBytes + allocation <= capacityBytes;
+}
+
+BufferPool::Buffer BufferPool::take(const qint64 allocation)
+{
+    Buffer buffer;
+    const int index = sizeClass(allocation);
+    if (index >= 0 && !freeBuffers[index].isEmpty())
+    {
+        buffer.bytes = freeBuffers[index].takeLast();
+        cachedBytes -= allocation;
+    }
+    else
+    {
+        // Buffers of other sizes kept for reuse make room for the new one
+        for (int i = classCount - 1; i >= 0 && usedBytes + cachedBytes + allocation > capacityBytes; --i)
+        {
+            while (!freeBuffers[i].isEmpty() && usedBytes + cachedBytes + allocation > capacityBytes)
+            {
+                qFreeAligned(freeBuffers[i].takeLast());
+                cachedBytes -= qint64(pageSize) << i;
+            }
+        }
+        buffer.bytes = static_cast<char *>(qMallocAligned(static_cast<size_t>(allocation), pageSize));
+        if (!buffer.bytes)
+        {
+            return Buffer();
+        }
+    }
+    buffer.pool = this;
+    buffer.bytesSize = allocation;
+    usedBytes += allocation;
+    peakBytes = qMax(peakBytes, usedBytes);
+    return buffer;
+}
+
+void BufferPool::giveBack(char *bytes, const qint64 allocation)
+{
+    QMutexLocker locker(&mutex);
+    usedBytes -= allocation;
+    const int index = sizeClass(allocation);
+    if (index >= 0 && usedBytes + cachedBytes + allocation <= capacityBytes)
+    {
+        freeBuffers[index].append(bytes);
+        cachedBytes += allocation;
+    }
+    else
+    {
+        qFreeAligned(bytes);
+    }
+    released.wakeAll();
+}
+
+int BufferPool::sizeClass(const qint64 allocation)
+{
+    int index = 0;
+    while (index < classCount && (qint64(pageSize) << index) < allocation)
+    {
+        ++index;
+    }
+    return index < classCount ? index : -1;
+}
@@ -0,0 +1,82 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+
+/// Read buffers shared by all hashing threads.
+/// Buffers are page aligned and rounded up to a power of two, released ones are kept for reuse,
+/// so a scan of many small files does not go through the allocator for every file.
+/// The buffers handed out stay within the capacity: acquire() waits for room,
+/// tryAcquire() gives the scheduler a null buffer instead, so it can hold files back.
+class BufferPool
+{
+public:
+    /// Owns one buffer of the pool and gives it back when destroyed
+    class Buffer
+    {
+        friend class BufferPool;
+
+        BufferPool *pool = nullptr;
+        char *bytes = nullptr;
+        qint64 bytesSize = 0;
+
+    public:
+        Buffer() = default;
+        Buffer(Buffer &&other);
+        Buffer &operator=(Buffer &&other);
+        ~Buffer();
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+        bool isNull() const { return bytes == nullptr; }
+        char *data() const { return bytes; }
+        /// At least the size asked for
+        qint64 size() const { return bytesSize; }
+        void release();
+    };
+
+    explicit BufferPool(const qint64 capacity);
+    ~BufferPool();
+
+    /// The pool all checksum calculators read through
+    static BufferPool &global();
+
+    void setCapacity(const qint64 bytes);
+    qint64 capacity() const;
+    /// Waits while the buffers in use leave no room, the first buffer is always granted
+    Buffer acquire(const qint64 size);
+    /// Null instead of waiting if there is no room
+    Buffer tryAcquire(const qint64 size);
+    qint64 inUse() const;
+    /// Most bytes in use at once since the last resetPeak()
+    qint64 peakUsage() const;
+    void resetPeak();
+    /// Frees the buffers kept for reuse
+    void trim();
+
+    /// Bytes taken from the capacity by a buffer of the given size
+    static qint64 allocationSize(const qint64 size);
+
+private:
+    /// Called with mutex held
+    bool hasRoom(const qint64 allocation) const;
+    Buffer take(const qint64 allocation);
+    void giveBack(char *bytes, const qint64 allocation);
+    static int sizeClass(const qint64 allocation);
+
+    static const int pageSize = 4096;
+    /// Size classes from one page up to 2^(12 + classCount - 1) bytes
+    static const int classCount = 20;
+
+    mutable QMutex mutex;
+    QWaitCondition released;
+    QVector<char *> freeBuffers[classCount];
+    qint64 capacityBytes;
+    qint64 usedBytes = 0;
+    qint64 cachedBytes = 0;
+    qint64 peakBytes = 0;
+};
+
+#endif // BUFFERPOOL_H
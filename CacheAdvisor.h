@@ -0,0 +1,176 @@
+#ifndef CACHEADVISOR_H
+#define CACHEADVISOR_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Keeps one sequential read of a file from filling the page cache, so a scan does not evict
+/// the working set of other programs: pages behind the read cursor are dropped
+/// (POSIX_FADV_DONTNEED) and a window ahead of it is requested (POSIX_FADV_WILLNEED).
+/// Pages that were cached when the file was opened are someone else's and stay,
+/// mincore() tells which they are. Only the pages the read brought in are dropped.
+/// Does nothing when disabled or where posix_fadvise is not available.
+class CacheAdvisor
+{
+    /// Dropping and prefetching in steps of this many bytes keeps the syscalls rare
+    static const qint64 stepSize = 8 * 1024 * 1024;
+    /// The file is mapped this much at a time to ask mincore() about it
+    static const qint64 residencyChunkSize = 64 * 1024 * 1024;
+
+    int fd;
+    qint64 pageSize = 4096;
+    qint64 fileSize = 0;
+    /// Page aligned, the pages before it are done with
+    qint64 dropped = 0;
+    qint64 prefetched = 0;
+    /// One bit per page, set for the pages cached at open. Empty when there were none
+    std::vector<bool> cached;
+
+public:
+    CacheAdvisor(const int fd, const bool enabled)
+        : fd(enabled ? fd : -1)
+    {
+#ifdef Q_OS_LINUX
+        if (this->fd >= 0)
+        {
+            pageSize = ::sysconf(_SC_PAGESIZE);
+            // Before anything is requested, or the pages read ahead would look cached
+            recordCachedPages();
+            ::posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            prefetch(0);
+        }
+#endif
+    }
+    ~CacheAdvisor() { finish(); }
+
+    /// Drops the rest of what the read brought in, must run before the file is closed
+    void finish()
+    {
+#ifdef Q_OS_LINUX
+        // Up to the end of the file, the kernel may have read ahead of the windows
+        if (fd >= 0)
+            drop(qMax(fileSize, prefetched) + pageSize - 1);
+#endif
+        fd = -1;
+    }
+
+    /// Called after the bytes up to position have been read
+    void advance(const qint64 position)
+    {
+#ifdef Q_OS_LINUX
+        if (fd < 0)
+        {
+            return;
+        }
+        if (position - dropped >= stepSize)
+        {
+            drop(position);
+        }
+        if (prefetched - position < stepSize)
+        {
+            prefetch(position);
+        }
+#else
+        Q_UNUSED(position)
+#endif
+    }
+
+private:
+    void prefetch(const qint64 position)
+    {
+#ifdef Q_OS_LINUX
+        const qint64 end = position + 2 * stepSize;
+        ::posix_fadvise(fd, qMax(prefetched, position), end - qMax(prefetched, position), POSIX_FADV_WILLNEED);
+        prefetched = end;
+#else
+        Q_UNUSED(position)
+#endif
+    }
+
+#ifdef Q_OS_LINUX
+    /// Fills cached from mincore(). Where the file can not be mapped every page counts as not cached
+    void recordCachedPages()
+    {
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+        {
+            return;
+        }
+        fileSize = info.st_size;
+        const qint64 pages = (fileSize + pageSize - 1) / pageSize;
+        std::vector<unsigned char> chunkPages(static_cast<size_t>(residencyChunkSize / pageSize));
+        for (qint64 offset = 0; offset < fileSize; offset += residencyChunkSize)
+        {
+            const size_t length = static_cast<size_t>(qMin(fileSize - offset, qint64(residencyChunkSize)));
+            void *map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, offset);
+            if (map == MAP_FAILED)
+            {
+                cached.clear();
+                return;
+            }
+            const bool ok = ::mincore(map, length, chunkPages.data()) == 0;
+            ::munmap(map, length);
+            if (!ok)
+            {
+                cached.clear();
+                return;
+            }
+            const qint64 firstPage = offset / pageSize;
+            const size_t chunkPageCount = (length + static_cast<size_t>(pageSize) - 1) / static_cast<size_t>(pageSize);
+            for (size_t page = 0; page < chunkPageCount; ++page)
+            {
+                if (!(chunkPages[page] & 1))
+                    continue;
+                if (cached.empty())
+                    cached.resize(static_cast<size_t>(pages), false);
+                cached[static_cast<size_t>(firstPage) + page] = true;
+            }
+        }
+    }
+
+    /// Drops the pages before position that were not cached at open, in runs.
+    /// The page position falls into is left for the next step
+    void drop(const qint64 position)
+    {
+        const qint64 pageEnd = position / pageSize * pageSize;
+        if (pageEnd <= dropped)
+        {
+            return;
+        }
+        if (cached.empty())
+        {
+            ::posix_fadvise(fd, dropped, pageEnd - dropped, POSIX_FADV_DONTNEED);
+            dropped = pageEnd;
+            return;
+        }
+        qint64 runStart = dropped;
+        for (qint64 offset = dropped; offset <= pageEnd; offset += pageSize)
+        {
+            const size_t page = static_cast<size_t>(offset / pageSize);
+            if (offset < pageEnd && (page >= cached.size() || !cached[page]))
+            {
+                continue;
+            }
+            if (offset > runStart)
+            {
+                ::posix_fadvise(fd, runStart, offset - runStart, POSIX_FADV_DONTNEED);
+            }
+            runStart = offset + pageSize;
+        }
+        dropped = pageEnd;
+    }
+#endif
+
+    CacheAdvisor(const CacheAdvisor &) = delete;
+    CacheAdvisor &operator=(const CacheAdvisor &) = delete;
+};
+
+#endif // CACHEADVISOR_H
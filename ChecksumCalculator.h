@@ -1,9 +1,19 @@
 #ifndef CHECKSUMCALCULATOR_H
 #define CHECKSUMCALCULATOR_H
 
+#include "ScanProfiler.h"
+#include "KernelHash.h"
+#include "Digest.h"
+#include "BufferPool.h"
+#include "CacheAdvisor.h"
+
 #include <QString>
 #include <QFile>
+#include <QScopedPointer>
 #include <QCryptographicHash>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QtEndian>
 
 class ChecksumCalculator
 {
@@ -21,13 +31,169 @@ public:
     virtual ~ChecksumCalculator() = default;
     virtual QString name() const = 0;
     virtual std::size_t maxLen() const = 0;
-    virtual QString calcChecksum(const QString &filePath) const = 0;
+
+    /// Hash files through the kernel crypto API (AF_ALG) instead of in user space.
+    /// Returns false and keeps the user-space backend where the kernel can not do it.
+    bool setKernelBackend(const bool enabled)
+    {
+        if (!enabled)
+        {
+            kernelHash.reset();
+            return true;
+        }
+        QSharedPointer<KernelHash> hash(new KernelHash(kernelAlgorithm(), kernelKey()));
+        if (!hash->isValid())
+        {
+            return false;
+        }
+        kernelHash = hash;
+        return true;
+    }
+    bool kernelBackend() const { return !kernelHash.isNull(); }
+
+    /// Drop the pages of a file from the page cache behind the read cursor, see CacheAdvisor
+    void setCachePolite(const bool enabled) { politeReads = enabled; }
+    bool cachePolite() const { return politeReads; }
+
+    /// Nanoseconds hashing filePath takes with the backend set, the best of rounds runs.
+    /// The kernel backend does not fall back to user space here, -1 if a backend can not hash the file.
+    /// digest receives the checksum, to check the backends against each other
+    qint64 benchmark(const QString &filePath, const int rounds, Digest *digest = nullptr) const
+    {
+        qint64 best = -1;
+        for (int i = 0; i < rounds; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            const Digest result = kernelHash ? kernelChecksum(filePath, nullptr) : userChecksum(filePath, nullptr);
+            if (result.isEmpty())
+            {
+                return -1;
+            }
+            const qint64 elapsed = timer.nsecsElapsed();
+            best = best < 0 ? elapsed : qMin(best, elapsed);
+            if (digest)
+                *digest = result;
+        }
+        return best;
+    }
+
+    /// Safe to call from several threads at once: all per-file state lives in a Hasher.
+    /// Reads through buffer if one is given, else through one of BufferPool::global().
+    Digest calcChecksum(const QString &filePath, ScanProfiler *profiler = nullptr,
+                        BufferPool::Buffer buffer = BufferPool::Buffer()) const
+    {
+        if (kernelHash)
+        {
+            const Digest digest = kernelChecksum(filePath, profiler);
+            if (!digest.isEmpty())
+            {
+                return digest;
+            }
+            // Files the kernel path can not read (e.g. no splice support) fall back to user space
+        }
+        return userChecksum(filePath, profiler, std::move(buffer));
+    }
+
+    /// Size of the read buffer calcChecksum() needs for a file of fileSize bytes.
+    /// +1 lets small files hit the end of file in a single read.
+    static qint64 bufferSize(const qint64 fileSize) { return qMin<qint64>(readChunkSize, fileSize + 1); }
+
+private:
+    Digest kernelChecksum(const QString &filePath, ScanProfiler *profiler) const
+    {
+        const QByteArray digest = kernelHash->hashFile(filePath, profiler, politeReads);
+        return digest.isEmpty() ? Digest() : kernelResult(digest);
+    }
+
+    Digest userChecksum(const QString &filePath, ScanProfiler *profiler,
+                        BufferPool::Buffer buffer = BufferPool::Buffer()) const
+    {
+        QFile f(filePath);
+        {
+            ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::OPEN);
+            if (!f.open(QFile::ReadOnly))
+            {
+                return Digest();
+            }
+        }
+
+        if (buffer.isNull())
+        {
+            buffer = BufferPool::global().acquire(bufferSize(f.size()));
+            if (buffer.isNull())
+            {
+                return Digest();
+            }
+        }
+        QScopedPointer<Hasher> hasher(createHasher());
+        CacheAdvisor cacheAdvisor(f.handle(), politeReads);
+        qint64 position = 0;
+        qint64 len = 0;
+        forever
+        {
+            {
+                ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::READ);
+                len = f.read(buffer.data(), qMin<qint64>(buffer.size(), readChunkSize));
+                scope.setBytes(qMax<qint64>(len, 0));
+            }
+            if (len <= 0)
+            {
+                break;
+            }
+            position += len;
+            cacheAdvisor.advance(position);
+            ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::HASH);
+            hasher->addData(buffer.data(), len);
+        }
+        cacheAdvisor.finish();
+        f.close();
+
+        if (len < 0)
+        {
+            return Digest();
+        }
+        ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::HASH);
+        return hasher->result();
+    }
+
+protected:
+    /// Running state of one checksum computation
+    class Hasher
+    {
+    public:
+        virtual ~Hasher() = default;
+        virtual void addData(const char *data, const qint64 len) = 0;
+        virtual Digest result() = 0;
+    };
+
+    class CryptographicHasher : public Hasher
+    {
+        QCryptographicHash hash;
+
+    public:
+        explicit CryptographicHasher(const QCryptographicHash::Algorithm algorithm) : hash(algorithm) {}
+        void addData(const char *data, const qint64 len) override { hash.addData(data, static_cast<int>(len)); }
+        Digest result() override { return Digest::fromBytes(hash.result()); }
+    };
+
+    virtual Hasher *createHasher() const = 0;
+
+    /// Kernel crypto API name of the algorithm, empty if there is none
+    virtual QByteArray kernelAlgorithm() const { return QByteArray(); }
+    virtual QByteArray kernelKey() const { return QByteArray(); }
+    /// Same digest as the Hasher result for the raw kernel digest
+    virtual Digest kernelResult(const QByteArray &digest) const { return Digest::fromBytes(digest); }
+
+private:
+    static const int readChunkSize = 1024 * 1024;
+    QSharedPointer<KernelHash> kernelHash;
+    bool politeReads = false;
 };
 
 
 class CRC32_ChecksumCalculator : public ChecksumCalculator
 {
-    const int minLen = 8;
     const quint32 CRC32Table[256] =
     {
         0x00000000, 0x77073096, 0xee0e612c, 0x990951ba,
@@ -96,37 +262,49 @@ class CRC32_ChecksumCalculator : public ChecksumCalculator
         0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
     };
 
+    class CRC32_Hasher : public Hasher
+    {
+        const quint32 *table;
+        quint32 crc32 = 0xffffffff;
+
+    public:
+        explicit CRC32_Hasher(const quint32 *table) : table(table) {}
+        void addData(const char *data, const qint64 len) override
+        {
+            const uchar *src = reinterpret_cast<const uchar *>(data);
+            for (qint64 i = 0; i < len; ++i)
+            {
+                crc32 = (crc32 >> 8) ^ table[(crc32 ^ src[i]) & 0xff];
+            }
+        }
+        Digest result() override { return toDigest(crc32 ^ 0xffffffff); }
+    };
+
+    /// Big-endian bytes, so the hex reads as the zero-padded upper-case number
+    static Digest toDigest(const quint32 crc32)
+    {
+        uchar bytes[4];
+        qToBigEndian(crc32, bytes);
+        return Digest::fromBytes(reinterpret_cast<const char *>(bytes), 4, true);
+    }
+
 public:
     CRC32_ChecksumCalculator() = default;
 
 private:
     QString name() const override { return "CRC32"; }
     std::size_t maxLen() const override { return 20; }
-
-    QString calcChecksum(const QString &filePath) const override
+    Hasher *createHasher() const override { return new CRC32_Hasher(CRC32Table); }
+    /// The kernel crc32 starts from the key and does not invert the result
+    QByteArray kernelAlgorithm() const override { return QByteArrayLiteral("crc32"); }
+    QByteArray kernelKey() const override { return QByteArrayLiteral("\xff\xff\xff\xff"); }
+    Digest kernelResult(const QByteArray &digest) const override
     {
-        QFile f(filePath);
-        if (!f.open(QFile::ReadOnly))
-        {
-            return QString();
-        }
-
-        quint32 crc32 = 0xffffffff;
-        while(!f.atEnd())
+        if (digest.size() != 4)
         {
-            QByteArray src = f.read(1024);
-            const quint32 sz = src.size();
-            for(quint32 i = 0; i < sz; ++i)
-            {
-                crc32 = (crc32 >> 8) ^ CRC32Table[(crc32 ^ src[i]) & 0xff];
-            }
+            return Digest();
         }
-        f.close();
-
-        crc32 ^= 0xffffffff;
-        const QString crc32Hex = QString::number(crc32, 16).toUpper();
-        return crc32Hex.length() < minLen ? crc32Hex.rightJustified(minLen, '0')
-                                          : crc32Hex;
+        return toDigest(qFromLittleEndian<quint32>(digest.constData()) ^ 0xffffffff);
     }
 };
 
@@ -139,24 +317,8 @@ public:
 
 private:
     QString name() const override { return "MD5"; }
-    QString calcChecksum(const QString &filePath) const override
-    {
-        auto data = QByteArray();
-        QFile f(filePath);
-        if (!f.open(QFile::ReadOnly))
-        {
-            return QString();
-        }
-
-        QCryptographicHash hash(QCryptographicHash::Md5);
-        if (hash.addData(&f))
-        {
-            data = hash.result().toHex();
-        }
-        f.close();
-
-        return data;
-    }
+    Hasher *createHasher() const override { return new CryptographicHasher(QCryptographicHash::Md5); }
+    QByteArray kernelAlgorithm() const override { return QByteArrayLiteral("md5"); }
 };
 
 
@@ -168,24 +330,8 @@ public:
 
 private:
     QString name() const override { return "SHA-1"; }
-    QString calcChecksum(const QString &filePath) const override
-    {
-        auto data = QByteArray();
-        QFile f(filePath);
-        if (!f.open(QFile::ReadOnly))
-        {
-            return QString();
-        }
-
-        QCryptographicHash hash(QCryptographicHash::Sha1);
-        if (hash.addData(&f))
-        {
-            data = hash.result().toHex();
-        }
-        f.close();
-
-        return data;
-    }
+    Hasher *createHasher() const override { return new CryptographicHasher(QCryptographicHash::Sha1); }
+    QByteArray kernelAlgorithm() const override { return QByteArrayLiteral("sha1"); }
 };
 
 #endif // CHECKSUMCALCULATOR_H
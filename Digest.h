@@ -0,0 +1,97 @@
+#ifndef DIGEST_H
+#define DIGEST_H
+
+#include <QString>
+#include <QByteArray>
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DIGEST_HEX_SSE2
+#endif
+
+/// Checksum kept as raw bytes instead of hex text: 22 bytes in place, no allocation.
+/// Hex is produced on demand, straight into the caller's buffer.
+struct Digest
+{
+    /// Longest digest of the calculators (SHA-1)
+    static const int maxSize = 20;
+
+    quint8 bytes[maxSize];
+    quint8 size = 0;
+    /// Hex case the checksum is shown in (CRC32 upper, the rest lower)
+    bool upperCase = false;
+
+    Digest() = default;
+
+    static Digest fromBytes(const char *data, const int len, const bool upperCase = false)
+    {
+        Digest digest;
+        digest.size = static_cast<quint8>(qBound(0, len, static_cast<int>(maxSize)));
+        digest.upperCase = upperCase;
+        std::memcpy(digest.bytes, data, digest.size);
+        return digest;
+    }
+    static Digest fromBytes(const QByteArray &data, const bool upperCase = false)
+    {
+        return fromBytes(data.constData(), data.size(), upperCase);
+    }
+
+    bool isEmpty() const { return size == 0; }
+    int hexSize() const { return size * 2; }
+
+    /// Writes hexSize() characters to dst
+    void toHex(char *dst) const { encodeHex(bytes, size, dst, upperCase); }
+    void toHex(char *dst, const bool upper) const { encodeHex(bytes, size, dst, upper); }
+    QString toHexString() const
+    {
+        char text[maxSize * 2];
+        toHex(text);
+        return QString::fromLatin1(text, hexSize());
+    }
+
+    bool operator==(const Digest &other) const
+    {
+        return size == other.size && std::memcmp(bytes, other.bytes, size) == 0;
+    }
+    bool operator!=(const Digest &other) const { return !(*this == other); }
+
+    static void encodeHex(const quint8 *src, int len, char *dst, const bool upper)
+    {
+        const char letterBase = upper ? 'A' : 'a';
+#ifdef DIGEST_HEX_SSE2
+        const __m128i lowNibble = _mm_set1_epi8(0x0f);
+        const __m128i nine = _mm_set1_epi8(9);
+        const __m128i digitBase = _mm_set1_epi8('0');
+        const __m128i letterOffset = _mm_set1_epi8(static_cast<char>(letterBase - '0' - 10));
+        while (len >= 16)
+        {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+            const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), lowNibble);
+            const __m128i low = _mm_and_si128(value, lowNibble);
+            // Every byte becomes its high nibble followed by its low nibble
+            __m128i first = _mm_unpacklo_epi8(high, low);
+            __m128i second = _mm_unpackhi_epi8(high, low);
+            first = _mm_add_epi8(_mm_add_epi8(first, digitBase),
+                                 _mm_and_si128(_mm_cmpgt_epi8(first, nine), letterOffset));
+            second = _mm_add_epi8(_mm_add_epi8(second, digitBase),
+                                  _mm_and_si128(_mm_cmpgt_epi8(second, nine), letterOffset));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), first);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), second);
+            src += 16;
+            dst += 32;
+            len -= 16;
+        }
+#endif
+        for (int i = 0; i < len; ++i)
+        {
+            const int high = src[i] >> 4;
+            const int low = src[i] & 0x0f;
+            dst[2 * i] = static_cast<char>(high < 10 ? '0' + high : letterBase + high - 10);
+            dst[2 * i + 1] = static_cast<char>(low < 10 ? '0' + low : letterBase + low - 10);
+        }
+    }
+};
+
+#endif // DIGEST_H
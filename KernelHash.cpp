@@ -0,0 +1,191 @@
+#include "KernelHash.h"
+#include "ScanProfiler.h"
+#include "CacheAdvisor.h"
+
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/if_alg.h>
+
+#ifndef AF_ALG
+#define AF_ALG 38
+#endif
+#ifndef SOL_ALG
+#define SOL_ALG 279
+#endif
+
+namespace
+{
+/// Bytes moved through the pipe per splice, also the pipe capacity we ask for
+const int spliceChunkSize = 1024 * 1024;
+/// Longest digest the kernel can return (sha512)
+const int maxDigestSize = 64;
+
+class FileDescriptor
+{
+    int fd;
+
+public:
+    explicit FileDescriptor(const int fd = -1) : fd(fd) {}
+    ~FileDescriptor()
+    {
+        if (fd >= 0)
+            ::close(fd);
+    }
+    int get() const { return fd; }
+    int release()
+    {
+        const int released = fd;
+        fd = -1;
+        return released;
+    }
+    void reset(const int newFd)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = newFd;
+    }
+
+private:
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+};
+
+/// Moves len bytes from the read end of a pipe into the hash socket
+bool drainPipe(const int pipeIn, const int opSocket, ssize_t len)
+{
+    while (len > 0)
+    {
+        const ssize_t n = ::splice(pipeIn, nullptr, opSocket, nullptr, static_cast<size_t>(len),
+                                   SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        len -= n;
+    }
+    return true;
+}
+}
+#endif
+
+
+KernelHash::KernelHash(const QByteArray &algorithm, const QByteArray &key)
+{
+#ifdef Q_OS_LINUX
+    sockaddr_alg address;
+    std::memset(&address, 0, sizeof(address));
+    address.salg_family = AF_ALG;
+    std::strcpy(reinterpret_cast<char *>(address.salg_type), "hash");
+    if (algorithm.isEmpty() || algorithm.size() >= static_cast<int>(sizeof(address.salg_name)))
+    {
+        return;
+    }
+    std::memcpy(address.salg_name, algorithm.constData(), static_cast<size_t>(algorithm.size()));
+
+    FileDescriptor tfm(::socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0));
+    if (tfm.get() < 0 || ::bind(tfm.get(), reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        return;
+    }
+    if (!key.isEmpty()
+        && ::setsockopt(tfm.get(), SOL_ALG, ALG_SET_KEY, key.constData(), static_cast<socklen_t>(key.size())) != 0)
+    {
+        return;
+    }
+    tfmSocket = tfm.release();
+#else
+    Q_UNUSED(algorithm)
+    Q_UNUSED(key)
+#endif
+}
+
+KernelHash::~KernelHash()
+{
+#ifdef Q_OS_LINUX
+    if (tfmSocket >= 0)
+        ::close(tfmSocket);
+#endif
+}
+
+QByteArray KernelHash::hashFile(const QString &filePath, ScanProfiler *profiler, const bool cachePolite) const
+{
+#ifdef Q_OS_LINUX
+    if (tfmSocket < 0)
+    {
+        return QByteArray();
+    }
+
+    FileDescriptor file;
+    {
+        ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::OPEN);
+        file.reset(::open(QFile::encodeName(filePath).constData(), O_RDONLY | O_CLOEXEC));
+        if (file.get() < 0)
+        {
+            return QByteArray();
+        }
+    }
+
+    // Every call gets its own request socket, the bound tfm socket is shared between threads
+    FileDescriptor opSocket(::accept4(tfmSocket, nullptr, nullptr, SOCK_CLOEXEC));
+    int pipeFds[2];
+    if (opSocket.get() < 0 || ::pipe2(pipeFds, O_CLOEXEC) != 0)
+    {
+        return QByteArray();
+    }
+    FileDescriptor pipeIn(pipeFds[0]);
+    FileDescriptor pipeOut(pipeFds[1]);
+    const int chunk = qMax(::fcntl(pipeOut.get(), F_SETPIPE_SZ, spliceChunkSize), 4096);
+
+    CacheAdvisor cacheAdvisor(file.get(), cachePolite);
+    qint64 position = 0;
+    forever
+    {
+        ssize_t len = 0;
+        {
+            ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::READ);
+            len = ::splice(file.get(), nullptr, pipeOut.get(), nullptr, static_cast<size_t>(chunk), SPLICE_F_MOVE);
+            scope.setBytes(qMax<qint64>(len, 0));
+        }
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len < 0)
+        {
+            return QByteArray();
+        }
+        if (len == 0)
+        {
+            break;
+        }
+        ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::HASH);
+        if (!drainPipe(pipeIn.get(), opSocket.get(), len))
+        {
+            return QByteArray();
+        }
+        position += len;
+        cacheAdvisor.advance(position);
+    }
+
+    // Reading the result finalizes the hash, also for an empty file
+    ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::HASH);
+    char digest[maxDigestSize];
+    ssize_t digestSize = -1;
+    do
+    {
+        digestSize = ::read(opSocket.get(), digest, sizeof(digest));
+    } while (digestSize < 0 && errno == EINTR);
+    return digestSize > 0 ? QByteArray(digest, static_cast<int>(digestSize)) : QByteArray();
+#else
+    Q_UNUSED(filePath)
+    Q_UNUSED(profiler)
+    Q_UNUSED(cachePolite)
+    return QByteArray();
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef KERNELHASH_H
+#define KERNELHASH_H
+
+#include <QString>
+#include <QByteArray>
+
+class ScanProfiler;
+
+/// Hashes files with the Linux kernel crypto API (AF_ALG).
+/// File pages are spliced through a pipe into the hash socket, so the data is never
+/// copied to user space and accelerated kernel drivers are used where the host has them.
+/// On other systems, or when the kernel lacks the algorithm, isValid() is false.
+class KernelHash
+{
+    int tfmSocket = -1;
+
+public:
+    /// algorithm is a kernel hash name like "md5", "sha1" or "crc32"
+    explicit KernelHash(const QByteArray &algorithm, const QByteArray &key = QByteArray());
+    ~KernelHash();
+
+    bool isValid() const { return tfmSocket >= 0; }
+    /// Raw digest of the file, empty on error. Safe to call from several threads at once.
+    /// cachePolite keeps the file out of the page cache, see CacheAdvisor.
+    QByteArray hashFile(const QString &filePath, ScanProfiler *profiler = nullptr, const bool cachePolite = false) const;
+
+private:
+    KernelHash(const KernelHash &) = delete;
+    KernelHash &operator=(const KernelHash &) = delete;
+};
+
+#endif // KERNELHASH_H
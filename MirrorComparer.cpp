@@ -0,0 +1,218 @@
+#include "MirrorComparer.h"
+#include "ScanProfiler.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSemaphore>
+
+#include <algorithm>
+
+MirrorComparer::MirrorComparer(QObject *parent)
+    : QObject(parent)
+{
+}
+
+MirrorComparer::~MirrorComparer()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+bool MirrorComparer::start(const QString &sourcePath, const QString &mirrorPath,
+                           const QSharedPointer<ChecksumCalculator> &calculator, const int threadCount,
+                           ScanProfiler *profiler)
+{
+    if (!calculator || !running.testAndSetOrdered(0, 1))
+    {
+        return false;
+    }
+    pool.waitForDone();
+
+    checksumCalculator = calculator;
+    this->profiler = profiler;
+    pairs.clear();
+    nextJob.storeRelease(0);
+    records.clear();
+    matchedCount.storeRelease(0);
+    discrepancyCount.storeRelease(0);
+    canceled.storeRelease(0);
+    BufferPool::global().resetPeak();
+
+    const int workers = qMax(1, threadCount);
+    // The planner and the second lister run next to each other before the workers start
+    pool.setMaxThreadCount(qMax(workers, 2));
+    pool.start([this, sourcePath, mirrorPath, workers]() { plan(sourcePath, mirrorPath, workers); });
+    return true;
+}
+
+void MirrorComparer::cancel()
+{
+    canceled.storeRelease(1);
+}
+
+bool MirrorComparer::isRunning() const
+{
+    return running.loadAcquire() != 0;
+}
+
+QVector<ScanRecord> MirrorComparer::takeRecords()
+{
+    QMutexLocker locker(&recordsMutex);
+    QVector<ScanRecord> taken;
+    taken.swap(records);
+    return taken;
+}
+
+int MirrorComparer::matched() const
+{
+    return matchedCount.loadAcquire();
+}
+
+int MirrorComparer::discrepancies() const
+{
+    return discrepancyCount.loadAcquire();
+}
+
+/// Lists both trees, reports what the join alone decides and starts the workers on the rest
+void MirrorComparer::plan(const QString &sourcePath, const QString &mirrorPath, const int workers)
+{
+    QVector<Entry> mirrorEntries;
+    QSemaphore mirrorListed;
+    pool.start([this, &mirrorEntries, &mirrorListed, mirrorPath]() {
+        mirrorEntries = list(mirrorPath);
+        mirrorListed.release();
+    });
+    const QVector<Entry> sourceEntries = list(sourcePath);
+    mirrorListed.acquire();
+
+    int s = 0;
+    int m = 0;
+    while (!canceled.loadAcquire() && (s < sourceEntries.size() || m < mirrorEntries.size()))
+    {
+        if (m == mirrorEntries.size()
+            || (s < sourceEntries.size() && sourceEntries.at(s) < mirrorEntries.at(m)))
+        {
+            addDiscrepancy(&sourceEntries.at(s++), nullptr, QStringLiteral("missing in mirror"));
+        }
+        else if (s == sourceEntries.size() || mirrorEntries.at(m) < sourceEntries.at(s))
+        {
+            addDiscrepancy(nullptr, &mirrorEntries.at(m++), QStringLiteral("extra in mirror"));
+        }
+        else
+        {
+            const Entry &source = sourceEntries.at(s++);
+            const Entry &mirror = mirrorEntries.at(m++);
+            if (source.size != mirror.size)
+            {
+                addDiscrepancy(&source, &mirror, QStringLiteral("size differs"));
+                continue;
+            }
+            Pair pair;
+            pair.source = source;
+            pair.mirror = mirror;
+            pairs.append(pair);
+        }
+    }
+
+    // Job 2 * i hashes the source of pair i and job 2 * i + 1 its mirror,
+    // so neighbouring workers read both sides of a pair at the same time
+    runningWorkers.storeRelease(workers);
+    pool.setMaxThreadCount(workers + 1);
+    for (int i = 0; i < workers; ++i)
+    {
+        pool.start([this]() { work(); });
+    }
+}
+
+QVector<MirrorComparer::Entry> MirrorComparer::list(const QString &rootPath)
+{
+    QVector<Entry> entries;
+    const QDir root(rootPath);
+    QDirIterator it(rootPath, QDir::Files, QDirIterator::Subdirectories);
+    ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::ENUMERATE);
+    while (it.hasNext() && !canceled.loadAcquire())
+    {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (info.isHidden())
+        {
+            continue;
+        }
+        Entry entry;
+        entry.relativePath = root.relativeFilePath(info.filePath());
+        entry.filePath = info.filePath();
+        entry.lastModified = info.lastModified();
+        entry.size = info.size();
+        entries.append(entry);
+    }
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+void MirrorComparer::work()
+{
+    const int jobs = pairs.size() * 2;
+    Pair *const pairData = pairs.data();
+    forever
+    {
+        const int job = nextJob.fetchAndAddOrdered(1);
+        if (job >= jobs || canceled.loadAcquire())
+        {
+            break;
+        }
+
+        Pair &pair = pairData[job / 2];
+        const bool mirrorSide = job % 2 != 0;
+        const Digest checksum = checksumCalculator->calcChecksum(mirrorSide ? pair.mirror.filePath
+                                                                             : pair.source.filePath, profiler);
+        if (mirrorSide)
+            pair.mirrorChecksum = checksum;
+        else
+            pair.sourceChecksum = checksum;
+        if (profiler)
+        {
+            profiler->recordFileDone();
+            profiler->recordBufferUsage(BufferPool::global().inUse(), BufferPool::global().peakUsage());
+        }
+
+        // The side finishing last compares, fetchAndSubOrdered publishes the other checksum to it
+        if (pair.pending.fetchAndSubOrdered(1) != 1)
+        {
+            continue;
+        }
+        if (pair.sourceChecksum.isEmpty() || pair.mirrorChecksum.isEmpty())
+            addDiscrepancy(&pair.source, &pair.mirror, QStringLiteral("read error"), pair.sourceChecksum, pair.mirrorChecksum);
+        else if (pair.sourceChecksum != pair.mirrorChecksum)
+            addDiscrepancy(&pair.source, &pair.mirror, QStringLiteral("content differs"), pair.sourceChecksum, pair.mirrorChecksum);
+        else
+            matchedCount.fetchAndAddOrdered(1);
+    }
+
+    if (runningWorkers.fetchAndSubOrdered(1) == 1)
+    {
+        BufferPool::global().trim();
+        running.storeRelease(0);
+        emit signalFinished();
+    }
+}
+
+void MirrorComparer::addDiscrepancy(const Entry *source, const Entry *mirror, const QString &status,
+                                    const Digest &sourceChecksum, const Digest &mirrorChecksum)
+{
+    const Entry *entry = source ? source : mirror;
+    ScanRecord record;
+    record.fileName = entry->relativePath;
+    record.filePath = entry->filePath;
+    record.lastModified = entry->lastModified;
+    record.size = source ? source->size : -1;
+    record.checksum = sourceChecksum;
+    record.status = status;
+    record.mirrorChecksum = mirrorChecksum;
+    record.mirrorSize = mirror ? mirror->size : -1;
+
+    discrepancyCount.fetchAndAddOrdered(1);
+    QMutexLocker locker(&recordsMutex);
+    records.append(record);
+}
@@ -0,0 +1,82 @@
+#ifndef MIRRORCOMPARER_H
+#define MIRRORCOMPARER_H
+
+#include "ChecksumCalculator.h"
+#include "ScanResults.h"
+
+#include <QObject>
+#include <QVector>
+#include <QMutex>
+#include <QThreadPool>
+#include <QSharedPointer>
+
+class ScanProfiler;
+
+/// Checks that a mirror tree matches its source.
+/// Both trees are listed recursively in parallel and joined by relative path.
+/// Files on one side only and pairs of different size are reported without reading them,
+/// pairs of equal size are hashed on the worker pool, both sides of a pair at the same time.
+/// Only discrepancies become records, collected with takeRecords() from the GUI thread.
+class MirrorComparer : public QObject
+{
+    Q_OBJECT
+
+    struct Entry
+    {
+        QString relativePath;
+        QString filePath;
+        QDateTime lastModified;
+        qint64 size;
+
+        bool operator<(const Entry &other) const { return relativePath < other.relativePath; }
+    };
+
+    struct Pair
+    {
+        Entry source;
+        Entry mirror;
+        Digest sourceChecksum;
+        Digest mirrorChecksum;
+        QAtomicInt pending {2};
+    };
+
+    QThreadPool pool;
+    QSharedPointer<ChecksumCalculator> checksumCalculator;
+    ScanProfiler *profiler = nullptr;
+
+    QVector<Pair> pairs;
+    QAtomicInt nextJob {0};
+
+    QMutex recordsMutex;
+    QVector<ScanRecord> records;
+
+    QAtomicInt matchedCount {0};
+    QAtomicInt discrepancyCount {0};
+    QAtomicInt runningWorkers {0};
+    QAtomicInt running {0};
+    QAtomicInt canceled {0};
+
+public:
+    explicit MirrorComparer(QObject *parent = nullptr);
+    ~MirrorComparer();
+
+    bool start(const QString &sourcePath, const QString &mirrorPath,
+               const QSharedPointer<ChecksumCalculator> &calculator, const int threadCount, ScanProfiler *profiler);
+    void cancel();
+    bool isRunning() const;
+    QVector<ScanRecord> takeRecords();
+    int matched() const;
+    int discrepancies() const;
+
+private:
+    void plan(const QString &sourcePath, const QString &mirrorPath, const int workers);
+    QVector<Entry> list(const QString &rootPath);
+    void work();
+    void addDiscrepancy(const Entry *source, const Entry *mirror, const QString &status,
+                        const Digest &sourceChecksum = Digest(), const Digest &mirrorChecksum = Digest());
+
+signals:
+    void signalFinished();
+};
+
+#endif // MIRRORCOMPARER_H
@@ -0,0 +1,98 @@
+#include "ReportExporter.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace
+{
+/// Progress is reported at most this many times per export
+const int progressSteps = 100;
+}
+
+ReportExporter::ReportExporter(QObject *parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+ReportExporter::~ReportExporter()
+{
+    cancelAll();
+    pool.waitForDone();
+}
+
+int ReportExporter::start(const QSharedPointer<ReportWriter> &writer, const QString &savePath,
+                          const ReportHeader &header, const QSharedPointer<const ScanResults> &results)
+{
+    if (!writer || !results)
+    {
+        return -1;
+    }
+
+    QSharedPointer<QAtomicInt> canceled(new QAtomicInt(0));
+    int id = 0;
+    {
+        QMutexLocker locker(&exportsMutex);
+        id = ++lastId;
+        exports.insert(id, canceled);
+    }
+
+    pool.start([this, id, canceled, writer, savePath, header, results]() {
+        const int total = results->size();
+        const int step = qMax(1, total / progressSteps);
+        bool ok = writer->open(savePath, header);
+        for (int i = 0; ok && i < total && !canceled->loadAcquire(); ++i)
+        {
+            ok = writer->writeRow(results->at(i));
+            if ((i + 1) % step == 0)
+            {
+                emit signalProgress(id, i + 1, total);
+            }
+        }
+
+        const bool wasCanceled = canceled->loadAcquire() != 0;
+        if (wasCanceled)
+        {
+            writer->abort();
+            QFile::remove(savePath);
+        }
+        else
+        {
+            ok = writer->close() && ok;
+        }
+
+        {
+            QMutexLocker locker(&exportsMutex);
+            exports.remove(id);
+        }
+        if (wasCanceled)
+            emit signalCanceled(id, savePath);
+        else
+            emit signalFinished(id, savePath, ok);
+    });
+    return id;
+}
+
+void ReportExporter::cancel(const int id)
+{
+    QMutexLocker locker(&exportsMutex);
+    const auto canceled = exports.value(id);
+    if (canceled)
+        canceled->storeRelease(1);
+}
+
+void ReportExporter::cancelAll()
+{
+    QMutexLocker locker(&exportsMutex);
+    for (const auto &canceled : exports)
+    {
+        canceled->storeRelease(1);
+    }
+}
+
+bool ReportExporter::isRunning() const
+{
+    QMutexLocker locker(&exportsMutex);
+    return !exports.isEmpty();
+}
@@ -0,0 +1,42 @@
+#ifndef REPORTEXPORTER_H
+#define REPORTEXPORTER_H
+
+#include "ReportWriter.h"
+
+#include <QObject>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QHash>
+
+/// Streams the rows of a finished scan into ReportWriters on background threads.
+/// Several exports, e.g. TXT and XLSX of the same scan, run at once, each one can be canceled.
+class ReportExporter : public QObject
+{
+    Q_OBJECT
+
+    QThreadPool pool;
+    mutable QMutex exportsMutex;
+    /// Cancel flags of the running exports by id
+    QHash<int, QSharedPointer<QAtomicInt>> exports;
+    int lastId = 0;
+
+public:
+    explicit ReportExporter(QObject *parent = nullptr);
+    ~ReportExporter();
+
+    /// Id of the started export, -1 if it could not start
+    int start(const QSharedPointer<ReportWriter> &writer, const QString &savePath,
+              const ReportHeader &header, const QSharedPointer<const ScanResults> &results);
+    /// The export stops after the current row and its file is removed
+    void cancel(const int id);
+    void cancelAll();
+    bool isRunning() const;
+
+signals:
+    void signalProgress(int id, int done, int total);
+    void signalFinished(int id, const QString &savePath, bool ok);
+    void signalCanceled(int id, const QString &savePath);
+};
+
+#endif // REPORTEXPORTER_H
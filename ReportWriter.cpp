@@ -0,0 +1,487 @@
+#include "ReportWriter.h"
+
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+
+#include <QFileInfo>
+
+namespace
+{
+void put2Digits(char *dst, const int value)
+{
+    dst[0] = static_cast<char>('0' + value / 10 % 10);
+    dst[1] = static_cast<char>('0' + value % 10);
+}
+
+/// "dd.MM.yyyy  hh:mm", the text of the date column in the table
+void appendDateTime(Utf8Writer &out, const QDateTime &dateTime)
+{
+    const QDate date = dateTime.date();
+    const QTime time = dateTime.time();
+    char text[17];
+    put2Digits(text, date.day());
+    text[2] = '.';
+    put2Digits(text + 3, date.month());
+    text[5] = '.';
+    put2Digits(text + 6, date.year() / 100);
+    put2Digits(text + 8, date.year() % 100);
+    text[10] = ' ';
+    text[11] = ' ';
+    put2Digits(text + 12, time.hour());
+    text[14] = ':';
+    put2Digits(text + 15, time.minute());
+    out.append(text, sizeof(text));
+}
+
+/// "yyyy-MM-dd hh:mm:ss", which spreadsheets parse as a date regardless of locale
+void appendIsoDateTime(Utf8Writer &out, const QDateTime &dateTime)
+{
+    const QDate date = dateTime.date();
+    const QTime time = dateTime.time();
+    char text[19];
+    put2Digits(text, date.year() / 100);
+    put2Digits(text + 2, date.year() % 100);
+    text[4] = '-';
+    put2Digits(text + 5, date.month());
+    text[7] = '-';
+    put2Digits(text + 8, date.day());
+    text[10] = ' ';
+    put2Digits(text + 11, time.hour());
+    text[13] = ':';
+    put2Digits(text + 14, time.minute());
+    text[16] = ':';
+    put2Digits(text + 17, time.second());
+    out.append(text, sizeof(text));
+}
+
+void appendCsvField(Utf8Writer &out, const QString &text)
+{
+    bool needsQuotes = false;
+    for (const QChar c : text)
+    {
+        if (c == QLatin1Char(',') || c == QLatin1Char('"') || c == QLatin1Char('\n') || c == QLatin1Char('\r'))
+        {
+            needsQuotes = true;
+            break;
+        }
+    }
+    if (!needsQuotes)
+    {
+        out.append(text);
+        return;
+    }
+    out.append('"');
+    out.append(QString(text).replace(QLatin1Char('"'), QStringLiteral("\"\"")));
+    out.append('"');
+}
+
+void appendJsonString(Utf8Writer &out, const QString &text)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    out.append('"');
+    int plainFrom = 0;
+    const int len = text.size();
+    for (int i = 0; i < len; ++i)
+    {
+        const ushort c = text.at(i).unicode();
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+        out.append(text.midRef(plainFrom, i - plainFrom).toString());
+        plainFrom = i + 1;
+        if (c == '"' || c == '\\')
+        {
+            const char escaped[2] = {'\\', static_cast<char>(c)};
+            out.append(escaped, 2);
+        }
+        else
+        {
+            const char escaped[6] = {'\\', 'u', '0', '0', hexDigits[c >> 4], hexDigits[c & 0xf]};
+            out.append(escaped, 6);
+        }
+    }
+    out.append(plainFrom == 0 ? text : text.mid(plainFrom));
+    out.append('"');
+}
+
+/// Sizes of files missing on one side of a mirror comparison are -1 and stay blank
+void appendSize(Utf8Writer &out, const qint64 size, const int width)
+{
+    if (size < 0)
+        out.appendSpaces(width);
+    else
+        out.appendPaddedNumber(size, width);
+}
+
+void appendJsonSize(Utf8Writer &out, const qint64 size)
+{
+    if (size < 0)
+        out.append("null", 4);
+    else
+        out.appendNumber(size);
+}
+
+/// Hex straight into the output buffer, padded with spaces to width
+void appendDigest(Utf8Writer &out, const Digest &digest, const int width = 0)
+{
+    char hex[Digest::maxSize * 2];
+    digest.toHex(hex);
+    out.append(hex, digest.hexSize());
+    out.appendSpaces(width - digest.hexSize());
+}
+}
+
+
+bool TxtReportWriter::open(const QString &path, const ReportHeader &header)
+{
+    if (!out.open(path))
+    {
+        return false;
+    }
+
+    wChecksum = static_cast<int>(header.checksumMaxLen);
+    mirrorComparison = header.mirrorComparison;
+    if (!header.filter.isEmpty())
+    {
+        out.append(QStringLiteral("Filter: %1\n\n").arg(header.filter));
+    }
+    out.appendPadded(QStringLiteral("Filename"), wName);
+    if (mirrorComparison)
+    {
+        out.appendPadded(QStringLiteral("Status"), wStatus);
+        out.appendPadded(QStringLiteral("Checksum (%1)").arg(header.checksumName), wChecksum);
+        out.appendPadded(QStringLiteral("Mirror checksum"), wChecksum);
+        out.appendPadded(QStringLiteral("File size"), wSize, true);
+        out.appendPadded(QStringLiteral("Mirror size"), wSize, true);
+        out.append('\n');
+        return !out.hasError();
+    }
+    out.appendPadded(QStringLiteral("Last edit date time"), wDate);
+    out.appendPadded(QStringLiteral("Checksum (%1)").arg(header.checksumName), wChecksum);
+    out.appendPadded(QStringLiteral("File size"), wSize, true);
+    out.append('\n');
+    return !out.hasError();
+}
+
+bool TxtReportWriter::writeRow(const ScanRecord &record)
+{
+    out.appendPadded(record.fileName, wName);
+    if (mirrorComparison)
+    {
+        out.appendPadded(record.status, wStatus);
+        appendDigest(out, record.checksum, wChecksum);
+        appendDigest(out, record.mirrorChecksum, wChecksum);
+        appendSize(out, record.size, wSize);
+        appendSize(out, record.mirrorSize, wSize);
+        out.append('\n');
+        return !out.hasError();
+    }
+    appendDateTime(out, record.lastModified);
+    out.appendSpaces(wDate - 17);
+    appendDigest(out, record.checksum, wChecksum);
+    out.appendPaddedNumber(record.size, wSize);
+    out.append('\n');
+    return !out.hasError();
+}
+
+bool TxtReportWriter::flush()
+{
+    return out.flush();
+}
+
+bool TxtReportWriter::close()
+{
+    return out.close();
+}
+
+
+bool CsvReportWriter::open(const QString &path, const ReportHeader &header)
+{
+    if (!out.open(path))
+    {
+        return false;
+    }
+
+    mirrorComparison = header.mirrorComparison;
+    out.append("\xEF\xBB\xBF", 3);
+    if (!header.filter.isEmpty())
+    {
+        appendCsvField(out, QStringLiteral("# Filter: %1").arg(header.filter));
+        out.append("\r\n", 2);
+    }
+    out.append(mirrorComparison ? QStringLiteral("Filename,Status,") : QStringLiteral("Filename,Last edit date time,"));
+    appendCsvField(out, QStringLiteral("Checksum (%1)").arg(header.checksumName));
+    out.append(mirrorComparison ? QStringLiteral(",Mirror checksum,File size,Mirror size\r\n")
+                                : QStringLiteral(",File size\r\n"));
+    return !out.hasError();
+}
+
+bool CsvReportWriter::writeRow(const ScanRecord &record)
+{
+    appendCsvField(out, record.fileName);
+    out.append(',');
+    if (mirrorComparison)
+    {
+        out.append(record.status);
+        out.append(',');
+        appendDigest(out, record.checksum);
+        out.append(',');
+        appendDigest(out, record.mirrorChecksum);
+        out.append(',');
+        if (record.size >= 0)
+            out.appendNumber(record.size);
+        out.append(',');
+        if (record.mirrorSize >= 0)
+            out.appendNumber(record.mirrorSize);
+        out.append("\r\n", 2);
+        return !out.hasError();
+    }
+    appendIsoDateTime(out, record.lastModified);
+    out.append(',');
+    appendDigest(out, record.checksum);
+    out.append(',');
+    out.appendNumber(record.size);
+    out.append("\r\n", 2);
+    return !out.hasError();
+}
+
+bool CsvReportWriter::flush()
+{
+    return out.flush();
+}
+
+bool CsvReportWriter::close()
+{
+    return out.close();
+}
+
+
+bool JsonLinesReportWriter::open(const QString &path, const ReportHeader &header)
+{
+    algorithm = header.checksumName;
+    if (!out.open(path))
+    {
+        return false;
+    }
+
+    if (!header.filter.isEmpty())
+    {
+        out.append("{\"filter\":", 10);
+        appendJsonString(out, header.filter);
+        out.append("}\n", 2);
+    }
+    return !out.hasError();
+}
+
+bool JsonLinesReportWriter::writeRow(const ScanRecord &record)
+{
+    out.append("{\"name\":", 8);
+    appendJsonString(out, record.fileName);
+    out.append(",\"path\":", 8);
+    appendJsonString(out, record.filePath);
+    out.append(",\"modified\":\"", 13);
+    appendIsoDateTime(out, record.lastModified);
+    out.append("\",\"size\":", 9);
+    appendJsonSize(out, record.size);
+    out.append(",\"algorithm\":", 13);
+    appendJsonString(out, algorithm);
+    out.append(",\"checksum\":\"", 13);
+    appendDigest(out, record.checksum);
+    out.append('"');
+    if (!record.status.isEmpty())
+    {
+        out.append(",\"status\":", 10);
+        appendJsonString(out, record.status);
+        out.append(",\"mirror_checksum\":\"", 20);
+        appendDigest(out, record.mirrorChecksum);
+        out.append("\",\"mirror_size\":", 16);
+        appendJsonSize(out, record.mirrorSize);
+    }
+    out.append("}\n", 2);
+    return !out.hasError();
+}
+
+bool JsonLinesReportWriter::flush()
+{
+    return out.flush();
+}
+
+bool JsonLinesReportWriter::close()
+{
+    return out.close();
+}
+
+
+bool DigestListReportWriter::open(const QString &path, const ReportHeader &header)
+{
+    Q_UNUSED(header)
+    reportFolder = QFileInfo(path).absolutePath();
+    lastFolder.clear();
+    return out.open(path);
+}
+
+bool DigestListReportWriter::writeRow(const ScanRecord &record)
+{
+    // sha1sum -c rejects a line without a digest
+    if (record.checksum.isEmpty())
+    {
+        return true;
+    }
+
+    // The names are checked relative to the folder sha1sum -c runs in, the one of the report
+    QString name = record.fileName;
+    if (record.filePath.size() > record.fileName.size())
+    {
+        const QString folder = record.filePath.left(record.filePath.size() - record.fileName.size() - 1);
+        if (folder != lastFolder)
+        {
+            lastFolder = folder;
+            lastFolderIsReportFolder = QFileInfo(folder).absoluteFilePath() == reportFolder;
+        }
+        if (!lastFolderIsReportFolder)
+            name = QFileInfo(record.filePath).absoluteFilePath();
+    }
+
+    // Like coreutils, names with a backslash or a newline are escaped and the line starts with '\'
+    const bool escape = name.contains(QLatin1Char('\\')) || name.contains(QLatin1Char('\n'));
+    if (escape)
+    {
+        name.replace(QLatin1Char('\\'), QStringLiteral("\\\\")).replace(QLatin1Char('\n'), QStringLiteral("\\n"));
+        out.append('\\');
+    }
+    char hex[Digest::maxSize * 2];
+    record.checksum.toHex(hex, false);
+    out.append(hex, record.checksum.hexSize());
+    out.append("  ", 2);
+    out.append(name);
+    out.append('\n');
+    return !out.hasError();
+}
+
+bool DigestListReportWriter::flush()
+{
+    return out.flush();
+}
+
+bool DigestListReportWriter::close()
+{
+    return out.close();
+}
+
+
+const int XlsxReportWriter::maxRowsPerSheet;
+
+XlsxReportWriter::XlsxReportWriter(const int rowsPerSheet)
+    : rowsPerSheet(qBound(1, rowsPerSheet, maxRowsPerSheet))
+{
+}
+
+XlsxReportWriter::~XlsxReportWriter() = default;
+
+bool XlsxReportWriter::open(const QString &path, const ReportHeader &header)
+{
+    savePath = path;
+    this->header = header;
+    xlsx.reset(new QXlsx::Document);
+    if (!header.filter.isEmpty())
+    {
+        xlsx->setDocumentProperty(QStringLiteral("description"), QStringLiteral("Filter: %1").arg(header.filter));
+    }
+
+    headerFormat = QXlsx::Format();
+    headerFormat.setNumberFormatIndex(49);
+    headerFormat.setFontBold(true);
+    headerFormat.setHorizontalAlignment(QXlsx::Format::HorizontalAlignment::AlignHCenter);
+    txtFormat = QXlsx::Format();
+    txtFormat.setNumberFormatIndex(49);
+    dateTimeFormat = QXlsx::Format();
+    dateTimeFormat.setNumberFormat(QStringLiteral("dd.MM.yyyy hh:mm"));
+
+    headerRows = header.filter.isEmpty() ? 1 : 2;
+    lastRow = qMin(rowsPerSheet, maxRowsPerSheet + 1 - headerRows) + headerRows;
+    sheet = xlsx->currentWorksheet();
+    return startSheet();
+}
+
+bool XlsxReportWriter::startSheet()
+{
+    if (!sheet)
+    {
+        return false;
+    }
+    // Finished rows go straight to the file instead of piling up in memory
+    sheet->setStreamingEnabled(true);
+    sheet->setColumnWidth(1, 1, 80.0);
+    sheet->setColumnWidth(2, 2, 20.0);
+    sheet->setColumnWidth(3, 3, 40.0);
+    sheet->setColumnWidth(4, 4, header.mirrorComparison ? 40.0 : 15.0);
+    if (!header.filter.isEmpty())
+    {
+        sheet->writeString(1, 1, QStringLiteral("Filter: %1").arg(header.filter), txtFormat);
+    }
+    if (header.mirrorComparison)
+    {
+        sheet->setColumnWidth(5, 6, 15.0);
+        sheet->writeString(headerRows, 1, QStringLiteral("Filename"), headerFormat);
+        sheet->writeString(headerRows, 2, QStringLiteral("Status"), headerFormat);
+        sheet->writeString(headerRows, 3, QStringLiteral("Checksum (%1)").arg(header.checksumName), headerFormat);
+        sheet->writeString(headerRows, 4, QStringLiteral("Mirror checksum"), headerFormat);
+        sheet->writeString(headerRows, 5, QStringLiteral("File size"), headerFormat);
+        sheet->writeString(headerRows, 6, QStringLiteral("Mirror size"), headerFormat);
+        row = headerRows;
+        return true;
+    }
+    sheet->writeString(headerRows, 1, QStringLiteral("Filename"), headerFormat);
+    sheet->writeString(headerRows, 2, QStringLiteral("Last edit date time"), headerFormat);
+    sheet->writeString(headerRows, 3, QStringLiteral("Checksum (%1)").arg(header.checksumName), headerFormat);
+    sheet->writeString(headerRows, 4, QStringLiteral("File size"), headerFormat);
+    row = headerRows;
+    return true;
+}
+
+bool XlsxReportWriter::writeRow(const ScanRecord &record)
+{
+    if (row >= lastRow)
+    {
+        sheet = xlsx->addSheet() ? xlsx->currentWorksheet() : nullptr;
+        if (!startSheet())
+        {
+            return false;
+        }
+    }
+    ++row;
+    // Names and checksums are unique, as inline strings they do not pile up in the shared strings
+    if (header.mirrorComparison)
+    {
+        return sheet->writeInlineString(row, 1, record.fileName, txtFormat)
+                && sheet->writeString(row, 2, record.status, txtFormat)
+                && (record.checksum.isEmpty() || sheet->writeInlineString(row, 3, record.checksum.toHexString(), txtFormat))
+                && (record.mirrorChecksum.isEmpty() || sheet->writeInlineString(row, 4, record.mirrorChecksum.toHexString(), txtFormat))
+                && (record.size < 0 || sheet->writeNumeric(row, 5, static_cast<double>(record.size), txtFormat))
+                && (record.mirrorSize < 0 || sheet->writeNumeric(row, 6, static_cast<double>(record.mirrorSize), txtFormat));
+    }
+    const QDateTime dateTime(record.lastModified.date(), record.lastModified.time());
+    return sheet->writeInlineString(row, 1, record.fileName, txtFormat)
+            && sheet->writeDateTime(row, 2, dateTime, dateTimeFormat)
+            && sheet->writeInlineString(row, 3, record.checksum.toHexString(), txtFormat)
+            && sheet->writeNumeric(row, 4, static_cast<double>(record.size), txtFormat);
+}
+
+bool XlsxReportWriter::close()
+{
+    if (xlsx && xlsx->sheetNames().size() > 1)
+    {
+        xlsx->selectSheet(xlsx->sheetNames().first());
+    }
+    const bool ok = xlsx && xlsx->saveAs(savePath);
+    xlsx.reset();
+    sheet = nullptr;
+    return ok;
+}
+
+void XlsxReportWriter::abort()
+{
+    xlsx.reset();
+    sheet = nullptr;
+}
@@ -0,0 +1,150 @@
+#ifndef REPORTWRITER_H
+#define REPORTWRITER_H
+
+#include "ScanResults.h"
+#include "Utf8Writer.h"
+
+#include "xlsxformat.h"
+
+#include <QScopedPointer>
+
+namespace QXlsx { class Document; class Worksheet; }
+
+struct ReportHeader
+{
+    QString checksumName;
+    std::size_t checksumMaxLen = 0;
+    /// Discrepancy report of a mirror comparison: status and mirror columns instead of the date
+    bool mirrorComparison = false;
+    /// ScanFilter::description() of the scan, empty when every file was hashed
+    QString filter;
+};
+
+/// Writes report rows to a file one at a time, in the order they are given
+class ReportWriter
+{
+public:
+    ReportWriter() = default;
+    virtual ~ReportWriter() = default;
+    virtual bool open(const QString &path, const ReportHeader &header) = 0;
+    virtual bool writeRow(const ScanRecord &record) = 0;
+    /// Pushes the rows written so far to the file, so an interrupted report stays readable
+    virtual bool flush() { return true; }
+    virtual bool close() = 0;
+    /// Gives up the report, the file is removed by the caller
+    virtual void abort() { close(); }
+};
+
+
+class TxtReportWriter : public ReportWriter
+{
+    const int wName = 50;
+    const int wDate = 25;
+    const int wSize = 15;
+    const int wStatus = 20;
+    int wChecksum = 0;
+    bool mirrorComparison = false;
+    Utf8Writer out;
+
+public:
+    TxtReportWriter() = default;
+
+    bool open(const QString &path, const ReportHeader &header) override;
+    bool writeRow(const ScanRecord &record) override;
+    bool flush() override;
+    bool close() override;
+};
+
+
+/// RFC 4180 comma separated values, UTF-8 with BOM so Excel detects the encoding.
+/// The filter of the scan, if any, is a "# Filter: ..." line before the column names
+class CsvReportWriter : public ReportWriter
+{
+    Utf8Writer out;
+    bool mirrorComparison = false;
+
+public:
+    CsvReportWriter() = default;
+
+    bool open(const QString &path, const ReportHeader &header) override;
+    bool writeRow(const ScanRecord &record) override;
+    bool flush() override;
+    bool close() override;
+};
+
+
+/// One JSON object per line: name, path, modified, size, algorithm and checksum.
+/// The filter of the scan, if any, is a {"filter": ...} object on the first line
+class JsonLinesReportWriter : public ReportWriter
+{
+    Utf8Writer out;
+    QString algorithm;
+
+public:
+    JsonLinesReportWriter() = default;
+
+    bool open(const QString &path, const ReportHeader &header) override;
+    bool writeRow(const ScanRecord &record) override;
+    bool flush() override;
+    bool close() override;
+};
+
+
+/// "<digest>  <name>" lines as written by md5sum/sha1sum, readable by their -c option.
+/// Files in the report's folder are listed by name, the others by absolute path.
+/// Files that could not be read have no checksum and are left out
+class DigestListReportWriter : public ReportWriter
+{
+    Utf8Writer out;
+    QString reportFolder;
+    /// Folder of the previous row and whether it is the report's one, rows come folder by folder
+    QString lastFolder;
+    bool lastFolderIsReportFolder = false;
+
+public:
+    DigestListReportWriter() = default;
+
+    bool open(const QString &path, const ReportHeader &header) override;
+    bool writeRow(const ScanRecord &record) override;
+    bool flush() override;
+    bool close() override;
+};
+
+
+/// Starts a new worksheet with the same header every rowsPerSheet rows,
+/// so reports larger than the Excel row limit stay openable
+/// The filter of the scan, if any, is a row above the column names of every sheet
+/// The sheets are streamed, so the memory used does not grow with the report size
+class XlsxReportWriter : public ReportWriter
+{
+    QString savePath;
+    ReportHeader header;
+    const int rowsPerSheet;
+    QScopedPointer<QXlsx::Document> xlsx;
+    QXlsx::Worksheet *sheet = nullptr;
+    QXlsx::Format headerFormat;
+    QXlsx::Format txtFormat;
+    QXlsx::Format dateTimeFormat;
+    int row = 0;
+    /// Rows above the data of every sheet: the filter, if any, and the column names
+    int headerRows = 1;
+    int lastRow = 0;
+
+public:
+    /// Rows of data per sheet when one row of every sheet is the header
+    static const int maxRowsPerSheet = 1048576 - 1;
+
+    explicit XlsxReportWriter(const int rowsPerSheet = maxRowsPerSheet);
+    ~XlsxReportWriter();
+
+    bool open(const QString &path, const ReportHeader &header) override;
+    bool writeRow(const ScanRecord &record) override;
+    bool close() override;
+    /// Drops the document without saving it
+    void abort() override;
+
+private:
+    bool startSheet();
+};
+
+#endif // REPORTWRITER_H
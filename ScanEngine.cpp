@@ -0,0 +1,331 @@
+#include "ScanEngine.h"
+#include "ScanProfiler.h"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+namespace
+{
+/// Files handed over to the queue at once, so the enumerator takes the lock rarely
+const int enumerateBatchSize = 256;
+/// Files up to this size are read in one go
+const qint64 smallFileSize = 1024 * 1024;
+/// Files from this size on stream long enough to hold a worker for seconds
+const qint64 largeFileSize = 64 * 1024 * 1024;
+/// A report written during the scan is flushed this often, so it stays usable if the scan is interrupted
+const qint64 reportFlushIntervalMs = 1000;
+}
+
+ScanEngine::ScanEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ScanEngine::~ScanEngine()
+{
+    cancel();
+    pool.waitForDone();
+}
+
+bool ScanEngine::start(const QVector<ScanRoot> &scanRoots, const int threadCount, ScanProfiler *profiler)
+{
+    if (isRunning() || scanRoots.isEmpty())
+    {
+        return false;
+    }
+    for (const auto &root : scanRoots)
+    {
+        if (!root.calculator)
+        {
+            return false;
+        }
+    }
+    pool.waitForDone();
+
+    this->profiler = profiler;
+    roots.clear();
+    reportFileNames.clear();
+    reportFilePaths.clear();
+    for (const auto &root : scanRoots)
+    {
+        QSharedPointer<RootState> state(new RootState);
+        state->root = root;
+        state->reportFlushTimer.start();
+        roots.append(state);
+        if (!root.reportPath.isEmpty())
+        {
+            const QFileInfo reportInfo(root.reportPath);
+            reportFileNames.insert(reportInfo.fileName());
+            reportFilePaths.insert(reportInfo.absoluteFilePath());
+        }
+    }
+
+    for (auto &lane : lanes)
+    {
+        lane.clear();
+    }
+    queuedTasks = 0;
+    activeLarge = 0;
+    runningEnumerators = roots.size();
+    records.clear();
+    canceled.storeRelease(0);
+    BufferPool::global().resetPeak();
+
+    const int workers = qMax(1, threadCount);
+    // A single worker serves small files first and takes large ones once nothing else is left
+    largeWorkerLimit = workers / 2;
+    runningWorkers.storeRelease(workers);
+    pool.setMaxThreadCount(workers + roots.size());
+    for (int root = 0; root < roots.size(); ++root)
+    {
+        pool.start([this, root]() { enumerate(root); });
+    }
+    for (int i = 0; i < workers; ++i)
+    {
+        pool.start([this]() { work(); });
+    }
+    return true;
+}
+
+void ScanEngine::cancel()
+{
+    canceled.storeRelease(1);
+    QMutexLocker locker(&queueMutex);
+    queueNotEmpty.wakeAll();
+}
+
+void ScanEngine::setMemoryBudget(const qint64 bytes)
+{
+    BufferPool::global().setCapacity(bytes);
+    QMutexLocker locker(&queueMutex);
+    queueNotEmpty.wakeAll();
+}
+
+bool ScanEngine::isRunning() const
+{
+    return runningWorkers.loadAcquire() > 0;
+}
+
+bool ScanEngine::reportOk(const int root) const
+{
+    return root >= 0 && root < roots.size() && !roots.at(root)->reportFailed.loadAcquire();
+}
+
+QVector<ScanRecord> ScanEngine::takeRecords()
+{
+    QMutexLocker locker(&recordsMutex);
+    QVector<ScanRecord> taken;
+    taken.swap(records);
+    return taken;
+}
+
+void ScanEngine::enumerate(const int root)
+{
+    const RootState &state = *roots.at(root);
+    QVector<ScanTask> batch;
+    batch.reserve(enumerateBatchSize);
+
+    // Name patterns are matched by the iterator, the rest of the filter on the entry's stat data
+    const ScanFilter &filter = state.root.filter;
+    QDirIterator it(state.root.folderPath, filter.namePatterns, QDir::Files);
+    bool done = false;
+    while (!done && !canceled.loadAcquire() && !state.reportFailed.loadAcquire())
+    {
+        {
+            ScanProfiler::Scope scope(profiler, ScanProfiler::STAGES::ENUMERATE);
+            while (batch.size() < enumerateBatchSize && it.hasNext())
+            {
+                it.next();
+                const QFileInfo info = it.fileInfo();
+                if (info.isHidden() || !filter.accepts(info))
+                {
+                    continue;
+                }
+                if (reportFileNames.contains(info.fileName()) && reportFilePaths.contains(info.absoluteFilePath()))
+                {
+                    continue;
+                }
+                ScanTask task;
+                task.fileName = info.fileName();
+                task.filePath = info.filePath();
+                task.lastModified = info.lastModified();
+                task.size = info.size();
+                task.sizeClass = task.size <= smallFileSize ? SIZE_SMALL
+                                 : task.size < largeFileSize ? SIZE_MEDIUM : SIZE_LARGE;
+                task.bufferBytes = ChecksumCalculator::bufferSize(task.size);
+                task.root = root;
+                batch.append(task);
+            }
+            done = !it.hasNext();
+        }
+
+        QMutexLocker locker(&queueMutex);
+        for (const auto &task : batch)
+        {
+            lanes[task.sizeClass].enqueue(task);
+        }
+        queuedTasks += batch.size();
+        batch.clear();
+        if (profiler)
+            profiler->recordQueueDepth(queuedTasks);
+        queueNotEmpty.wakeAll();
+    }
+
+    QMutexLocker locker(&queueMutex);
+    --runningEnumerators;
+    queueNotEmpty.wakeAll();
+}
+
+void ScanEngine::work()
+{
+    forever
+    {
+        ScanTask task;
+        BufferPool::Buffer buffer;
+        bool taken = false;
+        {
+            QMutexLocker locker(&queueMutex);
+            while (!canceled.loadAcquire())
+            {
+                taken = takeTask(task, buffer);
+                if (taken || (queuedTasks == 0 && runningEnumerators == 0))
+                {
+                    break;
+                }
+                queueNotEmpty.wait(&queueMutex);
+            }
+            if (taken && profiler)
+            {
+                profiler->recordQueueDepth(queuedTasks);
+                profiler->recordBufferUsage(BufferPool::global().inUse(), BufferPool::global().peakUsage());
+            }
+        }
+        if (!taken)
+        {
+            break;
+        }
+
+        RootState &state = *roots.at(task.root);
+        if (state.reportFailed.loadAcquire())
+        {
+            buffer.release();
+            finishTask(task);
+            continue;
+        }
+
+        ScanRecord record;
+        record.fileName = task.fileName;
+        record.filePath = task.filePath;
+        record.lastModified = task.lastModified;
+        record.size = task.size;
+        record.checksum = state.root.calculator->calcChecksum(task.filePath, profiler, std::move(buffer));
+        if (profiler)
+            profiler->recordFileDone();
+        finishTask(task);
+
+        if (state.root.reportWriter)
+        {
+            writeReportRow(state, record);
+            continue;
+        }
+        QMutexLocker locker(&recordsMutex);
+        records.append(record);
+    }
+
+    if (runningWorkers.fetchAndSubOrdered(1) == 1)
+    {
+        for (const auto &state : roots)
+        {
+            if (!state->root.reportWriter)
+            {
+                continue;
+            }
+            QMutexLocker locker(&state->reportMutex);
+            if (!state->root.reportWriter->close())
+                state->reportFailed.storeRelease(1);
+            state->root.reportWriter.reset();
+        }
+        BufferPool::global().trim();
+        emit signalFinished();
+    }
+}
+
+/// Picks the next file to hash, called with queueMutex held.
+/// Returns false if nothing may start now: the lanes are empty, every large-file slot is busy
+/// with only large files left, or the buffer pool has no room for the file's read buffer.
+bool ScanEngine::takeTask(ScanTask &task, BufferPool::Buffer &buffer)
+{
+    SIZE_CLASSES sizeClass = SIZE_MAX;
+    if (!lanes[SIZE_LARGE].isEmpty() && activeLarge < largeWorkerLimit)
+        sizeClass = SIZE_LARGE;
+    else if (!lanes[SIZE_SMALL].isEmpty())
+        sizeClass = SIZE_SMALL;
+    else if (!lanes[SIZE_MEDIUM].isEmpty())
+        sizeClass = SIZE_MEDIUM;
+    else if (!lanes[SIZE_LARGE].isEmpty() && (runningEnumerators == 0 || largeWorkerLimit == 0))
+        sizeClass = SIZE_LARGE;
+    if (sizeClass == SIZE_MAX)
+    {
+        return false;
+    }
+
+    // The pool grants the first buffer in use, so a budget below one buffer can not stall the scan
+    buffer = BufferPool::global().tryAcquire(lanes[sizeClass].head().bufferBytes);
+    if (buffer.isNull())
+    {
+        return false;
+    }
+
+    task = lanes[sizeClass].dequeue();
+    --queuedTasks;
+    if (sizeClass == SIZE_LARGE)
+        ++activeLarge;
+    return true;
+}
+
+void ScanEngine::finishTask(const ScanTask &task)
+{
+    if (profiler)
+        profiler->recordBufferUsage(BufferPool::global().inUse(), BufferPool::global().peakUsage());
+    QMutexLocker locker(&queueMutex);
+    if (task.sizeClass == SIZE_LARGE)
+        --activeLarge;
+    queueNotEmpty.wakeAll();
+}
+
+void ScanEngine::writeReportRow(RootState &state, const ScanRecord &record)
+{
+    QMutexLocker locker(&state.reportMutex);
+    if (state.reportFailed.loadAcquire())
+    {
+        return;
+    }
+
+    bool ok = state.root.reportWriter->writeRow(record);
+    if (ok && state.reportFlushTimer.hasExpired(reportFlushIntervalMs))
+    {
+        ok = state.root.reportWriter->flush();
+        state.reportFlushTimer.restart();
+    }
+    if (!ok)
+    {
+        // The other roots of a batch go on, the scan stops once no report can be written
+        state.reportFailed.storeRelease(1);
+        locker.unlock();
+        if (allReportsFailed())
+            cancel();
+    }
+}
+
+bool ScanEngine::allReportsFailed() const
+{
+    for (const auto &state : roots)
+    {
+        if (!state->root.reportWriter || !state->reportFailed.loadAcquire())
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef SCANENGINE_H
+#define SCANENGINE_H
+
+#include "ChecksumCalculator.h"
+#include "ScanResults.h"
+#include "ReportWriter.h"
+#include "ScanFilter.h"
+
+#include <QObject>
+#include <QQueue>
+#include <QVector>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+class ScanProfiler;
+
+/// Hashes the files of one or more folders on a shared pool of worker threads.
+/// One thread per folder enumerates it into per size class lanes, the workers drain them:
+/// large files stream on at most half of the workers while the rest serve small files first
+/// (all workers take large files once the other lanes are drained),
+/// and a file only starts once BufferPool::global() has room for its read buffer.
+/// Finished records are collected with takeRecords() from the GUI thread,
+/// or, when a folder has a report writer, written straight to its report and not kept.
+class ScanEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    /// A folder to scan with its own checksum, file filter and, optionally, its own report
+    struct ScanRoot
+    {
+        QString folderPath;
+        ScanFilter filter;
+        QSharedPointer<ChecksumCalculator> calculator;
+        QSharedPointer<ReportWriter> reportWriter;
+        QString reportPath;
+    };
+
+private:
+    enum SIZE_CLASSES
+    {
+        SIZE_SMALL,
+        SIZE_MEDIUM,
+        SIZE_LARGE,
+        SIZE_MAX
+    };
+
+    struct ScanTask
+    {
+        QString fileName;
+        QString filePath;
+        QDateTime lastModified;
+        qint64 size;
+        SIZE_CLASSES sizeClass;
+        qint64 bufferBytes;
+        int root;
+    };
+
+    struct RootState
+    {
+        ScanRoot root;
+        QMutex reportMutex;
+        QElapsedTimer reportFlushTimer;
+        QAtomicInt reportFailed {0};
+    };
+
+    QThreadPool pool;
+    QVector<QSharedPointer<RootState>> roots;
+    QSet<QString> reportFileNames;
+    QSet<QString> reportFilePaths;
+    ScanProfiler *profiler = nullptr;
+
+    QMutex queueMutex;
+    QWaitCondition queueNotEmpty;
+    QQueue<ScanTask> lanes[SIZE_MAX];
+    int queuedTasks = 0;
+    int activeLarge = 0;
+    int largeWorkerLimit = 0;
+    int runningEnumerators = 0;
+
+    QMutex recordsMutex;
+    QVector<ScanRecord> records;
+
+    QAtomicInt runningWorkers {0};
+    QAtomicInt canceled {0};
+
+public:
+    explicit ScanEngine(QObject *parent = nullptr);
+    ~ScanEngine();
+
+    /// Scans all roots at once on threadCount shared workers, so I/O on different devices overlaps
+    bool start(const QVector<ScanRoot> &scanRoots, const int threadCount, ScanProfiler *profiler);
+    void cancel();
+    /// Upper bound for the read buffers of the files hashed at once, the capacity of the shared buffer pool
+    void setMemoryBudget(const qint64 bytes);
+    bool isRunning() const;
+    QVector<ScanRecord> takeRecords();
+    /// False if writing the report of the given root of the last scan failed
+    bool reportOk(const int root = 0) const;
+
+private:
+    void enumerate(const int root);
+    void work();
+    bool takeTask(ScanTask &task, BufferPool::Buffer &buffer);
+    void finishTask(const ScanTask &task);
+    void writeReportRow(RootState &state, const ScanRecord &record);
+    bool allReportsFailed() const;
+
+signals:
+    void signalFinished();
+};
+
+#endif // SCANENGINE_H
@@ -0,0 +1,58 @@
+#include "ScanFilter.h"
+
+#include <QFileInfo>
+
+namespace
+{
+QString sizeText(const qint64 bytes)
+{
+    const qint64 mb = 1024 * 1024;
+    if (bytes > 0 && bytes % mb == 0)
+        return QStringLiteral("%1 MB").arg(bytes / mb);
+    return QStringLiteral("%1 bytes").arg(bytes);
+}
+}
+
+bool ScanFilter::isEmpty() const
+{
+    return namePatterns.isEmpty() && minSize < 0 && maxSize < 0 && !modifiedAfter.isValid();
+}
+
+bool ScanFilter::accepts(const QFileInfo &info) const
+{
+    if (minSize >= 0 || maxSize >= 0)
+    {
+        const qint64 size = info.size();
+        if ((minSize >= 0 && size < minSize) || (maxSize >= 0 && size > maxSize))
+        {
+            return false;
+        }
+    }
+    return !modifiedAfter.isValid() || info.lastModified() >= modifiedAfter;
+}
+
+QString ScanFilter::description() const
+{
+    QStringList parts;
+    if (!namePatterns.isEmpty())
+        parts.append(QStringLiteral("names %1").arg(namePatterns.join(QStringLiteral("; "))));
+    if (minSize >= 0)
+        parts.append(QStringLiteral("size >= %1").arg(sizeText(minSize)));
+    if (maxSize >= 0)
+        parts.append(QStringLiteral("size <= %1").arg(sizeText(maxSize)));
+    if (modifiedAfter.isValid())
+        parts.append(QStringLiteral("modified after %1").arg(modifiedAfter.toString(QStringLiteral("yyyy-MM-dd hh:mm"))));
+    return parts.join(QStringLiteral(", "));
+}
+
+QStringList ScanFilter::parsePatterns(const QString &text)
+{
+    QStringList patterns;
+    for (const auto &part : text.split(QLatin1Char(';'), Qt::SkipEmptyParts))
+    {
+        const QString pattern = part.trimmed();
+        if (!pattern.isEmpty())
+            patterns.append(pattern);
+    }
+    return patterns;
+}
@@ -0,0 +1,31 @@
+#ifndef SCANFILTER_H
+#define SCANFILTER_H
+
+#include <QStringList>
+#include <QDateTime>
+
+class QFileInfo;
+
+/// Selects the files of a scan before they are hashed.
+/// Decided from the directory entry alone (name, size, modification time),
+/// so excluded files are never opened.
+struct ScanFilter
+{
+    /// Wildcards matched against the file name, e.g. *.iso; empty for every name
+    QStringList namePatterns;
+    /// Size bounds in bytes, -1 for no bound
+    qint64 minSize = -1;
+    qint64 maxSize = -1;
+    /// Files last modified before this are skipped, invalid for any date
+    QDateTime modifiedAfter;
+
+    bool isEmpty() const;
+    /// Size and date checks, the name patterns are given to the directory iterator
+    bool accepts(const QFileInfo &info) const;
+    /// One line for report headers, empty if nothing is filtered
+    QString description() const;
+    /// Patterns separated by ';', e.g. "*.iso; *.img"
+    static QStringList parsePatterns(const QString &text);
+};
+
+#endif // SCANFILTER_H
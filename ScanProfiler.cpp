@@ -0,0 +1,237 @@
+#include "ScanProfiler.h"
+
+#include <QFile>
+#include <QMutexLocker>
+#include <QStringList>
+
+namespace
+{
+/// Generations are unique over all profilers, a thread's cached log never matches a new one by chance
+QAtomicInt nextGeneration;
+
+/// For counters that only one thread writes, no locked instruction needed
+void add(QAtomicInteger<qint64> &counter, const qint64 value)
+{
+    counter.storeRelaxed(counter.loadRelaxed() + value);
+}
+
+void raiseTo(QAtomicInteger<qint64> &counter, const qint64 value)
+{
+    qint64 current = counter.loadRelaxed();
+    while (value > current && !counter.testAndSetRelaxed(current, value, current))
+    {
+    }
+}
+}
+
+void ScanProfiler::start(const bool trace)
+{
+    QMutexLocker locker(&mutex);
+    timer.start();
+    stopNs = -1;
+    traceEnabled = trace;
+    logs.clear();
+    generation.storeRelease(nextGeneration.fetchAndAddRelaxed(1) + 1);
+    queueDepth.storeRelaxed(0);
+    maxQueueDepth.storeRelaxed(0);
+    bufferBytes.storeRelaxed(0);
+    maxBufferBytes.storeRelaxed(0);
+    traceEvents.storeRelaxed(0);
+    traceTruncated.storeRelaxed(0);
+}
+
+void ScanProfiler::stop()
+{
+    QMutexLocker locker(&mutex);
+    if (timer.isValid())
+        stopNs = timer.nsecsElapsed();
+}
+
+qint64 ScanProfiler::nowNs() const
+{
+    return timer.isValid() ? timer.nsecsElapsed() : 0;
+}
+
+ScanProfiler::ThreadLog &ScanProfiler::currentLog()
+{
+    struct CachedLog
+    {
+        int generation = 0;
+        QSharedPointer<ThreadLog> log;
+    };
+    static thread_local CachedLog cached;
+    if (cached.log && cached.generation == generation.loadAcquire())
+    {
+        return *cached.log;
+    }
+
+    // First event of this thread in the scan
+    QMutexLocker locker(&mutex);
+    cached.generation = generation.loadRelaxed();
+    cached.log.reset(new ThreadLog);
+    cached.log->index = logs.size() + 1;
+    logs.append(cached.log);
+    return *cached.log;
+}
+
+void ScanProfiler::appendEvent(ThreadLog &log, const Event &event)
+{
+    if (traceEvents.loadRelaxed() < maxTraceEvents && traceEvents.fetchAndAddRelaxed(1) < maxTraceEvents)
+        log.events.append(event);
+    else
+        traceTruncated.storeRelaxed(1);
+}
+
+QVector<QSharedPointer<ScanProfiler::ThreadLog>> ScanProfiler::logsSnapshot() const
+{
+    QMutexLocker locker(&mutex);
+    return logs;
+}
+
+void ScanProfiler::record(const STAGES stage, const qint64 startNs, const qint64 durationNs, const qint64 bytes)
+{
+    ThreadLog &log = currentLog();
+    const uint i = static_cast<uint>(stage);
+    add(log.stageNs[i], durationNs);
+    add(log.stageCount[i], 1);
+    if (stage == STAGES::READ)
+        add(log.bytesRead, bytes);
+    add(log.busyNs, durationNs);
+
+    if (traceEnabled)
+    {
+        const Event event = {startNs, durationNs, bytes, log.index, stage, false};
+        appendEvent(log, event);
+    }
+}
+
+void ScanProfiler::recordFileDone()
+{
+    add(currentLog().filesDone, 1);
+}
+
+void ScanProfiler::recordQueueDepth(const int depth)
+{
+    queueDepth.storeRelaxed(depth);
+    raiseTo(maxQueueDepth, depth);
+    if (traceEnabled)
+    {
+        const Event event = {nowNs(), 0, depth, 0, STAGES::MAX, true};
+        appendEvent(currentLog(), event);
+    }
+}
+
+QString ScanProfiler::stageName(const STAGES stage)
+{
+    switch (stage)
+    {
+    case STAGES::ENUMERATE: return QStringLiteral("enumerate");
+    case STAGES::OPEN:      return QStringLiteral("open");
+    case STAGES::READ:      return QStringLiteral("read");
+    case STAGES::HASH:      return QStringLiteral("hash");
+    case STAGES::UI_INSERT: return QStringLiteral("ui insert");
+    default:                return QString();
+    }
+}
+
+void ScanProfiler::recordBufferUsage(const qint64 bytes, const qint64 peakBytes)
+{
+    bufferBytes.storeRelaxed(bytes);
+    raiseTo(maxBufferBytes, peakBytes);
+}
+
+QString ScanProfiler::summary() const
+{
+    qint64 wallNs;
+    {
+        QMutexLocker locker(&mutex);
+        wallNs = stopNs >= 0 ? stopNs : nowNs();
+    }
+    const QVector<QSharedPointer<ThreadLog>> snapshot = logsSnapshot();
+    qint64 stageNs[static_cast<uint>(STAGES::MAX)] {};
+    qint64 bytesRead = 0;
+    qint64 filesDone = 0;
+    for (const auto &log : snapshot)
+    {
+        for (uint i = 0; i < static_cast<uint>(STAGES::MAX); ++i)
+            stageNs[i] += log->stageNs[i].loadRelaxed();
+        bytesRead += log->bytesRead.loadRelaxed();
+        filesDone += log->filesDone.loadRelaxed();
+    }
+
+    const double wallSec = wallNs > 0 ? wallNs / 1e9 : 1.0;
+    const auto ms = [&stageNs](const STAGES stage) {
+        return QString::number(stageNs[static_cast<uint>(stage)] / 1000000);
+    };
+
+    QString text = QStringLiteral("Файлов: %1 (%2/с)   Чтение: %3 МБ/с   Очередь: %4 (макс. %5)   Буферы: %6 МБ (макс. %7 МБ)\n")
+            .arg(filesDone)
+            .arg(filesDone / wallSec, 0, 'f', 1)
+            .arg(bytesRead / wallSec / (1024 * 1024), 0, 'f', 1)
+            .arg(queueDepth.loadRelaxed())
+            .arg(maxQueueDepth.loadRelaxed())
+            .arg(bufferBytes.loadRelaxed() / (1024.0 * 1024), 0, 'f', 1)
+            .arg(maxBufferBytes.loadRelaxed() / (1024.0 * 1024), 0, 'f', 1);
+    text += QStringLiteral("Этапы, мс: перечисление %1, открытие %2, чтение %3, хеширование %4, таблица %5")
+            .arg(ms(STAGES::ENUMERATE), ms(STAGES::OPEN), ms(STAGES::READ), ms(STAGES::HASH), ms(STAGES::UI_INSERT));
+
+    // The logs are in the order the threads started
+    QStringList load;
+    for (const auto &log : snapshot)
+        load << QStringLiteral("#%1 %2%").arg(log->index).arg(qMin<qint64>(100, log->busyNs.loadRelaxed() * 100 / qMax<qint64>(1, wallNs)));
+    if (!load.isEmpty())
+        text += QStringLiteral("\nЗагрузка потоков: ") + load.join(QStringLiteral(", "));
+    return text;
+}
+
+bool ScanProfiler::writeChromeTrace(const QString &path) const
+{
+    const QVector<QSharedPointer<ThreadLog>> snapshot = logsSnapshot();
+    const bool truncated = traceTruncated.loadRelaxed();
+
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    // ts/dur are microseconds in the trace-event format
+    const auto us = [](const qint64 ns) { return QByteArray::number(ns / 1000.0, 'f', 3); };
+
+    QByteArray buffer;
+    buffer.reserve(1 << 20);
+    buffer += "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"truncated\":";
+    buffer += truncated ? "true" : "false";
+    buffer += "},\"traceEvents\":[\n";
+    buffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"fitch scan\"}}";
+    for (const auto &log : snapshot)
+    {
+        buffer += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(log->index)
+                + ",\"args\":{\"name\":\"thread " + QByteArray::number(log->index) + "\"}}";
+    }
+    for (const auto &log : snapshot)
+    {
+        for (const auto &event : log->events)
+        {
+            if (event.isCounter)
+            {
+                buffer += ",\n{\"name\":\"queue\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" + us(event.startNs)
+                        + ",\"args\":{\"depth\":" + QByteArray::number(event.value) + "}}";
+            }
+            else
+            {
+                buffer += ",\n{\"name\":\"" + stageName(event.stage).toLatin1() + "\",\"cat\":\"scan\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                        + QByteArray::number(event.thread) + ",\"ts\":" + us(event.startNs) + ",\"dur\":" + us(event.durationNs);
+                if (event.value)
+                    buffer += ",\"args\":{\"bytes\":" + QByteArray::number(event.value) + "}";
+                buffer += "}";
+            }
+            if (buffer.size() > (1 << 20) - 512)
+            {
+                if (file.write(buffer) != buffer.size())
+                    return false;
+                buffer.resize(0);
+            }
+        }
+    }
+    buffer += "\n]}\n";
+    return file.write(buffer) == buffer.size() && file.flush();
+}
@@ -0,0 +1,118 @@
+#ifndef SCANPROFILER_H
+#define SCANPROFILER_H
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+
+/// Collects per-stage timings of the scan pipeline. Thread-safe: workers record
+/// their own stages, the GUI thread reads the summary while the scan runs.
+/// Every thread counts into a log of its own, so recording takes no lock.
+/// Trace events are only kept when the scan is started with tracing on.
+class ScanProfiler
+{
+public:
+    enum class STAGES : uint
+    {
+        ENUMERATE,
+        OPEN,
+        READ,
+        HASH,
+        UI_INSERT,
+
+        MAX
+    };
+
+    /// Records the lifetime of the object as one event of the given stage
+    class Scope
+    {
+        ScanProfiler *profiler;
+        const STAGES stage;
+        const qint64 startNs;
+        qint64 bytes = 0;
+
+    public:
+        Scope(ScanProfiler *profiler, const STAGES stage)
+            : profiler(profiler)
+            , stage(stage)
+            , startNs(profiler ? profiler->nowNs() : 0)
+        {
+        }
+        ~Scope()
+        {
+            if (profiler)
+                profiler->record(stage, startNs, profiler->nowNs() - startNs, bytes);
+        }
+        void setBytes(const qint64 value) { bytes = value; }
+    };
+
+    ScanProfiler() = default;
+
+    /// trace keeps every event for writeChromeTrace(), which costs memory on large scans
+    void start(const bool trace = false);
+    void stop();
+    bool tracing() const { return traceEnabled; }
+    qint64 nowNs() const;
+
+    void record(const STAGES stage, const qint64 startNs, const qint64 durationNs, const qint64 bytes = 0);
+    void recordFileDone();
+    void recordQueueDepth(const int depth);
+    /// Read buffer memory in use now and at most so far, from the BufferPool
+    void recordBufferUsage(const qint64 bytes, const qint64 peakBytes);
+
+    QString summary() const;
+    /// Only once the scan is over, the threads append to their events unlocked
+    bool writeChromeTrace(const QString &path) const;
+
+    static QString stageName(const STAGES stage);
+
+private:
+    struct Event
+    {
+        qint64 startNs;
+        qint64 durationNs;
+        qint64 value;
+        int thread;
+        STAGES stage;
+        bool isCounter;
+    };
+
+    /// Written by its own thread only. The counters are atomic so the summary can read them meanwhile
+    struct ThreadLog
+    {
+        int index = 0;
+        QAtomicInteger<qint64> busyNs;
+        QAtomicInteger<qint64> stageNs[static_cast<uint>(STAGES::MAX)];
+        QAtomicInteger<qint64> stageCount[static_cast<uint>(STAGES::MAX)];
+        QAtomicInteger<qint64> bytesRead;
+        QAtomicInteger<qint64> filesDone;
+        QVector<Event> events;
+    };
+
+    ThreadLog &currentLog();
+    void appendEvent(ThreadLog &log, const Event &event);
+    QVector<QSharedPointer<ThreadLog>> logsSnapshot() const;
+
+    /// Beyond this the totals keep counting, but the trace only keeps the head of the scan
+    const int maxTraceEvents = 2000000;
+
+    /// Guards logs and stopNs, taken once per thread and scan
+    mutable QMutex mutex;
+    QElapsedTimer timer;
+    qint64 stopNs = -1;
+    bool traceEnabled = false;
+    /// Tells the threads' cached logs of an earlier scan from the current ones
+    QAtomicInt generation;
+    QVector<QSharedPointer<ThreadLog>> logs;
+    QAtomicInteger<qint64> queueDepth;
+    QAtomicInteger<qint64> maxQueueDepth;
+    QAtomicInteger<qint64> bufferBytes;
+    QAtomicInteger<qint64> maxBufferBytes;
+    QAtomicInt traceEvents;
+    QAtomicInt traceTruncated;
+};
+
+#endif // SCANPROFILER_H
@@ -0,0 +1,140 @@
+#ifndef SCANRESULTS_H
+#define SCANRESULTS_H
+
+#include "Digest.h"
+
+#include <QString>
+#include <QDateTime>
+#include <QVector>
+#include <QSet>
+
+#include <algorithm>
+#include <limits>
+
+struct ScanRecord
+{
+    QString fileName;
+    QString filePath;
+    QDateTime lastModified;
+    qint64 size = 0;
+    Digest checksum;
+    /// Set by the mirror comparison only, sizes of missing files are -1
+    QString status;
+    Digest mirrorChecksum;
+    qint64 mirrorSize = -1;
+};
+
+/// Records of one scan in table order.
+/// Filled on the GUI thread while the scan runs and read-only afterwards,
+/// so report exports can read it from worker threads without locking.
+/// Kept compact for million-file scans: digests stay binary, the path is stored as
+/// its folder plus the name, and equal names and folders share one interned string.
+class ScanResults
+{
+    struct Entry
+    {
+        QString fileName;
+        /// filePath without fileName, shared by every file of the folder
+        QString directory;
+        qint64 lastModifiedMs;
+        qint64 size;
+        Digest checksum;
+        /// Index in mirrorEntries, -1 for plain scan records
+        int mirror;
+    };
+
+    struct MirrorEntry
+    {
+        QString status;
+        Digest checksum;
+        qint64 size;
+    };
+
+    QVector<Entry> entries;
+    QVector<MirrorEntry> mirrorEntries;
+    QSet<QString> strings;
+
+public:
+    ScanResults() = default;
+
+    void append(const QVector<ScanRecord> &newRecords)
+    {
+        entries.reserve(entries.size() + newRecords.size());
+        for (const auto &record : newRecords)
+        {
+            Entry entry;
+            entry.fileName = intern(record.fileName);
+            const bool nameInPath = record.filePath.endsWith(record.fileName);
+            entry.directory = intern(nameInPath ? record.filePath.left(record.filePath.size() - record.fileName.size())
+                                                : record.filePath + QLatin1Char('\0'));
+            entry.lastModifiedMs = record.lastModified.isValid() ? record.lastModified.toMSecsSinceEpoch()
+                                                                 : invalidTime();
+            entry.size = record.size;
+            entry.checksum = record.checksum;
+            entry.mirror = -1;
+            if (!record.status.isEmpty())
+            {
+                MirrorEntry mirror;
+                mirror.status = intern(record.status);
+                mirror.checksum = record.mirrorChecksum;
+                mirror.size = record.mirrorSize;
+                entry.mirror = mirrorEntries.size();
+                mirrorEntries.append(mirror);
+            }
+            entries.append(entry);
+        }
+    }
+
+    /// Same order as QTableWidget::sortItems() on the name column.
+    /// Called once the scan is complete, also drops the interning table.
+    void sort()
+    {
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.fileName.localeAwareCompare(b.fileName) < 0;
+        });
+        entries.squeeze();
+        mirrorEntries.squeeze();
+        strings.clear();
+        strings.squeeze();
+    }
+
+    int size() const { return entries.size(); }
+    bool isEmpty() const { return entries.isEmpty(); }
+
+    /// The record is built on demand, its strings share the stored ones
+    ScanRecord at(const int i) const
+    {
+        const Entry &entry = entries.at(i);
+        ScanRecord record;
+        record.fileName = entry.fileName;
+        // A directory ending in '\0' is a whole path that does not end with the name
+        record.filePath = entry.directory.endsWith(QLatin1Char('\0')) ? entry.directory.chopped(1)
+                                                                       : entry.directory + entry.fileName;
+        if (entry.lastModifiedMs != invalidTime())
+            record.lastModified = QDateTime::fromMSecsSinceEpoch(entry.lastModifiedMs);
+        record.size = entry.size;
+        record.checksum = entry.checksum;
+        if (entry.mirror >= 0)
+        {
+            const MirrorEntry &mirror = mirrorEntries.at(entry.mirror);
+            record.status = mirror.status;
+            record.mirrorChecksum = mirror.checksum;
+            record.mirrorSize = mirror.size;
+        }
+        return record;
+    }
+
+private:
+    static qint64 invalidTime() { return std::numeric_limits<qint64>::min(); }
+
+    QString intern(const QString &text)
+    {
+        const auto it = strings.constFind(text);
+        if (it != strings.constEnd())
+            return *it;
+        strings.insert(text);
+        return text;
+    }
+};
+
+#endif // SCANRESULTS_H
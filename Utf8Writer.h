@@ -0,0 +1,171 @@
+#ifndef UTF8WRITER_H
+#define UTF8WRITER_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+#include <cstring>
+
+/// Buffered UTF-8 text writer. Encodes QString straight into its own buffer,
+/// so a row costs no allocations (unlike QTextStream or QString::toUtf8()).
+class Utf8Writer
+{
+    QFile file;
+    QByteArray buffer;
+    char *data;
+    int used = 0;
+    bool failed = false;
+
+public:
+    explicit Utf8Writer(const int capacity = 1 << 20)
+        : buffer(capacity, Qt::Uninitialized)
+        , data(buffer.data())
+    {
+    }
+
+    bool open(const QString &path, const QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Truncate)
+    {
+        file.setFileName(path);
+        used = 0;
+        failed = false;
+        return file.open(mode);
+    }
+
+    bool flush()
+    {
+        writeBuffer();
+        return !failed && file.flush();
+    }
+
+    bool close()
+    {
+        const bool ok = flush();
+        file.close();
+        return ok;
+    }
+
+    bool hasError() const { return failed; }
+
+    void append(const char c)
+    {
+        reserve(1);
+        data[used++] = c;
+    }
+
+    void append(const char *text, const int len)
+    {
+        if (len > buffer.size())
+        {
+            writeBuffer();
+            failed = failed || file.write(text, len) != len;
+            return;
+        }
+        reserve(len);
+        std::memcpy(data + used, text, static_cast<size_t>(len));
+        used += len;
+    }
+
+    void append(const QString &text)
+    {
+        const int len = text.size();
+        if (len * 3 > buffer.size())
+        {
+            const QByteArray utf8 = text.toUtf8();
+            append(utf8.constData(), utf8.size());
+            return;
+        }
+        reserve(len * 3);
+        const ushort *src = text.utf16();
+        char *dst = data + used;
+        for (int i = 0; i < len; ++i)
+        {
+            uint c = src[i];
+            if (c < 0x80)
+            {
+                *dst++ = static_cast<char>(c);
+            }
+            else if (c < 0x800)
+            {
+                *dst++ = static_cast<char>(0xc0 | (c >> 6));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3f));
+            }
+            else if (QChar::isHighSurrogate(c) && i + 1 < len && QChar::isLowSurrogate(src[i + 1]))
+            {
+                c = QChar::surrogateToUcs4(static_cast<ushort>(c), src[++i]);
+                *dst++ = static_cast<char>(0xf0 | (c >> 18));
+                *dst++ = static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+                *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3f));
+            }
+            else
+            {
+                if (QChar::isSurrogate(c))
+                    c = QChar::ReplacementCharacter;
+                *dst++ = static_cast<char>(0xe0 | (c >> 12));
+                *dst++ = static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                *dst++ = static_cast<char>(0x80 | (c & 0x3f));
+            }
+        }
+        used = static_cast<int>(dst - data);
+    }
+
+    void appendSpaces(int count)
+    {
+        while (count > 0)
+        {
+            const int chunk = qMin(count, buffer.size());
+            reserve(chunk);
+            std::memset(data + used, ' ', static_cast<size_t>(chunk));
+            used += chunk;
+            count -= chunk;
+        }
+    }
+
+    /// Pads to at least width characters like QTextStream field widths do, never truncates
+    void appendPadded(const QString &text, const int width, const bool alignRight = false)
+    {
+        const int padding = width - text.size();
+        if (alignRight)
+            appendSpaces(padding);
+        append(text);
+        if (!alignRight)
+            appendSpaces(padding);
+    }
+
+    void appendNumber(const qint64 value) { appendPaddedNumber(value, 0); }
+
+    /// Right-aligned in a field of width characters
+    void appendPaddedNumber(const qint64 value, const int width)
+    {
+        char digits[24];
+        int n = sizeof(digits);
+        quint64 v = value < 0 ? 0 - static_cast<quint64>(value) : static_cast<quint64>(value);
+        do
+        {
+            digits[--n] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        if (value < 0)
+            digits[--n] = '-';
+        const int len = static_cast<int>(sizeof(digits)) - n;
+        appendSpaces(width - len);
+        append(digits + n, len);
+    }
+
+private:
+    void reserve(const int len)
+    {
+        if (used + len > buffer.size())
+            writeBuffer();
+    }
+
+    void writeBuffer()
+    {
+        if (used > 0 && !failed)
+            failed = file.write(data, used) != used;
+        used = 0;
+    }
+};
+
+#endif // UTF8WRITER_H
@@ -0,0 +1,13 @@
+QT       -= gui
+
+CONFIG += c++11
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = cacheadvisor
+
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp
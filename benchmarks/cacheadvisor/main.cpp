@@ -0,0 +1,182 @@
+/// Measures what the cache-polite read mode costs and what it saves.
+///
+/// A "hot" file stands for the working set of another program and is read into the page cache,
+/// as is the first quarter of the "scan" file. The scan file is then read the way a scan reads it,
+/// once plainly and once through CacheAdvisor. For each mode the output has:
+/// - the read speed of the scan,
+/// - how much of the hot file and of the quarter cached before the scan is still cached after it,
+/// - how much of the rest of the scan file the scan left in the cache,
+/// - how long reading the hot file again takes.
+///
+/// Usage: cacheadvisor [directory] [scan MB] [hot MB]
+/// The files are created in directory (default /var/tmp) and kept for the next run.
+/// Without memory pressure a plain scan evicts nothing, so run it in a memory limited cgroup
+/// to see the difference, with a limit below scan + hot, e.g.
+///     systemd-run --user --scope -p MemoryMax=768M ./cacheadvisor /var/tmp 2048 256
+/// Linux only.
+
+#include "CacheAdvisor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+const qint64 megabyte = 1024 * 1024;
+/// The read size of ChecksumCalculator
+const size_t readChunkSize = 1024 * 1024;
+
+double secondsSince(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// Writes size bytes of noise to path unless the file has that size already
+bool makeFile(const std::string &path, const qint64 size)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) == 0 && info.st_size == size)
+    {
+        return true;
+    }
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::vector<char> chunk(readChunkSize);
+    quint32 seed = 0x12345678;
+    bool ok = true;
+    for (qint64 written = 0; ok && written < size; written += static_cast<qint64>(chunk.size()))
+    {
+        for (auto &byte : chunk)
+        {
+            seed = seed * 1664525 + 1013904223;
+            byte = static_cast<char>(seed >> 24);
+        }
+        ok = ::write(fd, chunk.data(), chunk.size()) == static_cast<ssize_t>(chunk.size());
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+/// Reads [0, length) of the file, through a CacheAdvisor if polite. Returns the seconds taken
+double readFile(const std::string &path, const qint64 length, const bool polite)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    std::vector<char> buffer(readChunkSize);
+    const auto start = std::chrono::steady_clock::now();
+    {
+        CacheAdvisor cacheAdvisor(fd, polite);
+        qint64 position = 0;
+        while (position < length)
+        {
+            const ssize_t len = ::read(fd, buffer.data(), buffer.size());
+            if (len <= 0)
+            {
+                break;
+            }
+            position += len;
+            cacheAdvisor.advance(position);
+        }
+        cacheAdvisor.finish();
+    }
+    const double seconds = secondsSince(start);
+    ::close(fd);
+    return seconds;
+}
+
+/// Drops the pages of [from, EOF) from the page cache
+void evict(const std::string &path, const qint64 from = 0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        ::posix_fadvise(fd, from, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+}
+
+/// Percentage of the pages of [from, to) in the page cache
+double cachedPercent(const std::string &path, const qint64 from, const qint64 to)
+{
+    const qint64 pageSize = ::sysconf(_SC_PAGESIZE);
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0 || to <= from)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        return -1;
+    }
+    const qint64 begin = from / pageSize * pageSize;
+    const size_t length = static_cast<size_t>(to - begin);
+    std::vector<unsigned char> pages((length + pageSize - 1) / pageSize);
+    void *map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, begin);
+    double percent = -1;
+    if (map != MAP_FAILED)
+    {
+        if (::mincore(map, length, pages.data()) == 0)
+        {
+            size_t cached = 0;
+            for (const unsigned char page : pages)
+                cached += page & 1;
+            percent = 100.0 * cached / pages.size();
+        }
+        ::munmap(map, length);
+    }
+    ::close(fd);
+    return percent;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::string directory = argc > 1 ? argv[1] : "/var/tmp";
+    const qint64 scanSize = (argc > 2 ? std::atoll(argv[2]) : 1024) * megabyte;
+    const qint64 hotSize = (argc > 3 ? std::atoll(argv[3]) : 256) * megabyte;
+    const qint64 warmSize = scanSize / 4 / megabyte * megabyte;
+    const std::string scanPath = directory + "/cacheadvisor-scan.bin";
+    const std::string hotPath = directory + "/cacheadvisor-hot.bin";
+    if (scanSize <= 0 || hotSize <= 0 || !makeFile(scanPath, scanSize) || !makeFile(hotPath, hotSize))
+    {
+        std::fprintf(stderr, "Can not create the files in %s\n", directory.c_str());
+        return 1;
+    }
+
+    std::printf("scan %lld MB, hot %lld MB, %lld MB of the scan file cached before the scan\n\n",
+                scanSize / megabyte, hotSize / megabyte, warmSize / megabyte);
+    std::printf("%-8s %12s %12s %12s %12s %14s\n", "mode", "scan MB/s", "hot cached", "warm cached",
+                "scan cached", "hot reread s");
+    for (const bool polite : {false, true})
+    {
+        // The same start for both modes: the hot file and the warm part of the scan file cached
+        evict(scanPath);
+        evict(hotPath);
+        readFile(hotPath, hotSize, false);
+        readFile(scanPath, warmSize, false);
+        // Without what the kernel read ahead of the warm part
+        evict(scanPath, warmSize);
+
+        const double scanSeconds = readFile(scanPath, scanSize, polite);
+        const double hotCached = cachedPercent(hotPath, 0, hotSize);
+        const double warmCached = cachedPercent(scanPath, 0, warmSize);
+        const double scanCached = cachedPercent(scanPath, warmSize, scanSize);
+        const double rereadSeconds = readFile(hotPath, hotSize, false);
+        std::printf("%-8s %12.0f %11.1f%% %11.1f%% %11.1f%% %14.3f\n", polite ? "polite" : "plain",
+                    scanSize / megabyte / scanSeconds, hotCached, warmCached, scanCached, rereadSeconds);
+    }
+    return 0;
+}
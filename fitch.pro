@@ -11,11 +11,31 @@ CONFIG += c++11
 include(qtxlsx/src/xlsx/qtxlsx.pri)
 
 SOURCES += \
+    BufferPool.cpp \
+    KernelHash.cpp \
+    MirrorComparer.cpp \
+    ReportExporter.cpp \
+    ReportWriter.cpp \
+    ScanEngine.cpp \
+    ScanFilter.cpp \
+    ScanProfiler.cpp \
     main.cpp \
     mainwindow.cpp
 
 HEADERS += \
+    BufferPool.h \
+    CacheAdvisor.h \
     ChecksumCalculator.h \
+    Digest.h \
+    KernelHash.h \
+    MirrorComparer.h \
+    ReportExporter.h \
+    ReportWriter.h \
+    ScanEngine.h \
+    ScanFilter.h \
+    ScanProfiler.h \
+    ScanResults.h \
+    Utf8Writer.h \
     mainwindow.h
 
 FORMS += \
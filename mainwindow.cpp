@@ -1,19 +1,48 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
-#include "xlsxdocument.h"
-
 #include <QFileDialog>
 #include <QDateTime>
 #include <QMessageBox>
 #include <QFile>
 #include <QTimer>
-#include <QTextStream>
 #include <QDesktopServices>
+#include <QThread>
+#include <QMenu>
+#include <QTemporaryFile>
+#include <QStatusBar>
 
 #define SETTINGS_LAST_PATH      "last_path"
 #define SETTINGS_CHECKSUM_TYPE  "checksum_type"
 #define SETTINGS_OPEN_REPORT    "open_report"
+#define SETTINGS_CACHE_POLITE   "cache_polite"
+#define SETTINGS_TRACE          "trace"
+#define SETTINGS_THREAD_COUNT   "thread_count"
+#define SETTINGS_MEMORY_BUDGET  "memory_budget_mb"
+#define SETTINGS_SCAN_TO        "scan_to"
+#define SETTINGS_KERNEL_HASH    "kernel_hash"
+#define SETTINGS_LAST_BATCH     "last_batch"
+#define SETTINGS_FILTER_NAMES   "filter_names"
+#define SETTINGS_FILTER_MIN_MB  "filter_min_size_mb"
+#define SETTINGS_FILTER_MAX_MB  "filter_max_size_mb"
+#define SETTINGS_FILTER_DAYS    "filter_days"
+
+#define BATCH_ROOTS             "roots"
+#define BATCH_PATH              "path"
+#define BATCH_CHECKSUM          "checksum"
+#define BATCH_FORMAT            "format"
+#define BATCH_REPORT            "report"
+
+#define MAX_THREAD_COUNT        64
+#define MIN_MEMORY_BUDGET_MB    4
+#define MAX_MEMORY_BUDGET_MB    4096
+#define DEFAULT_MEMORY_BUDGET_MB 32
+#define COLLECT_INTERVAL_MS     200
+#define BENCHMARK_FILE_SIZE     (4 * 1024 * 1024)
+#define BENCHMARK_ROUNDS        2
+#define MAX_FILTER_SIZE_MB      (64 * 1024 * 1024)
+#define MAX_FILTER_DAYS         36500
+#define MESSAGE_TIMEOUT_MS      5000
 
 #define MAJOR_VERSION 1
 #define MINOR_VERSION 2
@@ -22,6 +51,7 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , collectTimer(new QTimer(this))
 {
     ui->setupUi(this);
     setWindowTitle(QStringLiteral("%1 %2.%3").arg(windowTitle()).arg(MAJOR_VERSION).arg(MINOR_VERSION));
@@ -38,6 +68,16 @@ MainWindow::MainWindow(QWidget *parent)
     ui->toXlsx_toolButton->setToolTip(QStringLiteral("Экспорт в .xlsx"));
     ui->toXlsx_toolButton->setStyleSheet(QStringLiteral("border: 0;"));
 
+    auto exportMenu = new QMenu(this);
+    exportMenu->addAction(QStringLiteral("CSV"), this, [this]() { exportReport(CSV_EXPORT); });
+    exportMenu->addAction(QStringLiteral("JSON Lines"), this, [this]() { exportReport(JSONL_EXPORT); });
+    exportMenu->addAction(QStringLiteral("md5sum/sha1sum"), this, [this]() { exportReport(DIGEST_EXPORT); });
+    ui->toOther_toolButton->setMenu(exportMenu);
+    ui->toOther_toolButton->setPopupMode(QToolButton::InstantPopup);
+    ui->toOther_toolButton->setIcon(QIcon(QStringLiteral(":/img/img/txt.svg")));
+    ui->toOther_toolButton->setToolTip(QStringLiteral("Экспорт в другие форматы"));
+    ui->toOther_toolButton->setStyleSheet(QStringLiteral("border: 0;"));
+
     ui->tableWidget->horizontalHeader()->setSectionResizeMode(COL_NAME, QHeaderView::Stretch);
     ui->tableWidget->horizontalHeader()->setSectionResizeMode(COL_DATE_TIME, QHeaderView::Fixed);
     ui->tableWidget->setColumnWidth(COL_DATE_TIME, 150);
@@ -54,13 +94,60 @@ MainWindow::MainWindow(QWidget *parent)
         ui->checksum_comboBox->setCurrentIndex(0);
     const bool open_report = settings->value(SETTINGS_OPEN_REPORT, 0).toBool();
     ui->open_checkBox->setCheckState(open_report ? Qt::Checked : Qt::Unchecked);
+    const bool cache_polite = settings->value(SETTINGS_CACHE_POLITE, 0).toBool();
+    ui->cachePolite_checkBox->setCheckState(cache_polite ? Qt::Checked : Qt::Unchecked);
+    const bool trace = settings->value(SETTINGS_TRACE, 0).toBool();
+    ui->trace_checkBox->setCheckState(trace ? Qt::Checked : Qt::Unchecked);
+    ui->threads_spinBox->setRange(1, MAX_THREAD_COUNT);
+    ui->threads_spinBox->setToolTip(QStringLiteral("Потоков хеширования"));
+    ui->threads_spinBox->setValue(settings->value(SETTINGS_THREAD_COUNT, QThread::idealThreadCount()).toInt());
+    ui->memoryBudget_spinBox->setRange(MIN_MEMORY_BUDGET_MB, MAX_MEMORY_BUDGET_MB);
+    ui->memoryBudget_spinBox->setToolTip(QStringLiteral("Память под буферы чтения файлов, хешируемых одновременно"));
+    ui->memoryBudget_spinBox->setValue(settings->value(SETTINGS_MEMORY_BUDGET, DEFAULT_MEMORY_BUDGET_MB).toInt());
+    ui->scanTo_comboBox->addItem(QStringLiteral("в таблицу"), static_cast<int>(NO_EXPORT));
+    ui->scanTo_comboBox->addItem(QStringLiteral("сразу в .txt"), static_cast<int>(TXT_EXPORT));
+    ui->scanTo_comboBox->addItem(QStringLiteral("сразу в .xlsx"), static_cast<int>(XLSX_EXPORT));
+    // The sheet is streamed, but the package is only complete once the scan is done
+    ui->scanTo_comboBox->setItemData(ui->scanTo_comboBox->count() - 1,
+                                     QStringLiteral("Прерванный отчет .xlsx не открывается, в отличие от .txt, .csv и .jsonl"),
+                                     Qt::ToolTipRole);
+    ui->scanTo_comboBox->addItem(QStringLiteral("сразу в .csv"), static_cast<int>(CSV_EXPORT));
+    ui->scanTo_comboBox->addItem(QStringLiteral("сразу в .jsonl"), static_cast<int>(JSONL_EXPORT));
+    ui->scanTo_comboBox->addItem(QStringLiteral("сразу в md5sum/sha1sum"), static_cast<int>(DIGEST_EXPORT));
+    ui->scanTo_comboBox->setToolTip(QStringLiteral("Куда писать результаты сканирования"));
+    const int scanToIndex = ui->scanTo_comboBox->findData(settings->value(SETTINGS_SCAN_TO, static_cast<int>(NO_EXPORT)).toInt());
+    ui->scanTo_comboBox->setCurrentIndex(qMax(0, scanToIndex));
+    ui->filter_lineEdit->setText(settings->value(SETTINGS_FILTER_NAMES).toString());
+    ui->minSize_spinBox->setRange(0, MAX_FILTER_SIZE_MB);
+    ui->minSize_spinBox->setValue(settings->value(SETTINGS_FILTER_MIN_MB, 0).toInt());
+    ui->maxSize_spinBox->setRange(0, MAX_FILTER_SIZE_MB);
+    ui->maxSize_spinBox->setSpecialValueText(QStringLiteral("любой размер"));
+    ui->maxSize_spinBox->setValue(settings->value(SETTINGS_FILTER_MAX_MB, 0).toInt());
+    ui->modifiedDays_spinBox->setRange(0, MAX_FILTER_DAYS);
+    ui->modifiedDays_spinBox->setSpecialValueText(QStringLiteral("любая дата"));
+    ui->modifiedDays_spinBox->setValue(settings->value(SETTINGS_FILTER_DAYS, 0).toInt());
+    ui->trace_pushButton->setEnabled(false);
+    ui->export_progressBar->setVisible(false);
+    ui->cancelExport_pushButton->setVisible(false);
+
+    collectTimer->setInterval(COLLECT_INTERVAL_MS);
 
     connect(ui->browse_pushButton, &QPushButton::clicked, this, &MainWindow::slotBrowse);
     connect(ui->scan_toolButton, &QToolButton::clicked, this, &MainWindow::slotScan);
     connect(ui->toTxt_toolButton, &QToolButton::clicked, this, &MainWindow::slotWriteTxt);
     connect(ui->toXlsx_toolButton, &QToolButton::clicked, this, &MainWindow::slotWriteXlsx);
     connect(ui->path_lineEdit, &QLineEdit::textChanged, this, &MainWindow::slotPathChanged);
+    connect(ui->trace_pushButton, &QPushButton::clicked, this, &MainWindow::slotWriteTrace);
+    connect(ui->batch_pushButton, &QPushButton::clicked, this, &MainWindow::slotBatch);
+    connect(ui->compare_pushButton, &QPushButton::clicked, this, &MainWindow::slotCompare);
     connect(this, &MainWindow::signalReportFileWritten, this, &MainWindow::slotReportFileWritten);
+    connect(collectTimer, &QTimer::timeout, this, &MainWindow::slotCollectRecords);
+    connect(scanEngine.data(), &ScanEngine::signalFinished, this, &MainWindow::slotScanFinished);
+    connect(mirrorComparer.data(), &MirrorComparer::signalFinished, this, &MainWindow::slotScanFinished);
+    connect(reportExporter.data(), &ReportExporter::signalProgress, this, &MainWindow::slotExportProgress);
+    connect(reportExporter.data(), &ReportExporter::signalFinished, this, &MainWindow::slotExportFinished);
+    connect(reportExporter.data(), &ReportExporter::signalCanceled, this, &MainWindow::slotExportCanceled);
+    connect(ui->cancelExport_pushButton, &QPushButton::clicked, reportExporter.data(), &ReportExporter::cancelAll);
 
     auto lastPath = settings->value(SETTINGS_LAST_PATH, "").toString();
     if (lastPath.isEmpty())
@@ -70,31 +157,189 @@ MainWindow::MainWindow(QWidget *parent)
     ui->path_lineEdit->setText(lastPath);
 
     setTxtXlsxEnabled();
+    selectHashBackends();
 }
 
 MainWindow::~MainWindow()
 {
+    benchmarkPool.waitForDone();
     settings->setValue(SETTINGS_OPEN_REPORT, ui->open_checkBox->checkState() == Qt::Checked ? 1 : 0);
+    settings->setValue(SETTINGS_CACHE_POLITE, ui->cachePolite_checkBox->checkState() == Qt::Checked ? 1 : 0);
+    settings->setValue(SETTINGS_TRACE, ui->trace_checkBox->checkState() == Qt::Checked ? 1 : 0);
     delete ui;
 }
 
+/// Every format can be exported while the others are, but not twice at once
 void MainWindow::setTxtXlsxEnabled()
 {
-    ui->toTxt_toolButton->setEnabled(ui->tableWidget->rowCount() > 0);
-    ui->toXlsx_toolButton->setEnabled(ui->tableWidget->rowCount() > 0);
+    const bool enabled = ui->tableWidget->rowCount() > 0 && !scanRunning();
+    ui->toTxt_toolButton->setEnabled(enabled && !exportRunning(TXT_EXPORT));
+    ui->toXlsx_toolButton->setEnabled(enabled && !exportRunning(XLSX_EXPORT));
+    ui->toOther_toolButton->setEnabled(enabled && !exportRunning(CSV_EXPORT) && !exportRunning(JSONL_EXPORT)
+                                       && !exportRunning(DIGEST_EXPORT));
 }
 
-QString MainWindow::createSavePath(const EXPORT_MODES mode)
+bool MainWindow::exportRunning(const EXPORT_MODES mode) const
+{
+    for (const auto &running : runningExports)
+    {
+        if (running.mode == mode)
+            return true;
+    }
+    return false;
+}
+
+/// One progress bar for all running exports
+void MainWindow::updateExportProgress()
+{
+    int done = 0;
+    int total = 0;
+    for (const auto &running : runningExports)
+    {
+        done += running.done;
+        total += running.total;
+    }
+    ui->export_progressBar->setRange(0, qMax(1, total));
+    ui->export_progressBar->setValue(done);
+    ui->export_progressBar->setVisible(!runningExports.isEmpty());
+    ui->cancelExport_pushButton->setVisible(!runningExports.isEmpty());
+}
+
+/// Times the kernel crypto backend against the user-space one on a temporary file
+/// and remembers the faster one for every checksum type.
+/// The benchmark runs in the background, scans started before it is done use the user-space backend.
+void MainWindow::selectHashBackends()
+{
+    if (!settings->value(SETTINGS_KERNEL_HASH, 1).toBool())
+    {
+        return;
+    }
+
+    benchmarkPool.setMaxThreadCount(1);
+    benchmarkPool.start([this]() {
+        const QVector<bool> backends = benchmarkHashBackends();
+        QMetaObject::invokeMethod(this, [this, backends]() {
+            QStringList kernelNames;
+            for (int type = 0; type < backends.size(); ++type)
+            {
+                kernelBackends[type] = backends.at(type);
+                if (backends.at(type))
+                    kernelNames.append(makeChecksumCalculator(static_cast<ChecksumCalculator::CHECKSUM_TYPES>(type))->name());
+            }
+            if (!kernelNames.isEmpty() && !scanRunning())
+            {
+                ui->stats_label->setText(QStringLiteral("Хеширование в ядре: %1").arg(kernelNames.join(QStringLiteral(", "))));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+/// Runs on benchmarkPool, true for the checksum types the kernel backend hashes faster and to the same digest
+QVector<bool> MainWindow::benchmarkHashBackends()
+{
+    QVector<bool> backends(static_cast<int>(ChecksumCalculator::CHECKSUM_TYPES::MAX), false);
+    QVector<QSharedPointer<ChecksumCalculator>> kernelCalculators;
+    bool anyKernel = false;
+    for (uint type = 0; type < static_cast<uint>(ChecksumCalculator::CHECKSUM_TYPES::MAX); ++type)
+    {
+        auto calculator = makeChecksumCalculator(static_cast<ChecksumCalculator::CHECKSUM_TYPES>(type));
+        if (!calculator || !calculator->setKernelBackend(true))
+            calculator.reset();
+        anyKernel = anyKernel || calculator;
+        kernelCalculators.append(calculator);
+    }
+    if (!anyKernel)
+    {
+        return backends;
+    }
+
+    QTemporaryFile file;
+    if (!file.open())
+    {
+        return backends;
+    }
+    QByteArray data(BENCHMARK_FILE_SIZE, Qt::Uninitialized);
+    quint32 seed = 0x12345678;
+    for (auto &byte : data)
+    {
+        seed = seed * 1664525 + 1013904223;
+        byte = static_cast<char>(seed >> 24);
+    }
+    if (file.write(data) != data.size() || !file.flush())
+    {
+        return backends;
+    }
+
+    for (int type = 0; type < kernelCalculators.size(); ++type)
+    {
+        const auto &calculator = kernelCalculators.at(type);
+        if (!calculator)
+        {
+            continue;
+        }
+        Digest kernelDigest;
+        Digest userDigest;
+        const qint64 kernelNs = calculator->benchmark(file.fileName(), BENCHMARK_ROUNDS, &kernelDigest);
+        calculator->setKernelBackend(false);
+        const qint64 userNs = calculator->benchmark(file.fileName(), BENCHMARK_ROUNDS, &userDigest);
+        // A kernel driver that hashes differently, e.g. another CRC32 seed, would corrupt every checksum
+        backends[type] = kernelNs > 0 && userNs > 0 && kernelDigest == userDigest && kernelNs < userNs;
+    }
+    return backends;
+}
+
+bool MainWindow::scanRunning() const
+{
+    return scanEngine->isRunning() || mirrorComparer->isRunning();
+}
+
+void MainWindow::setScanStarted()
+{
+    setCursor(Qt::BusyCursor);
+    ui->scan_toolButton->setEnabled(false);
+    ui->batch_pushButton->setEnabled(false);
+    ui->compare_pushButton->setEnabled(false);
+    ui->trace_pushButton->setEnabled(false);
+    setTxtXlsxEnabled();
+    collectTimer->start();
+}
+
+void MainWindow::insertRecords(const QVector<ScanRecord> &records)
+{
+    int row = ui->tableWidget->rowCount();
+    ui->tableWidget->setRowCount(row + records.size());
+    for (const auto &record : records)
+    {
+        {
+            auto item = new QTableWidgetItem();
+            item->setFlags(item->flags() &~Qt::ItemIsEditable);
+            item->setText(record.status.isEmpty() ? record.fileName
+                                                  : QStringLiteral("%1  [%2]").arg(record.fileName, record.status));
+
+            ui->tableWidget->setItem(row, COL_NAME, item);
+        }
+        {
+            QDateTime dateTime(record.lastModified.date(), record.lastModified.time());
+            auto item = new QTableWidgetItem();
+            item->setFlags(item->flags() &~Qt::ItemIsEditable);
+            item->setTextAlignment(Qt::AlignCenter);
+            item->setData(ROLE_DATE_TIME, dateTime);
+            item->setText(dateTime.date().toString(QStringLiteral("dd.MM.yyyy"))
+                          + QStringLiteral("  ") + dateTime.time().toString(QStringLiteral("hh:mm")));
+            ui->tableWidget->setItem(row, COL_DATE_TIME, item);
+        }
+        ++row;
+    }
+}
+
+QString MainWindow::createSavePath(const QString &folderPath, const QString &extention)
 {
-    const QString &folderPath = ui->path_lineEdit->text();
     if (folderPath.isEmpty())
     {
         return QString();
     }
 
     int max = 0;
-    const QString extention = mode == TXT_EXPORT ? QStringLiteral(".txt")
-                                                 : QStringLiteral(".xlsx");
     const QRegExp rex(QStringLiteral("Отчет\\s\\d+\\") + extention);
     const QFileInfoList fileList = QDir(folderPath).entryInfoList(QStringList(), QDir::Files);
     for (const auto &info : fileList)
@@ -116,15 +361,216 @@ QString MainWindow::createSavePath(const EXPORT_MODES mode)
     return folderPath + '/' + QStringLiteral("Отчет ") + QString::number(++max) + extention;
 }
 
+/// Shown in the status bar, so the window stays usable
 void MainWindow::showSuccessMessage(const QString &savePath)
 {
-    QMessageBox msgBox(this);
-    msgBox.setIcon(QMessageBox::Information);
-    msgBox.setWindowTitle(QStringLiteral("Экспорт"));
-    msgBox.setText(QStringLiteral("Сохранено в %1").arg(savePath));
-    msgBox.setStandardButtons(QMessageBox::NoButton);
-    QTimer::singleShot(1000, &msgBox, &QMessageBox::accept);
-    msgBox.exec();
+    statusBar()->showMessage(QStringLiteral("Сохранено в %1").arg(savePath), MESSAGE_TIMEOUT_MS);
+}
+
+void MainWindow::exportReport(const EXPORT_MODES mode)
+{
+    if (!scanResults || scanResults->isEmpty() || exportRunning(mode))
+    {
+        return;
+    }
+
+    const QString savePath = createSavePath(ui->path_lineEdit->text(), exportExtension(mode, checksumCalculator.data()));
+    if (savePath.isEmpty())
+    {
+        return;
+    }
+
+    ReportHeader header;
+    header.checksumName = checksumCalculator->name();
+    header.checksumMaxLen = checksumCalculator->maxLen();
+    header.mirrorComparison = comparisonResults;
+    header.filter = scanFilter.description();
+    const int id = reportExporter->start(makeReportWriter(mode), savePath, header, scanResults);
+    if (id < 0)
+    {
+        return;
+    }
+    const RunningExport running = {mode, 0, scanResults->size()};
+    runningExports.insert(id, running);
+    updateExportProgress();
+    setTxtXlsxEnabled();
+}
+
+QString MainWindow::exportExtension(const EXPORT_MODES mode, const ChecksumCalculator *calculator)
+{
+    if (mode == XLSX_EXPORT)
+        return QStringLiteral(".xlsx");
+    if (mode == CSV_EXPORT)
+        return QStringLiteral(".csv");
+    if (mode == JSONL_EXPORT)
+        return QStringLiteral(".jsonl");
+    if (mode == DIGEST_EXPORT && calculator)
+        return QLatin1Char('.') + calculator->name().toLower().remove(QLatin1Char('-'));
+    return QStringLiteral(".txt");
+}
+
+MainWindow::EXPORT_MODES MainWindow::exportModeFromName(const QString &name)
+{
+    const QString format = name.trimmed().toLower();
+    if (format == QLatin1String("txt"))
+        return TXT_EXPORT;
+    if (format == QLatin1String("xlsx"))
+        return XLSX_EXPORT;
+    if (format == QLatin1String("csv"))
+        return CSV_EXPORT;
+    if (format == QLatin1String("jsonl"))
+        return JSONL_EXPORT;
+    if (format == QLatin1String("sums"))
+        return DIGEST_EXPORT;
+    return NO_EXPORT;
+}
+
+/// Filter of the filter widgets, saved to the settings. The date window counts back from now.
+ScanFilter MainWindow::readFilter()
+{
+    const QString names = ui->filter_lineEdit->text().trimmed();
+    const int minSizeMb = ui->minSize_spinBox->value();
+    const int maxSizeMb = ui->maxSize_spinBox->value();
+    const int days = ui->modifiedDays_spinBox->value();
+    settings->setValue(SETTINGS_FILTER_NAMES, names);
+    settings->setValue(SETTINGS_FILTER_MIN_MB, minSizeMb);
+    settings->setValue(SETTINGS_FILTER_MAX_MB, maxSizeMb);
+    settings->setValue(SETTINGS_FILTER_DAYS, days);
+
+    const qint64 mb = 1024 * 1024;
+    ScanFilter filter;
+    filter.namePatterns = ScanFilter::parsePatterns(names);
+    if (minSizeMb > 0)
+        filter.minSize = minSizeMb * mb;
+    if (maxSizeMb > 0)
+        filter.maxSize = maxSizeMb * mb;
+    if (days > 0)
+        filter.modifiedAfter = QDateTime::currentDateTime().addDays(-days);
+    return filter;
+}
+
+/// The scan and the mirror comparison share the buffer pool, its capacity comes from the window
+void MainWindow::applyMemoryBudget()
+{
+    const int budgetMb = ui->memoryBudget_spinBox->value();
+    settings->setValue(SETTINGS_MEMORY_BUDGET, budgetMb);
+    scanEngine->setMemoryBudget(qint64(budgetMb) * 1024 * 1024);
+}
+
+bool MainWindow::startScan(const QVector<ScanEngine::ScanRoot> &roots)
+{
+    scanReportPaths.clear();
+    for (const auto &root : roots)
+    {
+        scanReportPaths.append(root.reportPath);
+    }
+
+    const int threadCount = ui->threads_spinBox->value();
+    settings->setValue(SETTINGS_THREAD_COUNT, threadCount);
+    applyMemoryBudget();
+
+    profiler.start(ui->trace_checkBox->isChecked());
+    if (!scanEngine->start(roots, threadCount, &profiler))
+    {
+        for (const auto &root : roots)
+        {
+            if (root.reportWriter)
+                root.reportWriter->close();
+        }
+        scanReportPaths.clear();
+        return false;
+    }
+    setScanStarted();
+    return true;
+}
+
+/// Reads a batch job: an INI file with a "roots" array of path, checksum (CRC32, MD5, SHA-1),
+/// format (txt, csv, jsonl, sums, xlsx) and an optional report path. Every root uses the window's filter.
+/// Opens the report of every root, on error closes and removes the ones already opened.
+bool MainWindow::loadBatch(const QString &jobPath, QVector<ScanEngine::ScanRoot> &roots, QString &error)
+{
+    QSettings job(jobPath, QSettings::IniFormat);
+    const QString defaultChecksum = ui->checksum_comboBox->currentText();
+    const int count = job.beginReadArray(BATCH_ROOTS);
+    for (int i = 0; i < count && error.isEmpty(); ++i)
+    {
+        job.setArrayIndex(i);
+        ScanEngine::ScanRoot root;
+        root.folderPath = job.value(BATCH_PATH).toString();
+        root.filter = scanFilter;
+        if (root.folderPath.isEmpty() || !QDir(root.folderPath).exists())
+        {
+            error = QStringLiteral("Нет папки \"%1\"").arg(root.folderPath);
+            break;
+        }
+
+        const QString checksumName = job.value(BATCH_CHECKSUM, defaultChecksum).toString().trimmed();
+        for (uint type = 0; type < static_cast<uint>(ChecksumCalculator::CHECKSUM_TYPES::MAX); ++type)
+        {
+            auto calculator = makeChecksumCalculator(static_cast<ChecksumCalculator::CHECKSUM_TYPES>(type));
+            if (calculator && calculator->name().compare(checksumName, Qt::CaseInsensitive) == 0)
+            {
+                calculator->setKernelBackend(kernelBackends[type]);
+                calculator->setCachePolite(ui->cachePolite_checkBox->isChecked());
+                root.calculator = calculator;
+                break;
+            }
+        }
+        if (!root.calculator)
+        {
+            error = QStringLiteral("Неизвестная чексумма \"%1\"").arg(checksumName);
+            break;
+        }
+
+        const QString formatName = job.value(BATCH_FORMAT, QStringLiteral("txt")).toString();
+        const EXPORT_MODES mode = exportModeFromName(formatName);
+        if (mode == NO_EXPORT)
+        {
+            error = QStringLiteral("Неизвестный формат \"%1\"").arg(formatName);
+            break;
+        }
+        root.reportPath = job.value(BATCH_REPORT).toString();
+        if (root.reportPath.isEmpty())
+            root.reportPath = createSavePath(root.folderPath, exportExtension(mode, root.calculator.data()));
+        for (const auto &other : roots)
+        {
+            if (QFileInfo(other.reportPath).absoluteFilePath() == QFileInfo(root.reportPath).absoluteFilePath())
+                error = QStringLiteral("Два отчета в один файл %1").arg(root.reportPath);
+        }
+        if (!error.isEmpty())
+        {
+            break;
+        }
+
+        ReportHeader header;
+        header.checksumName = root.calculator->name();
+        header.checksumMaxLen = root.calculator->maxLen();
+        header.filter = scanFilter.description();
+        root.reportWriter = makeReportWriter(mode);
+        if (!root.reportWriter || !root.reportWriter->open(root.reportPath, header))
+        {
+            error = QStringLiteral("Не удалось сохранить в %1").arg(root.reportPath);
+            break;
+        }
+        roots.append(root);
+    }
+    job.endArray();
+
+    if (error.isEmpty() && roots.isEmpty())
+    {
+        error = QStringLiteral("В задании нет папок");
+    }
+    if (!error.isEmpty())
+    {
+        for (const auto &root : roots)
+        {
+            root.reportWriter->close();
+            QFile::remove(root.reportPath);
+        }
+        roots.clear();
+        return false;
+    }
+    return true;
 }
 
 QSharedPointer<ChecksumCalculator> MainWindow::makeChecksumCalculator(const ChecksumCalculator::CHECKSUM_TYPES type)
@@ -138,6 +584,21 @@ QSharedPointer<ChecksumCalculator> MainWindow::makeChecksumCalculator(const Chec
     return nullptr;
 }
 
+QSharedPointer<ReportWriter> MainWindow::makeReportWriter(const EXPORT_MODES mode)
+{
+    if (mode == TXT_EXPORT)
+        return QSharedPointer<TxtReportWriter>(new TxtReportWriter);
+    if (mode == XLSX_EXPORT)
+        return QSharedPointer<XlsxReportWriter>(new XlsxReportWriter);
+    if (mode == CSV_EXPORT)
+        return QSharedPointer<CsvReportWriter>(new CsvReportWriter);
+    if (mode == JSONL_EXPORT)
+        return QSharedPointer<JsonLinesReportWriter>(new JsonLinesReportWriter);
+    if (mode == DIGEST_EXPORT)
+        return QSharedPointer<DigestListReportWriter>(new DigestListReportWriter);
+    return nullptr;
+}
+
 void MainWindow::slotBrowse()
 {
     auto currentPath = ui->path_lineEdit->text();
@@ -155,15 +616,16 @@ void MainWindow::slotBrowse()
 void MainWindow::slotScan()
 {
     const QString &folderPath = ui->path_lineEdit->text();
-    if (folderPath.isEmpty())
+    if (folderPath.isEmpty() || scanRunning())
     {
         return;
     }
 
     settings->setValue(SETTINGS_LAST_PATH, folderPath);
-    setCursor(Qt::WaitCursor);
     ui->tableWidget->clearContents();
     ui->tableWidget->setRowCount(0);
+    scanResults.reset(new ScanResults);
+    comparisonResults = false;
 
     const int checksum_type = ui->checksum_comboBox->currentData().toInt();
     settings->setValue(SETTINGS_CHECKSUM_TYPE, checksum_type);
@@ -173,127 +635,216 @@ void MainWindow::slotScan()
         QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Проблема с расчетом чексуммы"));
         return;
     }
-
-    const QFileInfoList fileList = QDir(folderPath).entryInfoList(QStringList(), QDir::Files);
-    for (const auto &info : fileList)
+    checksumCalculator->setKernelBackend(kernelBackends[checksum_type]);
+    checksumCalculator->setCachePolite(ui->cachePolite_checkBox->isChecked());
+
+    const auto scanTo = static_cast<EXPORT_MODES>(ui->scanTo_comboBox->currentData().toInt());
+    settings->setValue(SETTINGS_SCAN_TO, static_cast<int>(scanTo));
+    scanFilter = readFilter();
+    ScanEngine::ScanRoot root;
+    root.folderPath = folderPath;
+    root.filter = scanFilter;
+    root.calculator = checksumCalculator;
+    if (scanTo != NO_EXPORT)
     {
-        if (info.isHidden())
+        root.reportPath = createSavePath(folderPath, exportExtension(scanTo, checksumCalculator.data()));
+        ReportHeader header;
+        header.checksumName = checksumCalculator->name();
+        header.checksumMaxLen = checksumCalculator->maxLen();
+        header.filter = scanFilter.description();
+        root.reportWriter = makeReportWriter(scanTo);
+        if (!root.reportWriter || !root.reportWriter->open(root.reportPath, header))
         {
-            continue;
-        }
-        const int row = ui->tableWidget->rowCount();
-        ui->tableWidget->insertRow(row);
-        {
-            auto item = new QTableWidgetItem();
-            item->setFlags(item->flags() &~Qt::ItemIsEditable);
-            item->setText(info.fileName());
-            item->setData(ROLE_CHECKSUM, checksumCalculator->calcChecksum(info.filePath()));
-            item->setData(ROLE_FILE_SIZE, info.size());
-
-            ui->tableWidget->setItem(row, COL_NAME, item);
-        }
-        {
-            QDateTime dateTime(info.lastModified().date(), info.lastModified().time());
-            auto item = new QTableWidgetItem();
-            item->setFlags(item->flags() &~Qt::ItemIsEditable);
-            item->setTextAlignment(Qt::AlignCenter);
-            item->setData(ROLE_DATE_TIME, dateTime);
-            item->setText(dateTime.date().toString(QStringLiteral("dd.MM.yyyy"))
-                          + QStringLiteral("  ") + dateTime.time().toString(QStringLiteral("hh:mm")));
-            ui->tableWidget->setItem(row, COL_DATE_TIME, item);
+            QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Не удалось сохранить в %1").arg(root.reportPath));
+            return;
         }
     }
-    setTxtXlsxEnabled();
-    setCursor(Qt::ArrowCursor);
+
+    startScan(QVector<ScanEngine::ScanRoot>() << root);
 }
 
-void MainWindow::slotWriteTxt()
+void MainWindow::slotBatch()
 {
-    if (!ui->tableWidget->rowCount())
+    if (scanRunning())
     {
         return;
     }
+    const QString jobPath = QFileDialog::getOpenFileName(this, QStringLiteral("Пакетное задание"),
+                                                         settings->value(SETTINGS_LAST_BATCH, QDir::homePath()).toString(),
+                                                         QStringLiteral("Пакетное задание (*.ini)"));
+    if (jobPath.isEmpty())
+    {
+        return;
+    }
+    settings->setValue(SETTINGS_LAST_BATCH, jobPath);
 
-    const QString savePath = createSavePath(TXT_EXPORT);
-    if (savePath.isEmpty())
+    scanFilter = readFilter();
+    QVector<ScanEngine::ScanRoot> roots;
+    QString error;
+    if (!loadBatch(jobPath, roots, error))
     {
+        QMessageBox::critical(this, QStringLiteral("Ошибка"), error);
         return;
     }
 
-    QFile file(savePath);
-    if (!file.open(QFile::WriteOnly))
+    ui->tableWidget->clearContents();
+    ui->tableWidget->setRowCount(0);
+    scanResults.reset(new ScanResults);
+    comparisonResults = false;
+    checksumCalculator = roots.first().calculator;
+    startScan(roots);
+}
+
+void MainWindow::slotCompare()
+{
+    const QString &sourcePath = ui->path_lineEdit->text();
+    if (sourcePath.isEmpty() || scanRunning())
+    {
+        return;
+    }
+    const QString mirrorPath = QFileDialog::getExistingDirectory(this, QStringLiteral("Зеркало папки %1").arg(sourcePath),
+                                                                 sourcePath);
+    if (mirrorPath.isEmpty())
     {
         return;
     }
 
-    const std::size_t wName = 50;
-    const std::size_t wDate = 25;
-    const std::size_t wChecksum = checksumCalculator->maxLen();
-    const std::size_t wSize = 15;
-    QTextStream stream(&file);
-    stream << Qt::left  << qSetFieldWidth(wName)     << QStringLiteral("Filename")
-                        << qSetFieldWidth(wDate)     << QStringLiteral("Last edit date time")
-                        << qSetFieldWidth(wChecksum) << QStringLiteral("Checksum (%1)").arg(checksumCalculator->name())
-           << Qt::right << qSetFieldWidth(wSize)     << QStringLiteral("File size")
-                        << qSetFieldWidth(0)         << Qt::endl;
-    for (int i = 0; i < ui->tableWidget->rowCount(); ++i)
+    const int checksum_type = ui->checksum_comboBox->currentData().toInt();
+    settings->setValue(SETTINGS_LAST_PATH, sourcePath);
+    settings->setValue(SETTINGS_CHECKSUM_TYPE, checksum_type);
+    checksumCalculator = makeChecksumCalculator(static_cast<ChecksumCalculator::CHECKSUM_TYPES>(checksum_type));
+    if (!checksumCalculator)
     {
-        const QString filename = QString::fromLocal8Bit(ui->tableWidget->item(i, COL_NAME)->data(Qt::DisplayRole).toByteArray());
-        stream << Qt::left  << qSetFieldWidth(wName)     << filename
-                            << qSetFieldWidth(wDate)     << ui->tableWidget->item(i, COL_DATE_TIME)->text()
-                            << qSetFieldWidth(wChecksum) << ui->tableWidget->item(i, COL_NAME)->data(ROLE_CHECKSUM).toString()
-               << Qt::right << qSetFieldWidth(wSize)     << ui->tableWidget->item(i, COL_NAME)->data(ROLE_FILE_SIZE).value<qint64>()
-                            << qSetFieldWidth(0)         << Qt::endl;
+        QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Проблема с расчетом чексуммы"));
+        return;
     }
-    file.close();
+    checksumCalculator->setKernelBackend(kernelBackends[checksum_type]);
+    checksumCalculator->setCachePolite(ui->cachePolite_checkBox->isChecked());
 
-    emit signalReportFileWritten(savePath);
+    ui->tableWidget->clearContents();
+    ui->tableWidget->setRowCount(0);
+    scanResults.reset(new ScanResults);
+    comparisonResults = true;
+    scanFilter = ScanFilter();
+    scanReportPaths.clear();
+
+    const int threadCount = ui->threads_spinBox->value();
+    settings->setValue(SETTINGS_THREAD_COUNT, threadCount);
+    applyMemoryBudget();
+    profiler.start(ui->trace_checkBox->isChecked());
+    if (!mirrorComparer->start(sourcePath, mirrorPath, checksumCalculator, threadCount, &profiler))
+    {
+        return;
+    }
+    setScanStarted();
 }
 
-void MainWindow::slotWriteXlsx()
+void MainWindow::slotCollectRecords()
 {
-    if (!ui->tableWidget->rowCount())
+    const QVector<ScanRecord> records = comparisonResults ? mirrorComparer->takeRecords()
+                                                          : scanEngine->takeRecords();
+    if (!records.isEmpty())
     {
-        return;
+        ScanProfiler::Scope scope(&profiler, ScanProfiler::STAGES::UI_INSERT);
+        scanResults->append(records);
+        insertRecords(records);
     }
+    ui->stats_label->setText(profiler.summary());
+}
 
-    const QString savePath = createSavePath(XLSX_EXPORT);
-    if (savePath.isEmpty())
+void MainWindow::slotScanFinished()
+{
+    collectTimer->stop();
+    slotCollectRecords();
+    profiler.stop();
+    scanResults->sort();
+    ui->tableWidget->sortItems(COL_NAME);
+    ui->stats_label->setText(profiler.summary());
+    if (comparisonResults)
     {
-        return;
+        ui->stats_label->setText(QStringLiteral("Совпало: %1, расхождений: %2\n%3")
+                                 .arg(mirrorComparer->matched()).arg(mirrorComparer->discrepancies())
+                                 .arg(profiler.summary()));
+    }
+
+    ui->trace_pushButton->setEnabled(profiler.tracing());
+    slotPathChanged();
+    setTxtXlsxEnabled();
+    setCursor(Qt::ArrowCursor);
+
+    QStringList written;
+    QStringList failed;
+    for (int root = 0; root < scanReportPaths.size(); ++root)
+    {
+        if (scanReportPaths.at(root).isEmpty())
+            continue;
+        if (scanEngine->reportOk(root))
+            written.append(scanReportPaths.at(root));
+        else
+            failed.append(scanReportPaths.at(root));
     }
+    const bool batch = scanReportPaths.size() > 1;
+    scanReportPaths.clear();
 
-    QXlsx::Document xlsx;
-    xlsx.setColumnWidth(1, 80.0);
-    xlsx.setColumnWidth(2, 20.0);
-    xlsx.setColumnWidth(3, 40.0);
-    xlsx.setColumnWidth(4, 15.0);
+    if (!failed.isEmpty())
+    {
+        QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Не удалось сохранить в %1").arg(failed.join(QStringLiteral("\n"))));
+    }
+    if (batch && !written.isEmpty())
+    {
+        QMessageBox::information(this, QStringLiteral("Пакетное задание"), QStringLiteral("Сохранено в\n%1").arg(written.join(QStringLiteral("\n"))));
+    }
+    else if (written.size() == 1)
+    {
+        emit signalReportFileWritten(written.first());
+    }
+}
 
+void MainWindow::slotWriteTrace()
+{
+    const QString savePath = QFileDialog::getSaveFileName(this, QStringLiteral("Трассировка"),
+                                                          ui->path_lineEdit->text() + QStringLiteral("/trace.json"),
+                                                          QStringLiteral("Chrome trace (*.json)"));
+    if (savePath.isEmpty())
     {
-        QXlsx::Format headerFormat;
-        headerFormat.setNumberFormatIndex(49);
-        headerFormat.setFontBold(true);
-        headerFormat.setHorizontalAlignment(QXlsx::Format::HorizontalAlignment::AlignHCenter);
-        xlsx.write(QStringLiteral("A1"), QStringLiteral("Filename"), headerFormat);
-        xlsx.write(QStringLiteral("B1"), QStringLiteral("Last edit date time"), headerFormat);
-        xlsx.write(QStringLiteral("C1"), QStringLiteral("Checksum (%1)").arg(checksumCalculator->name()), headerFormat);
-        xlsx.write(QStringLiteral("D1"), QStringLiteral("File size"), headerFormat);
+        return;
     }
+    if (!profiler.writeChromeTrace(savePath))
+    {
+        QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Не удалось сохранить в %1").arg(savePath));
+        return;
+    }
+    showSuccessMessage(savePath);
+}
 
-    QXlsx::Format txtFormat;
-    txtFormat.setNumberFormatIndex(49);
-    QXlsx::Format dateTimeFormat;
-    dateTimeFormat.setNumberFormat(QStringLiteral("dd.MM.yyyy hh:mm"));
-    for (int i = 0; i < ui->tableWidget->rowCount(); ++i)
+void MainWindow::slotWriteTxt()
+{
+    exportReport(TXT_EXPORT);
+}
+
+void MainWindow::slotWriteXlsx()
+{
+    exportReport(XLSX_EXPORT);
+}
+
+void MainWindow::slotExportProgress(int id, int done, int total)
+{
+    const auto it = runningExports.find(id);
+    if (it == runningExports.end())
     {
-        const auto row = i + 2;
-        xlsx.write(QStringLiteral("A%1").arg(row), ui->tableWidget->item(i, COL_NAME)->text(), txtFormat);
-        xlsx.write(QStringLiteral("B%1").arg(row), ui->tableWidget->item(i, COL_DATE_TIME)->data(ROLE_DATE_TIME).toDateTime(), dateTimeFormat);
-        xlsx.write(QStringLiteral("C%1").arg(row), ui->tableWidget->item(i, COL_NAME)->data(ROLE_CHECKSUM).toString(), txtFormat);
-        xlsx.write(QStringLiteral("D%1").arg(row), ui->tableWidget->item(i, COL_NAME)->data(ROLE_FILE_SIZE).value<qint64>(), txtFormat);
+        return;
     }
+    it->done = done;
+    it->total = total;
+    updateExportProgress();
+}
 
-    if (!xlsx.saveAs(savePath))
+void MainWindow::slotExportFinished(int id, const QString &savePath, bool ok)
+{
+    runningExports.remove(id);
+    updateExportProgress();
+    setTxtXlsxEnabled();
+    if (!ok)
     {
         QMessageBox::critical(this, QStringLiteral("Ошибка"), QStringLiteral("Не удалось сохранить в %1").arg(savePath));
         return;
@@ -302,9 +853,19 @@ void MainWindow::slotWriteXlsx()
     emit signalReportFileWritten(savePath);
 }
 
+void MainWindow::slotExportCanceled(int id, const QString &savePath)
+{
+    runningExports.remove(id);
+    updateExportProgress();
+    setTxtXlsxEnabled();
+    statusBar()->showMessage(QStringLiteral("Экспорт в %1 отменен").arg(savePath), MESSAGE_TIMEOUT_MS);
+}
+
 void MainWindow::slotPathChanged()
 {
-    ui->scan_toolButton->setEnabled(!ui->path_lineEdit->text().isEmpty());
+    ui->scan_toolButton->setEnabled(!ui->path_lineEdit->text().isEmpty() && !scanRunning());
+    ui->batch_pushButton->setEnabled(!scanRunning());
+    ui->compare_pushButton->setEnabled(!ui->path_lineEdit->text().isEmpty() && !scanRunning());
 }
 
 void MainWindow::slotReportFileWritten(const QString &savePath)
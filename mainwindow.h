@@ -2,15 +2,21 @@
 #define MAINWINDOW_H
 
 #include "ChecksumCalculator.h"
+#include "ScanProfiler.h"
+#include "ScanEngine.h"
+#include "ReportExporter.h"
+#include "MirrorComparer.h"
 
 #include <QMainWindow>
 #include <QSettings>
+#include <QThreadPool>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
 class QDir;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -25,21 +31,44 @@ class MainWindow : public QMainWindow
 
     enum ROLES
     {
-        ROLE_DATE_TIME = Qt::UserRole,
-        ROLE_CHECKSUM,
-        ROLE_FILE_SIZE
+        ROLE_DATE_TIME = Qt::UserRole
     };
 
     enum EXPORT_MODES
     {
         TXT_EXPORT,
-        XLSX_EXPORT
+        XLSX_EXPORT,
+        CSV_EXPORT,
+        JSONL_EXPORT,
+        DIGEST_EXPORT,
+        NO_EXPORT = -1
     };
 
     Ui::MainWindow *ui;
     const QString settingsFilename = QStringLiteral("settings.conf");
     QScopedPointer<QSettings> settings {new QSettings(QStringLiteral("settings.conf"), QSettings::IniFormat)};
     QSharedPointer<ChecksumCalculator> checksumCalculator;
+    QSharedPointer<ScanResults> scanResults;
+    ScanProfiler profiler;
+    QScopedPointer<ScanEngine> scanEngine {new ScanEngine};
+    QScopedPointer<ReportExporter> reportExporter {new ReportExporter};
+    QScopedPointer<MirrorComparer> mirrorComparer {new MirrorComparer};
+    bool comparisonResults = false;
+    /// Exports in progress by ReportExporter id
+    struct RunningExport
+    {
+        EXPORT_MODES mode;
+        int done;
+        int total;
+    };
+    QHash<int, RunningExport> runningExports;
+    /// Filter of the scan shown in the table
+    ScanFilter scanFilter;
+    QTimer *collectTimer;
+    QStringList scanReportPaths;
+    bool kernelBackends[static_cast<uint>(ChecksumCalculator::CHECKSUM_TYPES::MAX)] = {};
+    /// Runs the hash backend benchmark, so the window is usable at once
+    QThreadPool benchmarkPool;
 
 public:
     MainWindow(QWidget *parent = nullptr);
@@ -47,15 +76,38 @@ public:
 
 private:
     void setTxtXlsxEnabled();
-    QString createSavePath(const EXPORT_MODES mode);
+    bool exportRunning(const EXPORT_MODES mode) const;
+    void updateExportProgress();
+    bool scanRunning() const;
+    void setScanStarted();
+    void selectHashBackends();
+    static QVector<bool> benchmarkHashBackends();
+    void insertRecords(const QVector<ScanRecord> &records);
+    static QString createSavePath(const QString &folderPath, const QString &extention);
     void showSuccessMessage(const QString &savePath);
+    void exportReport(const EXPORT_MODES mode);
+    ScanFilter readFilter();
+    void applyMemoryBudget();
+    bool startScan(const QVector<ScanEngine::ScanRoot> &roots);
+    bool loadBatch(const QString &jobPath, QVector<ScanEngine::ScanRoot> &roots, QString &error);
+    static QString exportExtension(const EXPORT_MODES mode, const ChecksumCalculator *calculator);
+    static EXPORT_MODES exportModeFromName(const QString &name);
     static QSharedPointer<ChecksumCalculator> makeChecksumCalculator(const ChecksumCalculator::CHECKSUM_TYPES type);
+    static QSharedPointer<ReportWriter> makeReportWriter(const EXPORT_MODES mode);
 
 private slots:
     void slotBrowse();
     void slotScan();
+    void slotBatch();
+    void slotCompare();
+    void slotCollectRecords();
+    void slotScanFinished();
+    void slotWriteTrace();
     void slotWriteTxt();
     void slotWriteXlsx();
+    void slotExportProgress(int id, int done, int total);
+    void slotExportFinished(int id, const QString &savePath, bool ok);
+    void slotExportCanceled(int id, const QString &savePath);
     void slotPathChanged();
     void slotReportFileWritten(const QString &savePath);
 
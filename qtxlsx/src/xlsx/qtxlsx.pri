@@ -2,6 +2,8 @@ INCLUDEPATH += $$PWD
 DEPENDPATH += $$PWD
 
 QT += core gui gui-private
+qtConfig(system-zlib): QMAKE_USE += zlib
+else: QT += zlib-private
 !build_xlsx_lib:DEFINES += XLSX_NO_LIB
 
 HEADERS += $$PWD/xlsxdocpropscore_p.h \
@@ -30,6 +32,7 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxdocument_p.h \
     $$PWD/xlsxcell.h \
     $$PWD/xlsxcell_p.h \
+    $$PWD/xlsxcelltable_p.h \
     $$PWD/xlsxdatavalidation.h \
     $$PWD/xlsxdatavalidation_p.h \
     $$PWD/xlsxcellreference.h \
@@ -48,7 +51,13 @@ HEADERS += $$PWD/xlsxdocpropscore_p.h \
     $$PWD/xlsxchart_p.h \
     $$PWD/xlsxsimpleooxmlfile_p.h \
     $$PWD/xlsxcellformula.h \
-    $$PWD/xlsxcellformula_p.h
+    $$PWD/xlsxcellformula_p.h \
+    $$PWD/xlsxsheetreader.h \
+    $$PWD/xlsxsheetreader_p.h \
+    $$PWD/xlsxsheetdatawriter_p.h \
+    $$PWD/xlsxnumberconversion_p.h \
+    $$PWD/xlsxsheetdatareader_p.h \
+    $$PWD/xlsxcellreference_p.h
 
 SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxdocpropsapp.cpp \
@@ -68,6 +77,7 @@ SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxzipreader.cpp \
     $$PWD/xlsxdocument.cpp \
     $$PWD/xlsxcell.cpp \
+    $$PWD/xlsxcelltable.cpp \
     $$PWD/xlsxdatavalidation.cpp \
     $$PWD/xlsxcellreference.cpp \
     $$PWD/xlsxcellrange.cpp \
@@ -80,5 +90,9 @@ SOURCES += $$PWD/xlsxdocpropscore.cpp \
     $$PWD/xlsxabstractooxmlfile.cpp \
     $$PWD/xlsxchart.cpp \
     $$PWD/xlsxsimpleooxmlfile.cpp \
-    $$PWD/xlsxcellformula.cpp
+    $$PWD/xlsxcellformula.cpp \
+    $$PWD/xlsxsheetreader.cpp \
+    $$PWD/xlsxsheetdatawriter.cpp \
+    $$PWD/xlsxnumberconversion.cpp \
+    $$PWD/xlsxsheetdatareader.cpp
 
@@ -230,7 +230,7 @@ bool CellFormula::loadFromXml(QXmlStreamReader &reader)
         d->reference = CellRange(refString);
     }
 
-    QString ca = attributes.value(QLatin1String("si")).toString();
+    QString ca = attributes.value(QLatin1String("ca")).toString();
     d->ca = parseXsdBoolean(ca, false);
 
     if (attributes.hasAttribute(QLatin1String("si")))
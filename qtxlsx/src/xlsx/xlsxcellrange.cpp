@@ -24,9 +24,9 @@
 ****************************************************************************/
 #include "xlsxcellrange.h"
 #include "xlsxcellreference.h"
+#include "xlsxcellreference_p.h"
 #include <QString>
 #include <QPoint>
-#include <QStringList>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -93,20 +93,18 @@ CellRange::CellRange(const char *range)
 
 void CellRange::init(const QString &range)
 {
-    QStringList rs = range.split(QLatin1Char(':'));
-    if (rs.size() == 2) {
-        CellReference start(rs[0]);
-        CellReference end(rs[1]);
-        top = start.row();
-        left = start.column();
-        bottom = end.row();
-        right = end.column();
-    } else {
-        CellReference p(rs[0]);
-        top = p.row();
-        left = p.column();
-        bottom = p.row();
-        right = p.column();
+    const QChar *first = range.constData();
+    const QChar *last = first + range.size();
+    const int colon = range.indexOf(QLatin1Char(':'));
+    const QChar *middle = colon == -1 ? last : first + colon;
+    if (!parseCellReference(first, middle, &top, &left))
+        top = left = -1;
+    if (colon == -1 || range.indexOf(QLatin1Char(':'), colon + 1) != -1) {
+        // Like a list of more than two references, only the first one counts
+        bottom = top;
+        right = left;
+    } else if (!parseCellReference(middle + 1, last, &bottom, &right)) {
+        bottom = right = -1;
     }
 }
 
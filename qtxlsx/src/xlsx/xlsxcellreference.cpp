@@ -23,61 +23,103 @@
 **
 ****************************************************************************/
 #include "xlsxcellreference.h"
-#include <QStringList>
-#include <QMap>
-#include <QRegularExpression>
+#include "xlsxcellreference_p.h"
+
+#include <QString>
+
+#include <limits.h>
+#include <string.h>
 
 QT_BEGIN_NAMESPACE_XLSX
 
 namespace {
 
-int intPow(int x, int p)
+inline uint toUnicode(char c)
 {
-    if (p == 0)
-        return 1;
-    if (p == 1)
-        return x;
-
-    int tmp = intPow(x, p / 2);
-    if (p % 2 == 0)
-        return tmp * tmp;
-    else
-        return x * tmp * tmp;
+    return uchar(c);
 }
 
-QString col_to_name(int col_num)
+inline uint toUnicode(QChar c)
 {
-    static QMap<int, QString> col_cache;
-
-    if (!col_cache.contains(col_num)) {
-        QString col_str;
-        int remainder;
-        while (col_num) {
-            remainder = col_num % 26;
-            if (remainder == 0)
-                remainder = 26;
-            col_str.prepend(QChar('A' + remainder - 1));
-            col_num = (col_num - 1) / 26;
-        }
-        col_cache.insert(col_num, col_str);
-    }
-
-    return col_cache[col_num];
+    return c.unicode();
 }
 
-int col_from_name(const QString &col_str)
+/*
+ * Up to three column letters and the row digits, each may be preceded by a
+ * '$'. The row has to fit in an int.
+ */
+template <typename Char>
+bool parseReference(const Char *first, const Char *last, int *row, int *column)
 {
+    const Char *p = first;
+    if (p != last && toUnicode(*p) == '$')
+        ++p;
+    const Char *letters = p;
     int col = 0;
-    int expn = 0;
-    for (int i = col_str.size() - 1; i > -1; --i) {
-        col += (col_str[i].unicode() - 'A' + 1) * intPow(26, expn);
-        expn++;
+    for (; p != last && p - letters < 3; ++p) {
+        const uint letter = toUnicode(*p) - 'A';
+        if (letter > 25)
+            break;
+        col = col * 26 + int(letter) + 1;
     }
+    if (p == letters)
+        return false;
+    if (p != last && toUnicode(*p) == '$')
+        ++p;
+
+    const Char *digits = p;
+    qint64 r = 0;
+    for (; p != last; ++p) {
+        const uint digit = toUnicode(*p) - '0';
+        if (digit > 9)
+            return false;
+        r = r * 10 + digit;
+        if (r > INT_MAX)
+            return false;
+    }
+    if (p == digits)
+        return false;
 
-    return col;
+    *row = int(r);
+    *column = col;
+    return true;
 }
+
 } // namespace
 
+bool parseCellReference(const char *first, const char *last, int *row, int *column)
+{
+    return parseReference(first, last, row, column);
+}
+
+bool parseCellReference(const QChar *first, const QChar *last, int *row, int *column)
+{
+    return parseReference(first, last, row, column);
+}
+
+int formatCellReference(int row, int column, char *buffer, bool rowAbsolute, bool columnAbsolute)
+{
+    char *p = buffer;
+    if (columnAbsolute)
+        *p++ = '$';
+    char letters[8];
+    char *first = letters + sizeof(letters);
+    for (; column > 0; column = (column - 1) / 26)
+        *--first = char('A' + (column - 1) % 26);
+    while (first != letters + sizeof(letters))
+        *p++ = *first++;
+
+    if (rowAbsolute)
+        *p++ = '$';
+    char digits[12];
+    first = digits + sizeof(digits);
+    for (uint value = uint(row); value; value /= 10)
+        *--first = char('0' + value % 10);
+    while (first != digits + sizeof(digits))
+        *p++ = *first++;
+    return int(p - buffer);
+}
+
 /*!
     \class CellReference
     \brief For one single cell such as "A1"
@@ -110,7 +152,10 @@ CellReference::CellReference(int row, int column)
 */
 CellReference::CellReference(const QString &cell)
 {
-    init(cell);
+    if (!parseCellReference(cell.constData(), cell.constData() + cell.size(), &_row, &_column)) {
+        _row = -1;
+        _column = -1;
+    }
 }
 
 /*!
@@ -119,18 +164,9 @@ CellReference::CellReference(const QString &cell)
 */
 CellReference::CellReference(const char *cell)
 {
-    init(QString::fromLatin1(cell));
-}
-
-void CellReference::init(const QString &cell_str)
-{
-    static QRegularExpression re(QStringLiteral("^\\$?([A-Z]{1,3})\\$?(\\d+)$"));
-    QRegularExpressionMatch match = re.match(cell_str);
-    if (match.hasMatch()) {
-        const QString col_str = match.captured(1);
-        const QString row_str = match.captured(2);
-        _row = row_str.toInt();
-        _column = col_from_name(col_str);
+    if (!parseCellReference(cell, cell + strlen(cell), &_row, &_column)) {
+        _row = -1;
+        _column = -1;
     }
 }
 
@@ -160,14 +196,9 @@ QString CellReference::toString(bool row_abs, bool col_abs) const
     if (!isValid())
         return QString();
 
-    QString cell_str;
-    if (col_abs)
-        cell_str.append(QLatin1Char('$'));
-    cell_str.append(col_to_name(_column));
-    if (row_abs)
-        cell_str.append(QLatin1Char('$'));
-    cell_str.append(QString::number(_row));
-    return cell_str;
+    char buffer[CellReferenceBufferSize];
+    const int size = formatCellReference(_row, _column, buffer, row_abs, col_abs);
+    return QString::fromLatin1(buffer, size);
 }
 
 /*!
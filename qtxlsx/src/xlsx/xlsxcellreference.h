@@ -56,7 +56,6 @@ public:
     }
 
 private:
-    void init(const QString &cell);
     int _row, _column;
 };
 
@@ -0,0 +1,61 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXCELLREFERENCE_P_H
+#define QXLSX_XLSXCELLREFERENCE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+#include <QChar>
+
+namespace QXlsx {
+
+/*
+ * Conversion between a cell position and its A1 notation, such as "B7" or
+ * "$XFD$1048576", without any QString in between. The parsers take the
+ * text of an attribute or a QString as is, the formatter writes into a
+ * buffer of CellReferenceBufferSize chars and returns the length.
+ */
+enum { CellReferenceBufferSize = 24 };
+
+XLSX_AUTOTEST_EXPORT bool parseCellReference(const char *first, const char *last, int *row,
+                                             int *column);
+XLSX_AUTOTEST_EXPORT bool parseCellReference(const QChar *first, const QChar *last, int *row,
+                                             int *column);
+XLSX_AUTOTEST_EXPORT int formatCellReference(int row, int column, char *buffer,
+                                             bool rowAbsolute = false, bool columnAbsolute = false);
+}
+
+#endif // QXLSX_XLSXCELLREFERENCE_P_H
@@ -0,0 +1,375 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxcelltable_p.h"
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+int CellTable::Row::lastColumn() const
+{
+    if (!isDense())
+        return columns.last();
+    int i = cells.size() - 1;
+    while (i > 0 && cells.at(i).isNull())
+        --i;
+    return first + i;
+}
+
+CellData *CellTable::Row::find(int column)
+{
+    return const_cast<CellData *>(static_cast<const Row *>(this)->find(column));
+}
+
+const CellData *CellTable::Row::find(int column) const
+{
+    if (isDense()) {
+        const int i = column - first;
+        if (i < 0 || i >= cells.size() || cells.at(i).isNull())
+            return 0;
+        return cells.constData() + i;
+    }
+    const int *begin = columns.constData();
+    const int *end = begin + columns.size();
+    const int *it = std::lower_bound(begin, end, column);
+    if (it == end || *it != column)
+        return 0;
+    return cells.constData() + (it - begin);
+}
+
+/*
+ * Adds a cell at a column that does not hold one yet.
+ */
+void CellTable::Row::insert(int column, const CellData &cell)
+{
+    if (count == 0) {
+        first = column;
+        columns.clear();
+        cells.resize(1);
+        cells[0] = cell;
+        count = 1;
+        return;
+    }
+
+    if (isDense()) {
+        const int i = column - first;
+        if (i >= 0 && i < cells.size()) {
+            cells[i] = cell;
+            ++count;
+            return;
+        }
+        const int newFirst = qMin(first, column);
+        const int newSize = qMax(first + cells.size(), column + 1) - newFirst;
+        if (newSize > 2 * (count + 1) + DenseSlack) {
+            makeSparse();
+        } else {
+            if (i < 0) {
+                cells.insert(0, -i, CellData());
+                first = column;
+                cells[0] = cell;
+            } else {
+                cells.resize(i + 1);
+                cells[i] = cell;
+            }
+            ++count;
+            return;
+        }
+    }
+
+    const int *begin = columns.constData();
+    const int i = int(std::lower_bound(begin, begin + columns.size(), column) - begin);
+    columns.insert(i, column);
+    cells.insert(i, cell);
+    ++count;
+    if (columns.last() - columns.first() + 1 <= 2 * count)
+        makeDense();
+}
+
+void CellTable::Row::makeDense()
+{
+    QVector<CellData> dense(columns.last() - columns.first() + 1);
+    first = columns.first();
+    for (int i = 0; i < columns.size(); ++i)
+        dense[columns.at(i) - first] = cells.at(i);
+    cells.swap(dense);
+    columns.clear();
+}
+
+void CellTable::Row::makeSparse()
+{
+    QVector<int> sparseColumns;
+    QVector<CellData> sparseCells;
+    sparseColumns.reserve(count + 1);
+    sparseCells.reserve(count + 1);
+    for (int i = 0; i < cells.size(); ++i) {
+        if (!cells.at(i).isNull()) {
+            sparseColumns.append(first + i);
+            sparseCells.append(cells.at(i));
+        }
+    }
+    columns.swap(sparseColumns);
+    cells.swap(sparseCells);
+}
+
+CellTable::CellTable()
+    : m_firstBlock(0)
+    , m_rowCount(0)
+{
+    m_formats.append(Format());
+    m_dateTimeFormats.append(false);
+}
+
+CellTable::~CellTable()
+{
+    qDeleteAll(m_blocks);
+    qDeleteAll(m_cells);
+}
+
+const CellTable::Row *CellTable::findRow(int row) const
+{
+    const int b = row >> BlockShift;
+    if (row < 0 || b >= m_blocks.size() || !m_blocks.at(b))
+        return 0;
+    const Row *r = &m_blocks.at(b)->rows[row & (BlockSize - 1)];
+    return r->count ? r : 0;
+}
+
+const CellData *CellTable::cell(int row, int column) const
+{
+    const Row *r = findRow(row);
+    return r ? r->find(column) : 0;
+}
+
+CellData *CellTable::findCell(int row, int column)
+{
+    return const_cast<CellData *>(cell(row, column));
+}
+
+void CellTable::setCell(int row, int column, const CellData &data)
+{
+    Q_ASSERT(row >= 0 && !data.isNull());
+    const int b = row >> BlockShift;
+    if (b >= m_blocks.size())
+        m_blocks.resize(b + 1);
+    Block *block = m_blocks.at(b);
+    if (!block) {
+        block = new Block;
+        m_blocks[b] = block;
+        if (m_rowCount == 0 || b < m_firstBlock)
+            m_firstBlock = b;
+    }
+
+    Row &r = block->rows[row & (BlockSize - 1)];
+    if (CellData *old = r.count ? r.find(column) : 0) {
+        dropSideData(key(row, column), *old);
+        *old = data;
+        old->flags &= ~(CellData::HasFormula | CellData::HasText);
+        return;
+    }
+
+    if (r.count == 0) {
+        ++block->usedRows;
+        ++m_rowCount;
+    }
+    r.insert(column, data);
+    r.find(column)->flags &= ~(CellData::HasFormula | CellData::HasText);
+}
+
+void CellTable::dropSideData(quint64 key, const CellData &cell)
+{
+    if (cell.flags & (CellData::HasFormula | CellData::HasText))
+        m_extras.remove(key);
+    if (!m_cells.isEmpty())
+        delete m_cells.take(key);
+}
+
+void CellTable::removeRow(int row)
+{
+    const int b = row >> BlockShift;
+    if (!findRow(row))
+        return;
+
+    Block *block = m_blocks.at(b);
+    Row &r = block->rows[row & (BlockSize - 1)];
+    r.forEach([this, row](int column, const CellData &cell) {
+        dropSideData(key(row, column), cell);
+    });
+    r = Row();
+    --m_rowCount;
+    if (--block->usedRows > 0)
+        return;
+
+    delete block;
+    m_blocks[b] = 0;
+    while (!m_blocks.isEmpty() && !m_blocks.last())
+        m_blocks.removeLast();
+    while (m_firstBlock < m_blocks.size() && !m_blocks.at(m_firstBlock))
+        ++m_firstBlock;
+}
+
+void CellTable::clear()
+{
+    qDeleteAll(m_blocks);
+    m_blocks.clear();
+    m_firstBlock = 0;
+    m_rowCount = 0;
+    m_extras.clear();
+    qDeleteAll(m_cells);
+    m_cells.clear();
+}
+
+CellFormula CellTable::formula(int row, int column) const
+{
+    const CellData *data = cell(row, column);
+    if (!data || !(data->flags & CellData::HasFormula))
+        return CellFormula();
+    return m_extras.value(key(row, column)).formula;
+}
+
+void CellTable::setFormula(int row, int column, const CellFormula &formula)
+{
+    CellData *data = findCell(row, column);
+    if (!data)
+        return;
+    if (formula.isValid()) {
+        m_extras[key(row, column)].formula = formula;
+        data->flags |= CellData::HasFormula;
+    } else if (data->flags & CellData::HasFormula) {
+        data->flags &= ~CellData::HasFormula;
+        if (data->flags & CellData::HasText)
+            m_extras[key(row, column)].formula = CellFormula();
+        else
+            m_extras.remove(key(row, column));
+    }
+}
+
+RichString CellTable::text(int row, int column) const
+{
+    const CellData *data = cell(row, column);
+    if (!data || !(data->flags & CellData::HasText))
+        return RichString();
+    return m_extras.value(key(row, column)).text;
+}
+
+void CellTable::setText(int row, int column, const RichString &text)
+{
+    CellData *data = findCell(row, column);
+    if (!data)
+        return;
+    m_extras[key(row, column)].text = text;
+    data->flags |= CellData::HasText;
+}
+
+/*
+ * Formats are told apart by their key and xf index, files may hold
+ * several xf records with the same properties.
+ */
+int CellTable::addFormat(const Format &format)
+{
+    if (!format.isValid())
+        return 0;
+
+    const QPair<QByteArray, int> formatKey(format.formatKey(), format.xfIndex());
+    QHash<QPair<QByteArray, int>, int>::const_iterator it = m_formatIndexes.constFind(formatKey);
+    if (it != m_formatIndexes.constEnd())
+        return it.value();
+
+    const int style = m_formats.size();
+    m_formats.append(format);
+    m_dateTimeFormats.append(format.isDateTimeFormat());
+    m_formatIndexes.insert(formatKey, style);
+    return style;
+}
+
+void CellTable::setFormat(int row, int column, const Format &format)
+{
+    if (CellData *data = findCell(row, column))
+        data->style = addFormat(format);
+}
+
+Cell *CellTable::cachedCell(int row, int column) const
+{
+    return m_cells.isEmpty() ? 0 : m_cells.value(key(row, column));
+}
+
+void CellTable::setCachedCell(int row, int column, Cell *cell) const
+{
+    Q_ASSERT(!m_cells.contains(key(row, column)));
+    m_cells.insert(key(row, column), cell);
+}
+
+int CellTable::firstRow() const
+{
+    if (m_rowCount == 0)
+        return -1;
+    return nextRow((m_firstBlock << BlockShift) - 1);
+}
+
+int CellTable::lastRow() const
+{
+    if (m_rowCount == 0)
+        return -1;
+    const Block *block = m_blocks.last();
+    int i = BlockSize - 1;
+    while (block->rows[i].count == 0)
+        --i;
+    return ((m_blocks.size() - 1) << BlockShift) + i;
+}
+
+int CellTable::nextRow(int row) const
+{
+    int b = (row + 1) >> BlockShift;
+    int i = (row + 1) & (BlockSize - 1);
+    if (b < m_firstBlock) {
+        b = m_firstBlock;
+        i = 0;
+    }
+    for (; b < m_blocks.size(); ++b, i = 0) {
+        const Block *block = m_blocks.at(b);
+        if (!block)
+            continue;
+        for (; i < BlockSize; ++i) {
+            if (block->rows[i].count)
+                return (b << BlockShift) + i;
+        }
+    }
+    return -1;
+}
+
+int CellTable::firstColumn(int row) const
+{
+    const Row *r = findRow(row);
+    if (!r)
+        return -1;
+    return r->isDense() ? r->first : r->columns.first();
+}
+
+int CellTable::lastColumn(int row) const
+{
+    const Row *r = findRow(row);
+    return r ? r->lastColumn() : -1;
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,254 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXCELLTABLE_P_H
+#define QXLSX_XLSXCELLTABLE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+#include "xlsxcell.h"
+#include "xlsxcellformula.h"
+#include "xlsxformat.h"
+#include "xlsxrichstring.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+namespace QXlsx {
+
+/*
+ * Compact value of one cell. Numbers are kept inline, booleans and shared
+ * strings as an index, the format as an index into the style table of the
+ * CellTable. Formulas and the text of the other string types are kept in a
+ * side table of the CellTable.
+ */
+struct CellData
+{
+    enum Flag {
+        Blank = 0x1, // no <v>, the value reads as an invalid QVariant
+        HasFormula = 0x2,
+        HasText = 0x4
+    };
+    enum { NullType = 0xff };
+
+    CellData()
+        : number(0)
+        , style(0)
+        , type(NullType)
+        , flags(0)
+    {
+    }
+    CellData(Cell::CellType type, int style)
+        : number(0)
+        , style(style)
+        , type(type)
+        , flags(0)
+    {
+    }
+
+    bool isNull() const { return type == NullType; }
+    Cell::CellType cellType() const { return Cell::CellType(type); }
+
+    union {
+        double number; // NumberType
+        int index; // BooleanType: 0 or 1, SharedStringType: string index
+    };
+    int style;
+    quint8 type;
+    quint8 flags;
+};
+Q_STATIC_ASSERT(sizeof(CellData) == 16);
+
+/*
+ * Cell storage of a worksheet.
+ *
+ * Rows are grouped in blocks of 64, a block is only allocated once one of its
+ * rows holds a cell. A row keeps its cells in a dense array indexed by column,
+ * holes included. Once the holes would outnumber the cells, the row switches
+ * to sorted parallel arrays of columns and cells, and back when it fills up.
+ * Cells of a row are always visited in column order.
+ *
+ * Cell objects are only created when the API hands one out, the table keeps
+ * them until their cell is overwritten or removed.
+ */
+class XLSX_AUTOTEST_EXPORT CellTable
+{
+public:
+    CellTable();
+    ~CellTable();
+
+    bool isEmpty() const { return m_rowCount == 0; }
+    // Number of rows holding at least one cell
+    int rowCount() const { return m_rowCount; }
+    bool containsRow(int row) const { return findRow(row) != 0; }
+
+    const CellData *cell(int row, int column) const;
+    void setCell(int row, int column, const CellData &data);
+    void removeRow(int row);
+    void clear();
+
+    // Side table, only valid for existing cells
+    CellFormula formula(int row, int column) const;
+    void setFormula(int row, int column, const CellFormula &formula);
+    RichString text(int row, int column) const;
+    void setText(int row, int column, const RichString &text);
+
+    // Formats are interned, index 0 is the invalid Format()
+    int addFormat(const Format &format);
+    const Format &format(int style) const { return m_formats.at(style); }
+    bool isDateTimeFormat(int style) const { return m_dateTimeFormats.at(style); }
+    void setFormat(int row, int column, const Format &format);
+
+    Cell *cachedCell(int row, int column) const;
+    // Takes ownership of cell
+    void setCachedCell(int row, int column, Cell *cell) const;
+
+    // -1 when there is no such row
+    int firstRow() const;
+    int lastRow() const;
+    int nextRow(int row) const;
+    int firstColumn(int row) const;
+    int lastColumn(int row) const;
+
+    // Calls f(column, cell) for the cells of row in column order
+    template <typename Function>
+    void forEachCellInRow(int row, Function f) const
+    {
+        if (const Row *r = findRow(row))
+            r->forEach(f);
+    }
+
+    // Calls f(row, column, cell) for all cells in row order
+    template <typename Function>
+    void forEachCell(Function f) const
+    {
+        for (int row = firstRow(); row != -1; row = nextRow(row)) {
+            findRow(row)->forEach(
+                [&f, row](int column, const CellData &cell) { f(row, column, cell); });
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(CellTable)
+
+    enum {
+        BlockShift = 6,
+        BlockSize = 1 << BlockShift,
+        // A dense row may carry this many holes besides one per cell
+        DenseSlack = 16
+    };
+
+    struct Row
+    {
+        Row()
+            : first(0)
+            , count(0)
+        {
+        }
+
+        bool isDense() const { return columns.isEmpty(); }
+        int lastColumn() const;
+        CellData *find(int column);
+        const CellData *find(int column) const;
+        void insert(int column, const CellData &cell);
+        void makeDense();
+        void makeSparse();
+
+        template <typename Function>
+        void forEach(Function f) const
+        {
+            const CellData *it = cells.constData();
+            const CellData *end = it + cells.size();
+            if (isDense()) {
+                for (int column = first; it != end; ++it, ++column) {
+                    if (!it->isNull())
+                        f(column, *it);
+                }
+            } else {
+                for (const int *column = columns.constData(); it != end; ++it, ++column)
+                    f(*column, *it);
+            }
+        }
+
+        // Dense: cells[i] is at column first + i, null cells are holes.
+        // Sparse: cells[i] is at columns[i].
+        int first;
+        int count;
+        QVector<int> columns;
+        QVector<CellData> cells;
+    };
+
+    struct Block
+    {
+        Block()
+            : usedRows(0)
+        {
+        }
+
+        Row rows[BlockSize];
+        int usedRows;
+    };
+
+    struct Extra
+    {
+        CellFormula formula;
+        RichString text;
+    };
+
+    static quint64 key(int row, int column)
+    {
+        return quint64(quint32(row)) << 32 | quint32(column);
+    }
+    const Row *findRow(int row) const;
+    CellData *findCell(int row, int column);
+    void dropSideData(quint64 key, const CellData &cell);
+
+    QVector<Block *> m_blocks;
+    // Index of the first allocated block, m_blocks.size() when empty
+    int m_firstBlock;
+    int m_rowCount;
+
+    QHash<quint64, Extra> m_extras;
+    mutable QHash<quint64, Cell *> m_cells;
+
+    QVector<Format> m_formats;
+    QVector<bool> m_dateTimeFormats;
+    QHash<QPair<QByteArray, int>, int> m_formatIndexes;
+};
+}
+Q_DECLARE_TYPEINFO(QXlsx::CellData, Q_MOVABLE_TYPE);
+
+#endif // QXLSX_XLSXCELLTABLE_P_H
@@ -401,7 +401,9 @@ bool DataValidation::saveToXml(QXmlStreamWriter &writer) const
     static QMap<DataValidation::ValidationType, QString> typeMap;
     static QMap<DataValidation::ValidationOperator, QString> opMap;
     static QMap<DataValidation::ErrorStyle, QString> esMap;
-    if (typeMap.isEmpty()) {
+    // Sheets are saved on several threads, so the maps are filled by the
+    // initializer of a static, which runs exactly once
+    static const bool initialized = [] {
         typeMap.insert(DataValidation::None, QStringLiteral("none"));
         typeMap.insert(DataValidation::Whole, QStringLiteral("whole"));
         typeMap.insert(DataValidation::Decimal, QStringLiteral("decimal"));
@@ -423,15 +425,17 @@ bool DataValidation::saveToXml(QXmlStreamWriter &writer) const
         esMap.insert(DataValidation::Stop, QStringLiteral("stop"));
         esMap.insert(DataValidation::Warning, QStringLiteral("warning"));
         esMap.insert(DataValidation::Information, QStringLiteral("information"));
-    }
+        return true;
+    }();
+    Q_UNUSED(initialized);
 
     writer.writeStartElement(QStringLiteral("dataValidation"));
     if (validationType() != DataValidation::None)
-        writer.writeAttribute(QStringLiteral("type"), typeMap[validationType()]);
+        writer.writeAttribute(QStringLiteral("type"), typeMap.value(validationType()));
     if (errorStyle() != DataValidation::Stop)
-        writer.writeAttribute(QStringLiteral("errorStyle"), esMap[errorStyle()]);
+        writer.writeAttribute(QStringLiteral("errorStyle"), esMap.value(errorStyle()));
     if (validationOperator() != DataValidation::Between)
-        writer.writeAttribute(QStringLiteral("operator"), opMap[validationOperator()]);
+        writer.writeAttribute(QStringLiteral("operator"), opMap.value(validationOperator()));
     if (allowBlank())
         writer.writeAttribute(QStringLiteral("allowBlank"), QStringLiteral("1"));
     //        if (dropDownVisible())
@@ -27,6 +27,7 @@
 #include "xlsxdocument_p.h"
 #include "xlsxworkbook.h"
 #include "xlsxworksheet.h"
+#include "xlsxworksheet_p.h"
 #include "xlsxcontenttypes_p.h"
 #include "xlsxrelationships_p.h"
 #include "xlsxstyles_p.h"
@@ -46,6 +47,9 @@
 #include <QPointF>
 #include <QBuffer>
 #include <QDir>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -239,6 +243,83 @@ bool DocumentPrivate::loadPackage(QIODevice *device)
     return true;
 }
 
+namespace {
+
+/*
+  One file of the package. Files that only read the document, such as
+  sheets, drawings and charts, are saved by a PackagePartTask, the
+  others are saved up front and only compressed there.
+ */
+struct PackagePart
+{
+    PackagePart()
+        : file(0)
+        , stream(0)
+    {
+    }
+
+    QString path;
+    QString relationshipsPath; // written when file has relationships
+    const AbstractOOXmlFile *file;
+    QByteArray contents; // used when there is no file
+    DeflateStream *stream; // a streamed sheet, deflated already
+    ZipWriter::PreparedFile data;
+    ZipWriter::PreparedFile relationships;
+};
+
+class PackagePartTask : public QRunnable
+{
+public:
+    explicit PackagePartTask(PackagePart *part)
+        : m_part(part)
+    {
+    }
+
+    void run()
+    {
+        if (m_part->file) {
+            m_part->data = ZipWriter::prepareFile(m_part->file->saveToXmlData());
+            // The relationships are collected while saving the file
+            Relationships *rel = m_part->file->relationships();
+            if (!m_part->relationshipsPath.isEmpty() && !rel->isEmpty())
+                m_part->relationships = ZipWriter::prepareFile(rel->saveToXmlData());
+        } else {
+            m_part->data = ZipWriter::prepareFile(m_part->contents);
+            m_part->contents.clear();
+        }
+    }
+
+private:
+    PackagePart *m_part;
+};
+
+PackagePart filePart(const QString &path, const AbstractOOXmlFile *file,
+                     const QString &relationshipsPath = QString())
+{
+    PackagePart part;
+    part.path = path;
+    part.file = file;
+    part.relationshipsPath = relationshipsPath;
+    return part;
+}
+
+PackagePart contentsPart(const QString &path, const QByteArray &contents)
+{
+    PackagePart part;
+    part.path = path;
+    part.contents = contents;
+    return part;
+}
+
+} // namespace
+
+/*
+  The parts are listed first, in package order. Everything that changes
+  shared state - streamed sheets, the workbook, shared strings and styles -
+  is saved while listing. The rest is saved and deflated on a thread pool,
+  and the results are written in list order, so the package is the same
+  as when saving one part after the other.
+ */
 bool DocumentPrivate::savePackage(QIODevice *device) const
 {
     Q_Q(const Document);
@@ -250,6 +331,7 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
 
     DocPropsApp docPropsApp(DocPropsApp::F_NewFromScratch);
     DocPropsCore docPropsCore(DocPropsCore::F_NewFromScratch);
+    QVector<PackagePart> parts;
 
     // save worksheet xml files
     QList<QSharedPointer<AbstractSheet>> worksheets =
@@ -261,12 +343,20 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i + 1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/worksheets/sheet%1.xml").arg(i + 1),
-                          sheet->saveToXmlData());
-        Relationships *rel = sheet->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i + 1),
-                              rel->saveToXmlData());
+        PackagePart part =
+            filePart(QStringLiteral("xl/worksheets/sheet%1.xml").arg(i + 1), sheet.data(),
+                     QStringLiteral("xl/worksheets/_rels/sheet%1.xml.rels").arg(i + 1));
+        WorksheetPrivate *sheet_d = static_cast<Worksheet *>(sheet.data())->d_func();
+        if (sheet_d->stream) {
+            // The rows are deflated already, only the end of the sheet is missing
+            if (!sheet_d->finishStream())
+                return false;
+            part.stream = sheet_d->stream.data();
+            Relationships *rel = sheet->relationships();
+            if (!rel->isEmpty())
+                part.relationships = ZipWriter::prepareFile(rel->saveToXmlData());
+        }
+        parts.append(part);
     }
 
     // save chartsheet xml files
@@ -279,12 +369,8 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         contentTypes->addWorksheetName(QStringLiteral("sheet%1").arg(i + 1));
         docPropsApp.addPartTitle(sheet->sheetName());
 
-        zipWriter.addFile(QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i + 1),
-                          sheet->saveToXmlData());
-        Relationships *rel = sheet->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i + 1),
-                              rel->saveToXmlData());
+        parts.append(filePart(QStringLiteral("xl/chartsheets/sheet%1.xml").arg(i + 1), sheet.data(),
+                              QStringLiteral("xl/chartsheets/_rels/sheet%1.xml.rels").arg(i + 1)));
     }
 
     // save external links xml files
@@ -292,31 +378,24 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         SimpleOOXmlFile *link = workbook->d_func()->externalLinks[i].data();
         contentTypes->addExternalLinkName(QStringLiteral("externalLink%1").arg(i + 1));
 
-        zipWriter.addFile(QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i + 1),
-                          link->saveToXmlData());
-        Relationships *rel = link->relationships();
-        if (!rel->isEmpty())
-            zipWriter.addFile(
-                QStringLiteral("xl/externalLinks/_rels/externalLink%1.xml.rels").arg(i + 1),
-                rel->saveToXmlData());
+        parts.append(
+            filePart(QStringLiteral("xl/externalLinks/externalLink%1.xml").arg(i + 1), link,
+                     QStringLiteral("xl/externalLinks/_rels/externalLink%1.xml.rels").arg(i + 1)));
     }
 
     // save workbook xml file
     contentTypes->addWorkbook();
-    zipWriter.addFile(QStringLiteral("xl/workbook.xml"), workbook->saveToXmlData());
-    zipWriter.addFile(QStringLiteral("xl/_rels/workbook.xml.rels"),
-                      workbook->relationships()->saveToXmlData());
+    parts.append(contentsPart(QStringLiteral("xl/workbook.xml"), workbook->saveToXmlData()));
+    parts.append(contentsPart(QStringLiteral("xl/_rels/workbook.xml.rels"),
+                              workbook->relationships()->saveToXmlData()));
 
     // save drawing xml files
     for (int i = 0; i < workbook->drawings().size(); ++i) {
         contentTypes->addDrawingName(QStringLiteral("drawing%1").arg(i + 1));
 
         Drawing *drawing = workbook->drawings()[i];
-        zipWriter.addFile(QStringLiteral("xl/drawings/drawing%1.xml").arg(i + 1),
-                          drawing->saveToXmlData());
-        if (!drawing->relationships()->isEmpty())
-            zipWriter.addFile(QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i + 1),
-                              drawing->relationships()->saveToXmlData());
+        parts.append(filePart(QStringLiteral("xl/drawings/drawing%1.xml").arg(i + 1), drawing,
+                              QStringLiteral("xl/drawings/_rels/drawing%1.xml.rels").arg(i + 1)));
     }
 
     // save docProps app/core xml file
@@ -326,29 +405,30 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
     }
     contentTypes->addDocPropApp();
     contentTypes->addDocPropCore();
-    zipWriter.addFile(QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData());
-    zipWriter.addFile(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData());
+    parts.append(contentsPart(QStringLiteral("docProps/app.xml"), docPropsApp.saveToXmlData()));
+    parts.append(contentsPart(QStringLiteral("docProps/core.xml"), docPropsCore.saveToXmlData()));
 
     // save sharedStrings xml file
     if (!workbook->sharedStrings()->isEmpty()) {
         contentTypes->addSharedString();
-        zipWriter.addFile(QStringLiteral("xl/sharedStrings.xml"),
-                          workbook->sharedStrings()->saveToXmlData());
+        parts.append(contentsPart(QStringLiteral("xl/sharedStrings.xml"),
+                                  workbook->sharedStrings()->saveToXmlData()));
     }
 
     // save styles xml file
     contentTypes->addStyles();
-    zipWriter.addFile(QStringLiteral("xl/styles.xml"), workbook->styles()->saveToXmlData());
+    parts.append(
+        contentsPart(QStringLiteral("xl/styles.xml"), workbook->styles()->saveToXmlData()));
 
     // save theme xml file
     contentTypes->addTheme();
-    zipWriter.addFile(QStringLiteral("xl/theme/theme1.xml"), workbook->theme()->saveToXmlData());
+    parts.append(filePart(QStringLiteral("xl/theme/theme1.xml"), workbook->theme()));
 
     // save chart xml files
     for (int i = 0; i < workbook->chartFiles().size(); ++i) {
         contentTypes->addChartName(QStringLiteral("chart%1").arg(i + 1));
         QSharedPointer<Chart> cf = workbook->chartFiles()[i];
-        zipWriter.addFile(QStringLiteral("xl/charts/chart%1.xml").arg(i + 1), cf->saveToXmlData());
+        parts.append(filePart(QStringLiteral("xl/charts/chart%1.xml").arg(i + 1), cf.data()));
     }
 
     // save image files
@@ -357,8 +437,8 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
         if (!mf->mimeType().isEmpty())
             contentTypes->addDefault(mf->suffix(), mf->mimeType());
 
-        zipWriter.addFile(QStringLiteral("xl/media/image%1.%2").arg(i + 1).arg(mf->suffix()),
-                          mf->contents());
+        parts.append(contentsPart(
+            QStringLiteral("xl/media/image%1.%2").arg(i + 1).arg(mf->suffix()), mf->contents()));
     }
 
     // save root .rels xml file
@@ -369,13 +449,31 @@ bool DocumentPrivate::savePackage(QIODevice *device) const
                                     QStringLiteral("docProps/core.xml"));
     rootrels.addDocumentRelationship(QStringLiteral("/extended-properties"),
                                      QStringLiteral("docProps/app.xml"));
-    zipWriter.addFile(QStringLiteral("_rels/.rels"), rootrels.saveToXmlData());
+    parts.append(contentsPart(QStringLiteral("_rels/.rels"), rootrels.saveToXmlData()));
 
     // save content types xml file
-    zipWriter.addFile(QStringLiteral("[Content_Types].xml"), contentTypes->saveToXmlData());
+    parts.append(
+        contentsPart(QStringLiteral("[Content_Types].xml"), contentTypes->saveToXmlData()));
+
+    QThreadPool pool;
+    for (int i = 0; i < parts.size(); ++i) {
+        if (!parts[i].stream)
+            pool.start(new PackagePartTask(&parts[i]));
+    }
+    pool.waitForDone();
+
+    for (int i = 0; i < parts.size(); ++i) {
+        const PackagePart &part = parts.at(i);
+        if (part.stream)
+            zipWriter.addDeflatedFile(part.path, part.stream);
+        else
+            zipWriter.addPreparedFile(part.path, part.data);
+        if (part.relationships.size)
+            zipWriter.addPreparedFile(part.relationshipsPath, part.relationships);
+    }
 
     zipWriter.close();
-    return true;
+    return !zipWriter.error();
 }
 
 /*!
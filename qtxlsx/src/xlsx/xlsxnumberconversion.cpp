@@ -0,0 +1,497 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxnumberconversion_p.h"
+
+#include <QByteArray>
+
+#include <math.h>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+/*
+ * Grisu2 as described by Florian Loitsch in "Printing Floating-Point Numbers
+ * Quickly and Accurately with Integers" (PLDI 2010). The digits it produces
+ * always read back as the input, and are the shortest such digits for
+ * almost all inputs.
+ */
+struct DiyFp
+{
+    DiyFp(quint64 f, int e)
+        : f(f)
+        , e(e)
+    {
+    }
+
+    DiyFp operator-(const DiyFp &rhs) const { return DiyFp(f - rhs.f, e); }
+
+    DiyFp operator*(const DiyFp &rhs) const
+    {
+        const quint64 M32 = 0xFFFFFFFFu;
+        const quint64 a = f >> 32;
+        const quint64 b = f & M32;
+        const quint64 c = rhs.f >> 32;
+        const quint64 d = rhs.f & M32;
+        const quint64 ac = a * c;
+        const quint64 bc = b * c;
+        const quint64 ad = a * d;
+        const quint64 bd = b * d;
+        quint64 tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+        tmp += 1U << 31; // round
+        return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+    }
+
+    quint64 f;
+    int e;
+};
+
+const int SignificandSize = 52;
+const int ExponentBias = 0x3FF + SignificandSize;
+const int MinExponent = -ExponentBias;
+const quint64 ExponentMask = Q_UINT64_C(0x7FF0000000000000);
+const quint64 SignificandMask = Q_UINT64_C(0x000FFFFFFFFFFFFF);
+const quint64 HiddenBit = Q_UINT64_C(0x0010000000000000);
+
+DiyFp diyFpFromDouble(quint64 bits)
+{
+    const int biasedExponent = int((bits & ExponentMask) >> SignificandSize);
+    const quint64 significand = bits & SignificandMask;
+    if (biasedExponent != 0)
+        return DiyFp(significand + HiddenBit, biasedExponent - ExponentBias);
+    return DiyFp(significand, MinExponent + 1);
+}
+
+DiyFp normalize(DiyFp v)
+{
+    while (!(v.f & (HiddenBit << 11))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    return v;
+}
+
+DiyFp normalizeBoundary(DiyFp v)
+{
+    while (!(v.f & (HiddenBit << 1))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    v.f <<= 64 - SignificandSize - 2;
+    v.e -= 64 - SignificandSize - 2;
+    return v;
+}
+
+// 10^k for k = -348, -340, ..., 340, normalized to 64 bits
+const quint64 CachedPowersF[] = {
+    Q_UINT64_C(0xfa8fd5a0081c0288), Q_UINT64_C(0xbaaee17fa23ebf76), Q_UINT64_C(0x8b16fb203055ac76),
+    Q_UINT64_C(0xcf42894a5dce35ea), Q_UINT64_C(0x9a6bb0aa55653b2d), Q_UINT64_C(0xe61acf033d1a45df),
+    Q_UINT64_C(0xab70fe17c79ac6ca), Q_UINT64_C(0xff77b1fcbebcdc4f), Q_UINT64_C(0xbe5691ef416bd60c),
+    Q_UINT64_C(0x8dd01fad907ffc3c), Q_UINT64_C(0xd3515c2831559a83), Q_UINT64_C(0x9d71ac8fada6c9b5),
+    Q_UINT64_C(0xea9c227723ee8bcb), Q_UINT64_C(0xaecc49914078536d), Q_UINT64_C(0x823c12795db6ce57),
+    Q_UINT64_C(0xc21094364dfb5637), Q_UINT64_C(0x9096ea6f3848984f), Q_UINT64_C(0xd77485cb25823ac7),
+    Q_UINT64_C(0xa086cfcd97bf97f4), Q_UINT64_C(0xef340a98172aace5), Q_UINT64_C(0xb23867fb2a35b28e),
+    Q_UINT64_C(0x84c8d4dfd2c63f3b), Q_UINT64_C(0xc5dd44271ad3cdba), Q_UINT64_C(0x936b9fcebb25c996),
+    Q_UINT64_C(0xdbac6c247d62a584), Q_UINT64_C(0xa3ab66580d5fdaf6), Q_UINT64_C(0xf3e2f893dec3f126),
+    Q_UINT64_C(0xb5b5ada8aaff80b8), Q_UINT64_C(0x87625f056c7c4a8b), Q_UINT64_C(0xc9bcff6034c13053),
+    Q_UINT64_C(0x964e858c91ba2655), Q_UINT64_C(0xdff9772470297ebd), Q_UINT64_C(0xa6dfbd9fb8e5b88f),
+    Q_UINT64_C(0xf8a95fcf88747d94), Q_UINT64_C(0xb94470938fa89bcf), Q_UINT64_C(0x8a08f0f8bf0f156b),
+    Q_UINT64_C(0xcdb02555653131b6), Q_UINT64_C(0x993fe2c6d07b7fac), Q_UINT64_C(0xe45c10c42a2b3b06),
+    Q_UINT64_C(0xaa242499697392d3), Q_UINT64_C(0xfd87b5f28300ca0e), Q_UINT64_C(0xbce5086492111aeb),
+    Q_UINT64_C(0x8cbccc096f5088cc), Q_UINT64_C(0xd1b71758e219652c), Q_UINT64_C(0x9c40000000000000),
+    Q_UINT64_C(0xe8d4a51000000000), Q_UINT64_C(0xad78ebc5ac620000), Q_UINT64_C(0x813f3978f8940984),
+    Q_UINT64_C(0xc097ce7bc90715b3), Q_UINT64_C(0x8f7e32ce7bea5c70), Q_UINT64_C(0xd5d238a4abe98068),
+    Q_UINT64_C(0x9f4f2726179a2245), Q_UINT64_C(0xed63a231d4c4fb27), Q_UINT64_C(0xb0de65388cc8ada8),
+    Q_UINT64_C(0x83c7088e1aab65db), Q_UINT64_C(0xc45d1df942711d9a), Q_UINT64_C(0x924d692ca61be758),
+    Q_UINT64_C(0xda01ee641a708dea), Q_UINT64_C(0xa26da3999aef774a), Q_UINT64_C(0xf209787bb47d6b85),
+    Q_UINT64_C(0xb454e4a179dd1877), Q_UINT64_C(0x865b86925b9bc5c2), Q_UINT64_C(0xc83553c5c8965d3d),
+    Q_UINT64_C(0x952ab45cfa97a0b3), Q_UINT64_C(0xde469fbd99a05fe3), Q_UINT64_C(0xa59bc234db398c25),
+    Q_UINT64_C(0xf6c69a72a3989f5c), Q_UINT64_C(0xb7dcbf5354e9bece), Q_UINT64_C(0x88fcf317f22241e2),
+    Q_UINT64_C(0xcc20ce9bd35c78a5), Q_UINT64_C(0x98165af37b2153df), Q_UINT64_C(0xe2a0b5dc971f303a),
+    Q_UINT64_C(0xa8d9d1535ce3b396), Q_UINT64_C(0xfb9b7cd9a4a7443c), Q_UINT64_C(0xbb764c4ca7a44410),
+    Q_UINT64_C(0x8bab8eefb6409c1a), Q_UINT64_C(0xd01fef10a657842c), Q_UINT64_C(0x9b10a4e5e9913129),
+    Q_UINT64_C(0xe7109bfba19c0c9d), Q_UINT64_C(0xac2820d9623bf429), Q_UINT64_C(0x80444b5e7aa7cf85),
+    Q_UINT64_C(0xbf21e44003acdd2d), Q_UINT64_C(0x8e679c2f5e44ff8f), Q_UINT64_C(0xd433179d9c8cb841),
+    Q_UINT64_C(0x9e19db92b4e31ba9), Q_UINT64_C(0xeb96bf6ebadf77d9), Q_UINT64_C(0xaf87023b9bf0ee6b),
+};
+
+const qint16 CachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+DiyFp cachedPower(int e, int *K)
+{
+    const double dk = (-61 - e) * 0.30102999566398114 + 347; // dk must be positive
+    int k = int(dk);
+    if (dk - k > 0.0)
+        k++;
+
+    const unsigned index = unsigned((k >> 3) + 1);
+    *K = -(-348 + int(index * 8)); // decimal exponent, no need for lookup table
+    return DiyFp(CachedPowersF[index], CachedPowersE[index]);
+}
+
+const quint64 Pow10[] = {
+    Q_UINT64_C(1), Q_UINT64_C(10), Q_UINT64_C(100), Q_UINT64_C(1000), Q_UINT64_C(10000),
+    Q_UINT64_C(100000), Q_UINT64_C(1000000), Q_UINT64_C(10000000), Q_UINT64_C(100000000),
+    Q_UINT64_C(1000000000), Q_UINT64_C(10000000000), Q_UINT64_C(100000000000),
+    Q_UINT64_C(1000000000000), Q_UINT64_C(10000000000000), Q_UINT64_C(100000000000000),
+    Q_UINT64_C(1000000000000000), Q_UINT64_C(10000000000000000), Q_UINT64_C(100000000000000000),
+    Q_UINT64_C(1000000000000000000), Q_UINT64_C(10000000000000000000),
+};
+
+int countDecimalDigits(quint32 n)
+{
+    int digits = 1;
+    while (digits < 10 && n >= quint32(Pow10[digits]))
+        digits++;
+    return digits;
+}
+
+void grisuRound(char *buffer, int len, quint64 delta, quint64 rest, quint64 tenKappa, quint64 wpW)
+{
+    while (rest < wpW && delta - rest >= tenKappa
+           && (rest + tenKappa < wpW || wpW - rest > rest + tenKappa - wpW)) {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+void digitGen(const DiyFp &W, const DiyFp &Mp, quint64 delta, char *buffer, int *len, int *K)
+{
+    const DiyFp one(quint64(1) << -Mp.e, Mp.e);
+    const DiyFp wpW = Mp - W;
+    quint32 p1 = quint32(Mp.f >> -one.e);
+    quint64 p2 = Mp.f & (one.f - 1);
+    int kappa = countDecimalDigits(p1);
+    *len = 0;
+
+    while (kappa > 0) {
+        const quint32 d = p1 / quint32(Pow10[kappa - 1]);
+        p1 %= quint32(Pow10[kappa - 1]);
+        if (d || *len)
+            buffer[(*len)++] = char('0' + d);
+        kappa--;
+        const quint64 tmp = (quint64(p1) << -one.e) + p2;
+        if (tmp <= delta) {
+            *K += kappa;
+            grisuRound(buffer, *len, delta, tmp, Pow10[kappa] << -one.e, wpW.f);
+            return;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        const char d = char(p2 >> -one.e);
+        if (d || *len)
+            buffer[(*len)++] = char('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *K += kappa;
+            const int index = -kappa;
+            grisuRound(buffer, *len, delta, p2, one.f, wpW.f * (index < 20 ? Pow10[index] : 0));
+            return;
+        }
+    }
+}
+
+/*
+ * Digits of a finite, positive value, the value is digits * 10^K.
+ */
+int grisu2(quint64 bits, char *buffer, int *K)
+{
+    const DiyFp v = diyFpFromDouble(bits);
+    const DiyFp plus = normalizeBoundary(DiyFp((v.f << 1) + 1, v.e - 1));
+    DiyFp minus = (v.f == HiddenBit) ? DiyFp((v.f << 2) - 1, v.e - 2)
+                                     : DiyFp((v.f << 1) - 1, v.e - 1);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    const DiyFp c_mk = cachedPower(plus.e, K);
+    const DiyFp W = normalize(v) * c_mk;
+    DiyFp Wp = plus * c_mk;
+    DiyFp Wm = minus * c_mk;
+    Wm.f++;
+    Wp.f--;
+    int len;
+    digitGen(W, Wp, Wp.f - Wm.f, buffer, &len, K);
+    return len;
+}
+
+char *formatUnsigned(quint64 value, char *buffer)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n)
+        *buffer++ = digits[--n];
+    return buffer;
+}
+
+const double ExactPowersOf10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+inline uint code(char c)
+{
+    return uchar(c);
+}
+
+inline uint code(QChar c)
+{
+    return c.unicode();
+}
+
+inline bool isSpace(uint c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+enum ParseResult { Parsed, NotParsed, Invalid };
+
+/*
+ * The fast path of Clinger's algorithm: when the decimal significand fits
+ * into the 53 bits of a double and the power of ten is exact as well, one
+ * correctly rounded multiplication or division gives the correct result.
+ * Everything else is left to the slow path.
+ */
+template <typename Char>
+ParseResult parseDecimal(const Char *p, const Char *last, double *value)
+{
+    while (p != last && isSpace(code(*p)))
+        ++p;
+    while (p != last && isSpace(code(last[-1])))
+        --last;
+
+    bool negative = false;
+    if (p != last && (code(*p) == '-' || code(*p) == '+')) {
+        negative = code(*p) == '-';
+        ++p;
+    }
+
+    quint64 mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    int significantDigits = 0;
+    for (; p != last && code(*p) - '0' < 10; ++p, ++digits) {
+        if (mantissa || code(*p) != '0') {
+            if (++significantDigits > 19)
+                return NotParsed;
+            mantissa = mantissa * 10 + (code(*p) - '0');
+        }
+    }
+    if (p != last && code(*p) == '.') {
+        for (++p; p != last && code(*p) - '0' < 10; ++p, ++digits) {
+            if (mantissa || code(*p) != '0') {
+                if (++significantDigits > 19)
+                    return NotParsed;
+                mantissa = mantissa * 10 + (code(*p) - '0');
+            }
+            --exponent;
+        }
+    }
+    if (!digits)
+        return NotParsed; // inf, nan or not a number at all
+
+    if (p != last && (code(*p) == 'e' || code(*p) == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p != last && (code(*p) == '-' || code(*p) == '+')) {
+            negativeExponent = code(*p) == '-';
+            ++p;
+        }
+        if (p == last || code(*p) - '0' >= 10)
+            return Invalid;
+        int e = 0;
+        for (; p != last && code(*p) - '0' < 10; ++p) {
+            if (e < 100000)
+                e = e * 10 + int(code(*p) - '0');
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+    if (p != last)
+        return Invalid;
+
+    const quint64 MaxExactInteger = Q_UINT64_C(1) << 53;
+    if (mantissa > MaxExactInteger)
+        return NotParsed;
+
+    double result = double(mantissa);
+    if (mantissa == 0) {
+        result = 0;
+    } else if (exponent < 0) {
+        if (exponent < -22)
+            return NotParsed;
+        result /= ExactPowersOf10[-exponent];
+    } else if (exponent > 0) {
+        // 123e25 is 123000e22, if the digits still fit
+        for (; exponent > 22 && mantissa <= MaxExactInteger / 10; --exponent)
+            mantissa *= 10;
+        if (exponent > 22)
+            return NotParsed;
+        result = double(mantissa) * ExactPowersOf10[exponent];
+    }
+    *value = negative ? -result : result;
+    return Parsed;
+}
+
+/*
+ * Full precision conversion through Qt's own, locale independent parser.
+ */
+bool parseSlow(const char *first, const char *last, double *value)
+{
+    bool ok = false;
+    *value = QByteArray(first, int(last - first)).toDouble(&ok);
+    return ok;
+}
+
+} // namespace
+
+/*
+ * Writes \a value to \a buffer, which must have room for DoubleBufferSize
+ * chars, and returns the length. The notation follows printf's %g with 17
+ * digits, except that only as many digits are written as are needed.
+ */
+int formatDouble(double value, char *buffer)
+{
+    char *p = buffer;
+    if (qIsNaN(value)) {
+        memcpy(buffer, "nan", 3);
+        return 3;
+    }
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 63) {
+        *p++ = '-';
+        bits &= ~(Q_UINT64_C(1) << 63);
+        value = -value;
+    }
+    if (qIsInf(value)) {
+        memcpy(p, "inf", 3);
+        return int(p + 3 - buffer);
+    }
+    if (value < 1e15 && value == floor(value))
+        return int(formatUnsigned(quint64(value), p) - buffer);
+
+    char digits[20];
+    int K = 0;
+    const int length = grisu2(bits, digits, &K);
+    const int decimalExponent = length + K - 1;
+
+    if (decimalExponent < -4 || decimalExponent >= 17) {
+        // d.ddde+XX
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, length - 1);
+            p += length - 1;
+        }
+        *p++ = 'e';
+        *p++ = decimalExponent < 0 ? '-' : '+';
+        const int e = qAbs(decimalExponent);
+        if (e < 10)
+            *p++ = '0';
+        p = formatUnsigned(quint64(e), p);
+    } else if (decimalExponent < 0) {
+        // 0.000ddd
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = decimalExponent + 1; i < 0; ++i)
+            *p++ = '0';
+        memcpy(p, digits, length);
+        p += length;
+    } else if (length <= decimalExponent + 1) {
+        // ddd000
+        memcpy(p, digits, length);
+        p += length;
+        for (int i = length; i <= decimalExponent; ++i)
+            *p++ = '0';
+    } else {
+        // ddd.ddd
+        memcpy(p, digits, decimalExponent + 1);
+        p += decimalExponent + 1;
+        *p++ = '.';
+        memcpy(p, digits + decimalExponent + 1, length - decimalExponent - 1);
+        p += length - decimalExponent - 1;
+    }
+    return int(p - buffer);
+}
+
+/*
+ * Reads the number in [\a first, \a last), surrounding white space is
+ * ignored. On failure \a value is set to 0 and false is returned, as
+ * QString::toDouble() does.
+ */
+bool parseDouble(const char *first, const char *last, double *value)
+{
+    switch (parseDecimal(first, last, value)) {
+    case Parsed:
+        return true;
+    case NotParsed:
+        return parseSlow(first, last, value);
+    default:
+        *value = 0;
+        return false;
+    }
+}
+
+bool parseDouble(const QChar *first, const QChar *last, double *value)
+{
+    switch (parseDecimal(first, last, value)) {
+    case Parsed:
+        return true;
+    case NotParsed:
+        break;
+    default:
+        *value = 0;
+        return false;
+    }
+
+    QByteArray latin1(int(last - first), Qt::Uninitialized);
+    for (int i = 0; i < latin1.size(); ++i) {
+        if (first[i].unicode() > 0x7f) {
+            *value = 0;
+            return false;
+        }
+        latin1[i] = char(first[i].unicode());
+    }
+    return parseSlow(latin1.constData(), latin1.constData() + latin1.size(), value);
+}
+
+QT_END_NAMESPACE_XLSX
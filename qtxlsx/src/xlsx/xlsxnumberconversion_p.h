@@ -0,0 +1,60 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXNUMBERCONVERSION_P_H
+#define QXLSX_XLSXNUMBERCONVERSION_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+#include <QChar>
+
+namespace QXlsx {
+
+/*
+ * Conversion of cell values between double and the text of a <v> element.
+ *
+ * formatDouble() writes the shortest digits that read back as the same
+ * double (Grisu2), so no value loses its last bit on a save and load cycle.
+ * parseDouble() reads the decimal notation of numbers without going
+ * through QString. Both are independent of the locale.
+ */
+enum { DoubleBufferSize = 32 };
+
+XLSX_AUTOTEST_EXPORT int formatDouble(double value, char *buffer);
+XLSX_AUTOTEST_EXPORT bool parseDouble(const char *first, const char *last, double *value);
+XLSX_AUTOTEST_EXPORT bool parseDouble(const QChar *first, const QChar *last, double *value);
+}
+
+#endif // QXLSX_XLSXNUMBERCONVERSION_P_H
@@ -0,0 +1,378 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxsheetdatareader_p.h"
+
+#include <limits.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isNameEnd(char c)
+{
+    return isSpace(c) || c == '/' || c == '>' || c == '=';
+}
+
+inline const char *find(const char *first, const char *last, char c)
+{
+    return static_cast<const char *>(memchr(first, c, size_t(last - first)));
+}
+
+void appendUtf8(QByteArray &out, uint c)
+{
+    if (c < 0x80) {
+        out.append(char(c));
+    } else if (c < 0x800) {
+        out.append(char(0xc0 | (c >> 6)));
+        out.append(char(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+        out.append(char(0xe0 | (c >> 12)));
+        out.append(char(0x80 | ((c >> 6) & 0x3f)));
+        out.append(char(0x80 | (c & 0x3f)));
+    } else {
+        out.append(char(0xf0 | (c >> 18)));
+        out.append(char(0x80 | ((c >> 12) & 0x3f)));
+        out.append(char(0x80 | ((c >> 6) & 0x3f)));
+        out.append(char(0x80 | (c & 0x3f)));
+    }
+}
+
+} // namespace
+
+SheetDataReader::SheetDataReader(const char *begin, const char *end)
+    : m_pos(begin)
+    , m_end(end)
+    , m_token(EndOfData)
+    , m_name(0)
+    , m_nameSize(0)
+    , m_emptyElement(false)
+    , m_attributeCount(0)
+{
+}
+
+/*
+ * Moves to the next start or end tag. An empty element <x/> gives a
+ * StartElement followed by an EndElement, as with QXmlStreamReader.
+ */
+SheetDataReader::TokenType SheetDataReader::readNext()
+{
+    if (m_token == Invalid)
+        return Invalid;
+    if (m_emptyElement) {
+        m_emptyElement = false;
+        return m_token = EndElement;
+    }
+
+    const char *p = find(m_pos, m_end, '<');
+    if (!p) {
+        m_pos = m_end;
+        return m_token = EndOfData;
+    }
+    if (p + 1 == m_end)
+        return fail();
+
+    if (p[1] == '/') {
+        const char *q = p + 2;
+        m_name = q;
+        while (q != m_end && !isNameEnd(*q))
+            ++q;
+        m_nameSize = int(q - m_name);
+        while (q != m_end && isSpace(*q))
+            ++q;
+        if (!m_nameSize || q == m_end || *q != '>')
+            return fail();
+        m_pos = q + 1;
+        return m_token = EndElement;
+    }
+
+    if (!parseStartTag(p + 1, false))
+        return fail();
+    return m_token = StartElement;
+}
+
+/*
+ * Reads the text of the current element up to its end tag, which becomes
+ * the current token. The range points into the data unless entities or
+ * carriage returns had to be replaced. Child elements are an error.
+ */
+bool SheetDataReader::readElementText(const char **first, const char **last)
+{
+    Q_ASSERT(m_token == StartElement);
+    if (m_emptyElement) {
+        m_emptyElement = false;
+        m_token = EndElement;
+        *first = *last = m_pos;
+        return true;
+    }
+
+    const char *text = m_pos;
+    const char *name = m_name;
+    const int nameSize = m_nameSize;
+    const char *p = find(text, m_end, '<');
+    if (!p || p + 1 == m_end || p[1] != '/' || readNext() != EndElement || m_nameSize != nameSize
+        || memcmp(m_name, name, size_t(nameSize)) != 0) {
+        fail();
+        return false;
+    }
+
+    if (!find(text, p, '&') && !find(text, p, '\r')) {
+        *first = text;
+        *last = p;
+        return true;
+    }
+    if (!decode(text, p)) {
+        fail();
+        return false;
+    }
+    *first = m_decoded.constData();
+    *last = m_decoded.constData() + m_decoded.size();
+    return true;
+}
+
+/*
+ * Skips the current element with everything in it. Unlike the elements
+ * that are read, skipped ones may use namespace prefixes, as in extLst.
+ */
+bool SheetDataReader::skipCurrentElement()
+{
+    Q_ASSERT(m_token == StartElement);
+    const char *name = m_name;
+    const int nameSize = m_nameSize;
+    int depth = m_emptyElement ? 0 : 1;
+    m_emptyElement = false;
+    while (depth) {
+        const char *p = find(m_pos, m_end, '<');
+        if (!p || p + 1 == m_end) {
+            fail();
+            return false;
+        }
+        if (p[1] == '/') {
+            const char *q = find(p, m_end, '>');
+            if (!q) {
+                fail();
+                return false;
+            }
+            m_pos = q + 1;
+            --depth;
+        } else {
+            if (!parseStartTag(p + 1, true)) {
+                fail();
+                return false;
+            }
+            if (!m_emptyElement)
+                ++depth;
+            m_emptyElement = false;
+        }
+    }
+    m_name = name;
+    m_nameSize = nameSize;
+    m_attributeCount = 0;
+    m_token = EndElement;
+    return true;
+}
+
+/*
+ * Digits with an optional minus sign, nothing else.
+ */
+bool SheetDataReader::parseInt(const char *first, const char *last, int *value)
+{
+    bool negative = false;
+    if (first != last && *first == '-') {
+        negative = true;
+        ++first;
+    }
+    if (first == last || last - first > 10)
+        return false;
+    qint64 result = 0;
+    for (; first != last; ++first) {
+        const uint digit = uint(uchar(*first)) - '0';
+        if (digit > 9)
+            return false;
+        result = result * 10 + digit;
+    }
+    if (negative)
+        result = -result;
+    if (result < INT_MIN || result > INT_MAX)
+        return false;
+    *value = int(result);
+    return true;
+}
+
+/*
+ * Parses the tag that starts at \a p, just behind the '<'. Attribute values
+ * are found with memchr() for their closing quote. Values with entities are
+ * only accepted in skipped elements, as none of the values that are read
+ * should need them.
+ */
+bool SheetDataReader::parseStartTag(const char *p, bool prefixesAllowed)
+{
+    if (*p == '!' || *p == '?')
+        return false; // comment, CDATA or processing instruction
+
+    const char *q = p;
+    while (q != m_end && !isNameEnd(*q)) {
+        if (*q == ':' && !prefixesAllowed)
+            return false;
+        ++q;
+    }
+    if (q == p)
+        return false;
+    m_name = p;
+    m_nameSize = int(q - p);
+    m_attributeCount = 0;
+    m_emptyElement = false;
+
+    for (;;) {
+        while (q != m_end && isSpace(*q))
+            ++q;
+        if (q == m_end)
+            return false;
+        if (*q == '>') {
+            m_pos = q + 1;
+            return true;
+        }
+        if (*q == '/') {
+            if (q + 1 == m_end || q[1] != '>')
+                return false;
+            m_emptyElement = true;
+            m_pos = q + 2;
+            return true;
+        }
+
+        const char *name = q;
+        while (q != m_end && !isNameEnd(*q))
+            ++q;
+        const int nameSize = int(q - name);
+        while (q != m_end && isSpace(*q))
+            ++q;
+        if (!nameSize || q == m_end || *q != '=')
+            return false;
+        ++q;
+        while (q != m_end && isSpace(*q))
+            ++q;
+        if (q == m_end || (*q != '"' && *q != '\''))
+            return false;
+        const char *value = q + 1;
+        q = find(value, m_end, *q);
+        if (!q)
+            return false;
+
+        if (!prefixesAllowed) {
+            if (m_attributeCount == MaxAttributes || find(value, q, '&'))
+                return false;
+            Attribute &attribute = m_attributes[m_attributeCount++];
+            attribute.name = name;
+            attribute.nameSize = nameSize;
+            attribute.value = value;
+            attribute.valueSize = int(q - value);
+        }
+        ++q;
+    }
+}
+
+bool SheetDataReader::findAttribute(const char *name, int size, const char **first,
+                                    const char **last) const
+{
+    for (int i = 0; i < m_attributeCount; ++i) {
+        const Attribute &attribute = m_attributes[i];
+        if (attribute.nameSize == size && memcmp(attribute.name, name, size_t(size)) == 0) {
+            *first = attribute.value;
+            *last = attribute.value + attribute.valueSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Replaces the predefined and numeric entities and normalizes line ends,
+ * as an XML parser has to.
+ */
+bool SheetDataReader::decode(const char *first, const char *last)
+{
+    m_decoded.clear();
+    m_decoded.reserve(int(last - first));
+    for (const char *p = first; p != last; ++p) {
+        if (*p == '\r') {
+            m_decoded.append('\n');
+            if (p + 1 != last && p[1] == '\n')
+                ++p;
+            continue;
+        }
+        if (*p != '&') {
+            m_decoded.append(*p);
+            continue;
+        }
+
+        const char *end = find(p, last, ';');
+        if (!end)
+            return false;
+        const char *entity = p + 1;
+        const int size = int(end - entity);
+        if (size == 2 && memcmp(entity, "lt", 2) == 0) {
+            m_decoded.append('<');
+        } else if (size == 2 && memcmp(entity, "gt", 2) == 0) {
+            m_decoded.append('>');
+        } else if (size == 3 && memcmp(entity, "amp", 3) == 0) {
+            m_decoded.append('&');
+        } else if (size == 4 && memcmp(entity, "quot", 4) == 0) {
+            m_decoded.append('"');
+        } else if (size == 4 && memcmp(entity, "apos", 4) == 0) {
+            m_decoded.append('\'');
+        } else if (size >= 2 && size <= 9 && *entity == '#') {
+            const bool hex = entity[1] == 'x';
+            uint c = 0;
+            const char *digit = entity + (hex ? 2 : 1);
+            if (digit == end)
+                return false;
+            for (; digit != end; ++digit) {
+                uint value;
+                if (*digit >= '0' && *digit <= '9')
+                    value = uint(*digit - '0');
+                else if (hex && *digit >= 'a' && *digit <= 'f')
+                    value = uint(*digit - 'a' + 10);
+                else if (hex && *digit >= 'A' && *digit <= 'F')
+                    value = uint(*digit - 'A' + 10);
+                else
+                    return false;
+                c = c * (hex ? 16 : 10) + value;
+            }
+            if (c == 0 || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff))
+                return false;
+            appendUtf8(m_decoded, c);
+        } else {
+            return false; // entities from a DTD
+        }
+        p = end;
+    }
+    return true;
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,114 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXSHEETDATAREADER_P_H
+#define QXLSX_XLSXSHEETDATAREADER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+#include <QByteArray>
+
+#include <string.h>
+
+namespace QXlsx {
+
+/*
+ * Pull tokenizer for the content of a <sheetData> element, working on the
+ * UTF-8 bytes in place. Tags are found with memchr(), names and attribute
+ * values are handed out as byte ranges without any conversion.
+ *
+ * It only knows the part of XML a sheetData element needs: elements,
+ * attributes, text and the predefined and numeric entities. Comments,
+ * CDATA sections, processing instructions and prefixed element names
+ * make it report Invalid, and the caller falls back to QXmlStreamReader.
+ * Text between tags is skipped by readNext().
+ */
+class XLSX_AUTOTEST_EXPORT SheetDataReader
+{
+public:
+    enum TokenType { StartElement, EndElement, EndOfData, Invalid };
+
+    SheetDataReader(const char *begin, const char *end);
+
+    TokenType readNext();
+    TokenType tokenType() const { return m_token; }
+
+    template <int N>
+    bool isName(const char (&name)[N]) const
+    {
+        return m_nameSize == N - 1 && memcmp(m_name, name, N - 1) == 0;
+    }
+
+    template <int N>
+    bool attribute(const char (&name)[N], const char **first, const char **last) const
+    {
+        return findAttribute(name, N - 1, first, last);
+    }
+
+    bool readElementText(const char **first, const char **last);
+    bool skipCurrentElement();
+
+    static bool parseInt(const char *first, const char *last, int *value);
+
+private:
+    Q_DISABLE_COPY(SheetDataReader)
+
+    struct Attribute
+    {
+        const char *name;
+        const char *value;
+        int nameSize;
+        int valueSize;
+    };
+    enum { MaxAttributes = 32 };
+
+    TokenType fail() { return m_token = Invalid; }
+    bool parseStartTag(const char *p, bool prefixesAllowed);
+    bool findAttribute(const char *name, int size, const char **first, const char **last) const;
+    bool decode(const char *first, const char *last);
+
+    const char *m_pos;
+    const char *m_end;
+    TokenType m_token;
+    const char *m_name;
+    int m_nameSize;
+    bool m_emptyElement;
+    Attribute m_attributes[MaxAttributes];
+    int m_attributeCount;
+    QByteArray m_decoded;
+};
+}
+
+#endif // QXLSX_XLSXSHEETDATAREADER_P_H
@@ -0,0 +1,283 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxsheetdatawriter_p.h"
+#include "xlsxnumberconversion_p.h"
+#include "xlsxcellreference_p.h"
+
+#include <QIODevice>
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+namespace {
+
+const int BufferSize = 256 * 1024;
+
+// Enough room for any tag or attribute name used in sheetData, an attribute
+// with a number or a cell reference, and the '>' of a pending start tag.
+const int ChunkSize = 128;
+
+const char DigitPairs[] = "00010203040506070809"
+                          "10111213141516171819"
+                          "20212223242526272829"
+                          "30313233343536373839"
+                          "40414243444546474849"
+                          "50515253545556575859"
+                          "60616263646566676869"
+                          "70717273747576777879"
+                          "80818283848586878889"
+                          "90919293949596979899";
+
+// Writes the decimal digits of value in front of end, returns the first one.
+char *formatUnsigned(quint64 value, char *end)
+{
+    while (value >= 100) {
+        const int pair = int(value % 100) * 2;
+        value /= 100;
+        *--end = DigitPairs[pair + 1];
+        *--end = DigitPairs[pair];
+    }
+    if (value >= 10) {
+        const int pair = int(value) * 2;
+        *--end = DigitPairs[pair + 1];
+        *--end = DigitPairs[pair];
+    } else {
+        *--end = char('0' + value);
+    }
+    return end;
+}
+
+} // namespace
+
+SheetDataWriter::SheetDataWriter(QIODevice *device)
+    : m_device(device)
+    , m_buffer(BufferSize, Qt::Uninitialized)
+    , m_pos(m_buffer.data())
+    , m_end(m_buffer.data() + m_buffer.size())
+    , m_inStartElement(false)
+    , m_started(false)
+    , m_error(false)
+{
+}
+
+SheetDataWriter::~SheetDataWriter()
+{
+    flush();
+}
+
+/*
+ * The <sheetData> start tag goes out in front of the first row, so that a
+ * sheet without rows gets an empty element, as QXmlStreamWriter would write.
+ */
+void SheetDataWriter::writeStartElement(QLatin1String name)
+{
+    reserve(ChunkSize);
+    finishStartElement();
+    if (!m_started) {
+        m_started = true;
+        append("<sheetData>", 11);
+    }
+    *m_pos++ = '<';
+    append(name.data(), name.size());
+    m_inStartElement = true;
+}
+
+void SheetDataWriter::writeEndElement(QLatin1String name)
+{
+    reserve(ChunkSize);
+    if (m_inStartElement) {
+        append("/>", 2);
+        m_inStartElement = false;
+        return;
+    }
+    append("</", 2);
+    append(name.data(), name.size());
+    *m_pos++ = '>';
+}
+
+void SheetDataWriter::writeAttribute(QLatin1String name, QLatin1String value)
+{
+    reserve(ChunkSize);
+    *m_pos++ = ' ';
+    append(name.data(), name.size());
+    append("=\"", 2);
+    append(value.data(), value.size());
+    *m_pos++ = '"';
+}
+
+void SheetDataWriter::writeAttribute(QLatin1String name, const QString &value)
+{
+    reserve(ChunkSize);
+    *m_pos++ = ' ';
+    append(name.data(), name.size());
+    append("=\"", 2);
+    appendEscaped(value);
+    reserve(1);
+    *m_pos++ = '"';
+}
+
+void SheetDataWriter::writeAttribute(QLatin1String name, int value)
+{
+    reserve(ChunkSize);
+    *m_pos++ = ' ';
+    append(name.data(), name.size());
+    append("=\"", 2);
+    appendInteger(value);
+    *m_pos++ = '"';
+}
+
+/*
+ * Writes r="A1", the column letters are worked out in place instead of
+ * going through CellReference and a QString.
+ */
+void SheetDataWriter::writeCellReferenceAttribute(int row, int col)
+{
+    reserve(ChunkSize);
+    append(" r=\"", 4);
+    m_pos += formatCellReference(row, col, m_pos);
+    *m_pos++ = '"';
+}
+
+void SheetDataWriter::writeCharacters(const QString &text)
+{
+    reserve(ChunkSize);
+    finishStartElement();
+    appendEscaped(text);
+}
+
+void SheetDataWriter::writeNumber(int value)
+{
+    reserve(ChunkSize);
+    finishStartElement();
+    appendInteger(value);
+}
+
+void SheetDataWriter::writeNumber(double value)
+{
+    reserve(ChunkSize);
+    finishStartElement();
+    m_pos += formatDouble(value, m_pos);
+}
+
+/*
+ * Closes the sheetData element and hands everything to the device.
+ */
+void SheetDataWriter::finish()
+{
+    reserve(ChunkSize);
+    finishStartElement();
+    if (m_started)
+        append("</sheetData>", 12);
+    else
+        append("<sheetData/>", 12);
+    m_started = false;
+    flush();
+}
+
+bool SheetDataWriter::flush()
+{
+    const qint64 size = m_pos - m_buffer.constData();
+    if (size > 0 && m_device->write(m_buffer.constData(), size) != size)
+        m_error = true;
+    m_pos = m_buffer.data();
+    return !m_error;
+}
+
+/*
+ * Only for pieces that fit in ChunkSize and have been reserved before.
+ */
+void SheetDataWriter::append(const char *data, int size)
+{
+    memcpy(m_pos, data, size);
+    m_pos += size;
+}
+
+/*
+ * UTF-16 to UTF-8 with the same escaping as QXmlStreamWriter. A lone
+ * surrogate becomes U+FFFD.
+ */
+void SheetDataWriter::appendEscaped(const QString &text)
+{
+    const ushort *p = text.utf16();
+    const ushort *end = p + text.size();
+    while (p != end) {
+        reserve(6);
+        uint c = *p++;
+        if (c < 0x80) {
+            switch (c) {
+            case '<':
+                append("&lt;", 4);
+                break;
+            case '>':
+                append("&gt;", 4);
+                break;
+            case '&':
+                append("&amp;", 5);
+                break;
+            case '"':
+                append("&quot;", 6);
+                break;
+            default:
+                *m_pos++ = char(c);
+                break;
+            }
+        } else if (c < 0x800) {
+            *m_pos++ = char(0xc0 | (c >> 6));
+            *m_pos++ = char(0x80 | (c & 0x3f));
+        } else {
+            if (QChar::isSurrogate(c)) {
+                if (QChar::isHighSurrogate(c) && p != end && QChar::isLowSurrogate(*p)) {
+                    c = QChar::surrogateToUcs4(ushort(c), *p++);
+                    *m_pos++ = char(0xf0 | (c >> 18));
+                    *m_pos++ = char(0x80 | ((c >> 12) & 0x3f));
+                    *m_pos++ = char(0x80 | ((c >> 6) & 0x3f));
+                    *m_pos++ = char(0x80 | (c & 0x3f));
+                    continue;
+                }
+                c = QChar::ReplacementCharacter;
+            }
+            *m_pos++ = char(0xe0 | (c >> 12));
+            *m_pos++ = char(0x80 | ((c >> 6) & 0x3f));
+            *m_pos++ = char(0x80 | (c & 0x3f));
+        }
+    }
+}
+
+void SheetDataWriter::appendInteger(qint64 value)
+{
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *first;
+    if (value < 0) {
+        first = formatUnsigned(0 - quint64(value), end);
+        *--first = '-';
+    } else {
+        first = formatUnsigned(quint64(value), end);
+    }
+    append(first, int(end - first));
+}
+
+QT_END_NAMESPACE_XLSX
@@ -0,0 +1,108 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXSHEETDATAWRITER_P_H
+#define QXLSX_XLSXSHEETDATAWRITER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxglobal.h"
+
+#include <QByteArray>
+#include <QLatin1String>
+#include <QString>
+
+class QIODevice;
+
+namespace QXlsx {
+
+/*
+ * Writes the <sheetData> element of a worksheet as UTF-8 straight into an
+ * output buffer, which is handed to the device whenever it fills up.
+ *
+ * The markup is made of fixed tag and attribute names, cell references and
+ * numbers, none of which need escaping or encoding, so only string payloads
+ * go through the escaping path. The output is the same as QXmlStreamWriter
+ * would produce for the same calls. Element names are passed again on
+ * writeEndElement(), so no element stack is kept.
+ */
+class XLSX_AUTOTEST_EXPORT SheetDataWriter
+{
+public:
+    explicit SheetDataWriter(QIODevice *device);
+    ~SheetDataWriter();
+
+    void writeStartElement(QLatin1String name);
+    void writeEndElement(QLatin1String name);
+    void writeAttribute(QLatin1String name, QLatin1String value);
+    void writeAttribute(QLatin1String name, const QString &value);
+    void writeAttribute(QLatin1String name, int value);
+    void writeCellReferenceAttribute(int row, int col);
+    void writeCharacters(const QString &text);
+    void writeNumber(int value);
+    void writeNumber(double value);
+
+    void finish();
+    bool flush();
+    bool hasError() const { return m_error; }
+
+private:
+    Q_DISABLE_COPY(SheetDataWriter)
+
+    void finishStartElement()
+    {
+        if (m_inStartElement) {
+            *m_pos++ = '>';
+            m_inStartElement = false;
+        }
+    }
+    void reserve(int size)
+    {
+        if (m_end - m_pos < size)
+            flush();
+    }
+    void append(const char *data, int size);
+    void appendEscaped(const QString &text);
+    void appendInteger(qint64 value);
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    char *m_pos;
+    char *m_end;
+    bool m_inStartElement;
+    bool m_started;
+    bool m_error;
+};
+}
+
+#endif // QXLSX_XLSXSHEETDATAWRITER_P_H
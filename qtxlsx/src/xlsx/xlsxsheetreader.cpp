@@ -0,0 +1,415 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include "xlsxsheetreader.h"
+#include "xlsxsheetreader_p.h"
+#include "xlsxworkbook_p.h"
+#include "xlsxrelationships_p.h"
+#include "xlsxsharedstrings_p.h"
+#include "xlsxstyles_p.h"
+#include "xlsxutility_p.h"
+#include "xlsxnumberconversion_p.h"
+#include "xlsxcellreference_p.h"
+#include "xlsxworksheet_p.h"
+
+#include <QDateTime>
+#include <QXmlStreamReader>
+#include <math.h>
+
+QT_BEGIN_NAMESPACE_XLSX
+
+SheetReaderPrivate::SheetReaderPrivate(SheetReader *p)
+    : q_ptr(p)
+    , row(0)
+    , error(false)
+{
+}
+
+SheetReaderPrivate::~SheetReaderPrivate()
+{
+}
+
+/*
+  Loads everything but the sheet data: the sheet names and paths, the
+  styles and the shared strings.
+ */
+bool SheetReaderPrivate::loadWorkbook()
+{
+    if (!zipReader->filePaths().contains(QLatin1String("_rels/.rels")))
+        return false;
+    Relationships rootRels;
+    rootRels.loadFromXmlData(zipReader->fileData(QStringLiteral("_rels/.rels")));
+
+    QList<XlsxRelationship> rels_xl =
+        rootRels.documentRelationships(QStringLiteral("/officeDocument"));
+    if (rels_xl.isEmpty())
+        return false;
+    QString xlworkbook_Path = rels_xl[0].target;
+    QString xlworkbook_Dir = splitPath(xlworkbook_Path)[0];
+    workbook = QSharedPointer<Workbook>(new Workbook(Workbook::F_LoadFromExists));
+    workbook->relationships()->loadFromXmlData(zipReader->fileData(getRelFilePath(xlworkbook_Path)));
+    workbook->setFilePath(xlworkbook_Path);
+    if (!workbook->loadFromXmlData(zipReader->fileData(xlworkbook_Path)))
+        return false;
+
+    QList<XlsxRelationship> rels_styles =
+        workbook->relationships()->documentRelationships(QStringLiteral("/styles"));
+    if (!rels_styles.isEmpty()) {
+        QString path = xlworkbook_Dir + QLatin1String("/") + rels_styles[0].target;
+        QSharedPointer<Styles> styles(new Styles(Styles::F_LoadFromExists));
+        styles->loadFromXmlData(zipReader->fileData(path));
+        workbook->d_func()->styles = styles;
+    }
+
+    QList<XlsxRelationship> rels_sharedStrings =
+        workbook->relationships()->documentRelationships(QStringLiteral("/sharedStrings"));
+    if (!rels_sharedStrings.isEmpty()) {
+        QString path = xlworkbook_Dir + QLatin1String("/") + rels_sharedStrings[0].target;
+        workbook->sharedStrings()->loadFromXmlData(zipReader->fileData(path));
+    }
+
+    for (int i = 0; i < workbook->sheetCount(); ++i) {
+        AbstractSheet *sheet = workbook->sheet(i);
+        if (sheet->sheetType() != AbstractSheet::ST_WorkSheet)
+            continue;
+        sheetNames.append(sheet->sheetName());
+        sheetPaths.append(sheet->filePath());
+    }
+    return true;
+}
+
+/*
+  Reads the children of a <c> element up to its end.
+ */
+QVariant SheetReaderPrivate::readCell(Cell::CellType cellType, int styleIndex)
+{
+    QString text;
+    bool hasValue = false;
+    while (reader->readNextStartElement()) {
+        if (reader->name() == QLatin1String("v")) {
+            text = reader->readElementText();
+            hasValue = true;
+        } else if (reader->name() == QLatin1String("is")) {
+            text = readInlineString();
+            hasValue = true;
+        } else {
+            // The cached value is returned for formulas
+            reader->skipCurrentElement();
+        }
+    }
+    if (!hasValue)
+        return QVariant();
+
+    switch (cellType) {
+    case Cell::SharedStringType:
+        return workbook->sharedStrings()->getSharedString(text.toInt()).toPlainString();
+    case Cell::BooleanType:
+        return text.toInt() ? true : false;
+    case Cell::InlineStringType:
+    case Cell::StringType:
+    case Cell::ErrorType:
+        return text;
+    default:
+        break;
+    }
+
+    double value;
+    parseDouble(text.constData(), text.constData() + text.size(), &value);
+    if (styleIndex >= 0 && value >= 0 && isDateTimeStyle(styleIndex)) {
+        // Same conversion as Worksheet::read()
+        QDateTime dt = datetimeFromNumber(value, workbook->isDate1904());
+        if (value < 1)
+            return dt.time();
+        if (fmod(value, 1.0) < 1.0 / (1000 * 60 * 60 * 24)) // integer
+            return dt.date();
+        return dt;
+    }
+    return value;
+}
+
+/*
+  Reads the plain text of an <is> element, the runs of rich text are joined.
+ */
+QString SheetReaderPrivate::readInlineString()
+{
+    QString text;
+    while (reader->readNextStartElement()) {
+        if (reader->name() == QLatin1String("t")) {
+            text += reader->readElementText();
+        } else if (reader->name() == QLatin1String("r")) {
+            while (reader->readNextStartElement()) {
+                if (reader->name() == QLatin1String("t"))
+                    text += reader->readElementText();
+                else
+                    reader->skipCurrentElement();
+            }
+        } else {
+            reader->skipCurrentElement();
+        }
+    }
+    return text;
+}
+
+bool SheetReaderPrivate::isDateTimeStyle(int styleIndex)
+{
+    QHash<int, bool>::const_iterator it = dateTimeStyles.constFind(styleIndex);
+    if (it != dateTimeStyles.constEnd())
+        return it.value();
+
+    const Format format = workbook->styles()->xfFormat(styleIndex);
+    const bool isDateTime = format.isValid() && format.isDateTimeFormat();
+    dateTimeStyles.insert(styleIndex, isDateTime);
+    return isDateTime;
+}
+
+/*!
+  \class SheetReader
+  \inmodule QtXlsx
+  \brief Reads the rows of a worksheet one at a time without loading the sheet.
+
+  Document builds a Cell for every value of every sheet before it can be used.
+  SheetReader instead inflates and parses the selected worksheet while it is
+  read, and keeps only the current row, so memory use does not depend on the
+  size of the sheet. The shared strings and styles of the workbook are loaded
+  up front, as cells refer to them.
+
+  \code
+  SheetReader reader("report.xlsx");
+  while (reader.readNextRow())
+      qDebug() << reader.row() << reader.read(1);
+  \endcode
+*/
+
+/*!
+  Opens the xlsx document named \a xlsxName and selects its first worksheet.
+ */
+SheetReader::SheetReader(const QString &xlsxName)
+    : d_ptr(new SheetReaderPrivate(this))
+{
+    Q_D(SheetReader);
+    d->zipReader.reset(new ZipReader(xlsxName));
+    if (d->zipReader->exists() && d->loadWorkbook() && !d->sheetNames.isEmpty())
+        selectSheet(d->sheetNames.first());
+}
+
+/*!
+  \overload
+  Reads the xlsx document from \a device, which must stay open and must not
+  be used by others while rows are read. It has to be a random access device.
+ */
+SheetReader::SheetReader(QIODevice *device)
+    : d_ptr(new SheetReaderPrivate(this))
+{
+    Q_D(SheetReader);
+    d->zipReader.reset(new ZipReader(device));
+    if (d->zipReader->exists() && d->loadWorkbook() && !d->sheetNames.isEmpty())
+        selectSheet(d->sheetNames.first());
+}
+
+/*!
+  Destroys the reader.
+ */
+SheetReader::~SheetReader()
+{
+    delete d_ptr;
+}
+
+/*!
+  Returns whether the document could be opened and has a worksheet.
+ */
+bool SheetReader::isValid() const
+{
+    Q_D(const SheetReader);
+    return !d->sheetNames.isEmpty();
+}
+
+/*!
+  Returns the names of the worksheets of the document.
+ */
+QStringList SheetReader::sheetNames() const
+{
+    Q_D(const SheetReader);
+    return d->sheetNames;
+}
+
+/*!
+  Starts reading the worksheet \a name from its first row.
+  Returns false if there is no such worksheet.
+ */
+bool SheetReader::selectSheet(const QString &name)
+{
+    Q_D(SheetReader);
+    d->reader.reset();
+    d->sheetDevice.reset();
+    d->values.clear();
+    d->row = 0;
+    d->error = false;
+    d->currentSheet.clear();
+
+    const int index = d->sheetNames.indexOf(name);
+    if (index < 0)
+        return false;
+    d->sheetDevice.reset(d->zipReader->openFile(d->sheetPaths[index]));
+    if (!d->sheetDevice) {
+        d->error = true;
+        return false;
+    }
+    d->reader.reset(new QXmlStreamReader(d->sheetDevice.data()));
+    d->currentSheet = name;
+    return true;
+}
+
+/*!
+  Returns the name of the worksheet being read.
+ */
+QString SheetReader::currentSheetName() const
+{
+    Q_D(const SheetReader);
+    return d->currentSheet;
+}
+
+/*!
+  Reads the next row that has cells or formatting.
+  Returns false at the end of the sheet or if an error occurred.
+
+  \sa hasError()
+ */
+bool SheetReader::readNextRow()
+{
+    Q_D(SheetReader);
+    d->values.clear();
+    if (!d->reader)
+        return false;
+
+    QXmlStreamReader &reader = *d->reader;
+    bool found = false;
+    while (!found && !reader.atEnd()) {
+        reader.readNext();
+        if (reader.isStartElement() && reader.name() == QLatin1String("row"))
+            found = true;
+        else if (reader.isEndElement() && reader.name() == QLatin1String("sheetData"))
+            break;
+    }
+    if (!found) {
+        d->error = reader.hasError();
+        d->reader.reset();
+        d->sheetDevice.reset();
+        return false;
+    }
+
+    // "r" is optional, rows and cells without it follow the previous one
+    const QXmlStreamAttributes rowAttributes = reader.attributes();
+    const QStringRef rowRef = rowAttributes.value(QLatin1String("r"));
+    d->row = rowRef.isEmpty() ? d->row + 1 : rowRef.toString().toInt();
+
+    int column = 0;
+    while (reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("c")) {
+            reader.skipCurrentElement();
+            continue;
+        }
+
+        QXmlStreamAttributes attributes = reader.attributes();
+        const QStringRef cellRef = attributes.value(QLatin1String("r"));
+        int cellRow;
+        if (cellRef.isEmpty())
+            ++column;
+        else if (!parseCellReference(cellRef.constData(), cellRef.constData() + cellRef.size(),
+                                     &cellRow, &column))
+            column = -1;
+        const int styleIndex = attributes.hasAttribute(QLatin1String("s"))
+            ? attributes.value(QLatin1String("s")).toString().toInt()
+            : -1;
+
+        Cell::CellType cellType = Cell::NumberType;
+        const QStringRef typeString = attributes.value(QLatin1String("t"));
+        if (typeString == QLatin1String("s"))
+            cellType = Cell::SharedStringType;
+        else if (typeString == QLatin1String("inlineStr"))
+            cellType = Cell::InlineStringType;
+        else if (typeString == QLatin1String("str"))
+            cellType = Cell::StringType;
+        else if (typeString == QLatin1String("b"))
+            cellType = Cell::BooleanType;
+        else if (typeString == QLatin1String("e"))
+            cellType = Cell::ErrorType;
+
+        const QVariant value = d->readCell(cellType, styleIndex);
+        if (column < 1 || column > XLSX_COLUMN_MAX || !value.isValid())
+            continue;
+        if (d->values.size() < column)
+            d->values.resize(column);
+        d->values[column - 1] = value;
+    }
+
+    if (reader.hasError()) {
+        d->error = true;
+        d->values.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Returns the number of the current row, starting from 1.
+ */
+int SheetReader::row() const
+{
+    Q_D(const SheetReader);
+    return d->row;
+}
+
+/*!
+  Returns the last column of the current row that has a value.
+ */
+int SheetReader::columnCount() const
+{
+    Q_D(const SheetReader);
+    return d->values.size();
+}
+
+/*!
+  Returns the value in \a column of the current row, columns start from 1.
+  Shared strings are resolved and numbers with a date or time format are
+  returned as QDateTime, QDate or QTime as Worksheet::read() does. For
+  formulas the value cached in the file is returned, not the formula.
+ */
+QVariant SheetReader::read(int column) const
+{
+    Q_D(const SheetReader);
+    if (column < 1 || column > d->values.size())
+        return QVariant();
+    return d->values.at(column - 1);
+}
+
+/*!
+  Returns whether reading the document or the sheet failed.
+ */
+bool SheetReader::hasError() const
+{
+    Q_D(const SheetReader);
+    return d->error;
+}
+
+QT_END_NAMESPACE_XLSX
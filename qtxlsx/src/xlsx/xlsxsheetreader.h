@@ -0,0 +1,63 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef QXLSX_XLSXSHEETREADER_H
+#define QXLSX_XLSXSHEETREADER_H
+
+#include "xlsxglobal.h"
+#include <QStringList>
+#include <QVariant>
+
+class QIODevice;
+
+QT_BEGIN_NAMESPACE_XLSX
+
+class SheetReaderPrivate;
+class Q_XLSX_EXPORT SheetReader
+{
+    Q_DECLARE_PRIVATE(SheetReader)
+public:
+    explicit SheetReader(const QString &xlsxName);
+    explicit SheetReader(QIODevice *device);
+    ~SheetReader();
+
+    bool isValid() const;
+    QStringList sheetNames() const;
+    bool selectSheet(const QString &name);
+    QString currentSheetName() const;
+
+    bool readNextRow();
+    int row() const;
+    int columnCount() const;
+    QVariant read(int column) const;
+    bool hasError() const;
+
+private:
+    Q_DISABLE_COPY(SheetReader)
+    SheetReaderPrivate *const d_ptr;
+};
+
+QT_END_NAMESPACE_XLSX
+
+#endif // QXLSX_XLSXSHEETREADER_H
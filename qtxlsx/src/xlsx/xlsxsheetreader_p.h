@@ -0,0 +1,81 @@
+/****************************************************************************
+** Copyright (c) 2013-2014 Debao Zhang <hello@debao.me>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef XLSXSHEETREADER_P_H
+#define XLSXSHEETREADER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt Xlsx API.  It exists for the convenience
+// of the Qt Xlsx.  This header file may change from
+// version to version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "xlsxsheetreader.h"
+#include "xlsxworkbook.h"
+#include "xlsxcell.h"
+#include "xlsxzipreader_p.h"
+
+#include <QHash>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QVector>
+
+class QXmlStreamReader;
+
+namespace QXlsx {
+
+class SheetReaderPrivate
+{
+    Q_DECLARE_PUBLIC(SheetReader)
+public:
+    SheetReaderPrivate(SheetReader *p);
+    ~SheetReaderPrivate();
+
+    bool loadWorkbook();
+    QVariant readCell(Cell::CellType cellType, int styleIndex);
+    QString readInlineString();
+    bool isDateTimeStyle(int styleIndex);
+
+    SheetReader *q_ptr;
+    QScopedPointer<ZipReader> zipReader;
+    QSharedPointer<Workbook> workbook;
+    QStringList sheetNames;
+    QStringList sheetPaths;
+    QString currentSheet;
+
+    QScopedPointer<QIODevice> sheetDevice;
+    QScopedPointer<QXmlStreamReader> reader;
+    QHash<int, bool> dateTimeStyles;
+    QVector<QVariant> values;
+    int row;
+    bool error;
+};
+}
+
+#endif // XLSXSHEETREADER_P_H
@@ -24,6 +24,7 @@
 ****************************************************************************/
 #include "xlsxrichstring.h"
 #include "xlsxcellreference.h"
+#include "xlsxcellreference_p.h"
 #include "xlsxworksheet.h"
 #include "xlsxworksheet_p.h"
 #include "xlsxworkbook.h"
@@ -41,6 +42,10 @@
 #include "xlsxchart.h"
 #include "xlsxcellformula.h"
 #include "xlsxcellformula_p.h"
+#include "xlsxzipwriter_p.h"
+#include "xlsxsheetdatawriter_p.h"
+#include "xlsxnumberconversion_p.h"
+#include "xlsxsheetdatareader_p.h"
 
 #include <QVariant>
 #include <QDateTime>
@@ -53,9 +58,11 @@
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
 #include <QTextDocument>
+#include <QAbstractItemModel>
 #include <QDir>
 
 #include <math.h>
+#include <string.h>
 
 QT_BEGIN_NAMESPACE_XLSX
 
@@ -72,6 +79,8 @@ WorksheetPrivate::WorksheetPrivate(Worksheet *p, Worksheet::CreateFlag flag)
     , showOutlineSymbols(true)
     , showWhiteSpace(true)
     , urlPattern(QStringLiteral("^([fh]tt?ps?://)|(mailto:)|(file://)"))
+    , streaming(false)
+    , streamedRow(0)
 {
     previous_row = 0;
 
@@ -90,56 +99,30 @@ WorksheetPrivate::~WorksheetPrivate()
   Calculate the "spans" attribute of the <row> tag. This is an
   XLSX optimisation and isn't strictly required. However, it
   makes comparing files easier. The span is the same for each
-  block of 16 rows.
+  block of 16 rows, block 0 being rows 1 to 16.
  */
-void WorksheetPrivate::calculateSpans() const
+QString WorksheetPrivate::calculateSpan(int block) const
 {
-    row_spans.clear();
     int span_min = XLSX_COLUMN_MAX + 1;
     int span_max = -1;
 
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
-        }
-        if (comments.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (comments[row_num].contains(col_num)) {
-                    if (span_max == -1) {
-                        span_min = col_num;
-                        span_max = col_num;
-                    } else {
-                        if (col_num < span_min)
-                            span_min = col_num;
-                        else if (col_num > span_max)
-                            span_max = col_num;
-                    }
-                }
-            }
+    for (int row_num = block * 16 + 1; row_num <= block * 16 + 16; row_num++) {
+        if (cellTable.containsRow(row_num)) {
+            span_min = qMin(span_min, cellTable.firstColumn(row_num));
+            span_max = qMax(span_max, cellTable.lastColumn(row_num));
         }
-
-        if (row_num % 16 == 0 || row_num == dimension.lastRow()) {
-            if (span_max != -1) {
-                row_spans[row_num / 16] = QStringLiteral("%1:%2").arg(span_min).arg(span_max);
-                span_min = XLSX_COLUMN_MAX + 1;
-                span_max = -1;
+        if (!comments.isEmpty()) {
+            QMap<int, QMap<int, QString>>::const_iterator it = comments.constFind(row_num);
+            if (it != comments.constEnd() && !it->isEmpty()) {
+                span_min = qMin(span_min, it->firstKey());
+                span_max = qMax(span_max, it->lastKey());
             }
         }
     }
+
+    if (span_max == -1)
+        return QString();
+    return QStringLiteral("%1:%2").arg(span_min).arg(span_max);
 }
 
 QString WorksheetPrivate::generateDimensionString() const
@@ -165,6 +148,14 @@ int WorksheetPrivate::checkDimensions(int row, int col, bool ignore_row, bool ig
     if (row > XLSX_ROW_MAX || row < 1 || col > XLSX_COLUMN_MAX || col < 1)
         return -1;
 
+    if (streaming && !ignore_row) {
+        // Rows already streamed out can not be changed
+        if (row <= streamedRow)
+            return -1;
+        if (!ignore_col && !streamRowsBefore(row))
+            return -1;
+    }
+
     if (!ignore_row) {
         if (row < dimension.firstRow() || dimension.firstRow() == -1)
             dimension.setFirstRow(row);
@@ -211,24 +202,19 @@ Worksheet *Worksheet::copy(const QString &distName, int distId) const
 
     sheet_d->dimension = d->dimension;
 
-    QMapIterator<int, QMap<int, QSharedPointer<Cell>>> it(d->cellTable);
-    while (it.hasNext()) {
-        it.next();
-        int row = it.key();
-        QMapIterator<int, QSharedPointer<Cell>> it2(it.value());
-        while (it2.hasNext()) {
-            it2.next();
-            int col = it2.key();
+    d->cellTable.forEachCell([=](int row, int col, const CellData &source) {
+        CellData cell = source;
+        cell.style = sheet_d->cellTable.addFormat(d->cellTable.format(source.style));
 
-            QSharedPointer<Cell> cell(new Cell(it2.value().data()));
-            cell->d_ptr->parent = sheet;
+        if (cell.type == Cell::SharedStringType && !(cell.flags & CellData::Blank))
+            d->workbook->sharedStrings()->incRefByStringIndex(cell.index);
 
-            if (cell->cellType() == Cell::SharedStringType)
-                d->workbook->sharedStrings()->addSharedString(cell->d_ptr->richString);
-
-            sheet_d->cellTable[row][col] = cell;
-        }
-    }
+        sheet_d->cellTable.setCell(row, col, cell);
+        if (source.flags & CellData::HasFormula)
+            sheet_d->cellTable.setFormula(row, col, d->cellTable.formula(row, col));
+        if (source.flags & CellData::HasText)
+            sheet_d->cellTable.setText(row, col, d->cellTable.text(row, col));
+    });
 
     sheet_d->merges = d->merges;
     //    sheet_d->rowsInfo = d->rowsInfo;
@@ -525,18 +511,19 @@ QVariant Worksheet::read(int row, int column) const
 {
     Q_D(const Worksheet);
 
-    Cell *cell = cellAt(row, column);
+    const CellData *cell = d->cellTable.cell(row, column);
     if (!cell)
         return QVariant();
 
-    if (cell->hasFormula()) {
-        if (cell->formula().formulaType() == CellFormula::NormalType) {
-            return QVariant(QLatin1String("=") + cell->formula().formulaText());
-        } else if (cell->formula().formulaType() == CellFormula::SharedType) {
-            if (!cell->formula().formulaText().isEmpty()) {
-                return QVariant(QLatin1String("=") + cell->formula().formulaText());
+    if (cell->flags & CellData::HasFormula) {
+        const CellFormula formula = d->cellTable.formula(row, column);
+        if (formula.formulaType() == CellFormula::NormalType) {
+            return QVariant(QLatin1String("=") + formula.formulaText());
+        } else if (formula.formulaType() == CellFormula::SharedType) {
+            if (!formula.formulaText().isEmpty()) {
+                return QVariant(QLatin1String("=") + formula.formulaText());
             } else {
-                const CellFormula &rootFormula = d->sharedFormulaMap[cell->formula().sharedIndex()];
+                const CellFormula &rootFormula = d->sharedFormulaMap[formula.sharedIndex()];
                 CellReference rootCellRef = rootFormula.reference().topLeft();
                 QString rootFormulaText = rootFormula.formulaText();
                 QString newFormulaText =
@@ -546,17 +533,20 @@ QVariant Worksheet::read(int row, int column) const
         }
     }
 
-    if (cell->isDateTime()) {
-        double val = cell->value().toDouble();
-        QDateTime dt = cell->dateTime();
-        if (val < 1)
-            return dt.time();
-        if (fmod(val, 1.0) < 1.0 / (1000 * 60 * 60 * 24)) // integer
-            return dt.date();
-        return dt;
+    // Same test as Cell::isDateTime(), a blank cell counts as 0
+    if (cell->type == Cell::NumberType && d->cellTable.isDateTimeFormat(cell->style)) {
+        const double val = cell->flags & CellData::Blank ? 0 : cell->number;
+        if (val >= 0) {
+            QDateTime dt = datetimeFromNumber(val, d->workbook->isDate1904());
+            if (val < 1)
+                return dt.time();
+            if (fmod(val, 1.0) < 1.0 / (1000 * 60 * 60 * 24)) // integer
+                return dt.date();
+            return dt;
+        }
     }
 
-    return cell->value();
+    return d->cellValue(row, column, *cell);
 }
 
 /*!
@@ -578,21 +568,50 @@ Cell *Worksheet::cellAt(const CellReference &row_column) const
 Cell *Worksheet::cellAt(int row, int column) const
 {
     Q_D(const Worksheet);
-    if (!d->cellTable.contains(row))
-        return 0;
-    if (!d->cellTable[row].contains(column))
+    if (Cell *cell = d->cellTable.cachedCell(row, column))
+        return cell;
+
+    const CellData *data = d->cellTable.cell(row, column);
+    if (!data)
         return 0;
 
-    return d->cellTable[row][column].data();
+    Cell *cell = new Cell(d->cellValue(row, column, *data), data->cellType(),
+                          d->cellTable.format(data->style), const_cast<Worksheet *>(this));
+    if (data->flags & CellData::HasFormula)
+        cell->d_ptr->formula = d->cellTable.formula(row, column);
+    if (data->type == Cell::SharedStringType && !(data->flags & CellData::Blank))
+        cell->d_ptr->richString = d->sharedStrings()->getSharedString(data->index);
+    else if (data->flags & CellData::HasText)
+        cell->d_ptr->richString = d->cellTable.text(row, column);
+    d->cellTable.setCachedCell(row, column, cell);
+    return cell;
 }
 
 Format WorksheetPrivate::cellFormat(int row, int col) const
 {
-    if (!cellTable.contains(row))
-        return Format();
-    if (!cellTable[row].contains(col))
-        return Format();
-    return cellTable[row][col]->format();
+    if (const CellData *cell = cellTable.cell(row, col))
+        return cellTable.format(cell->style);
+    return Format();
+}
+
+/*
+  Returns the value a Cell object reports for \a cell.
+ */
+QVariant WorksheetPrivate::cellValue(int row, int col, const CellData &cell) const
+{
+    if (cell.flags & CellData::Blank)
+        return QVariant();
+
+    switch (cell.type) {
+    case Cell::NumberType:
+        return cell.number;
+    case Cell::BooleanType:
+        return cell.index != 0;
+    case Cell::SharedStringType:
+        return sharedStrings()->getSharedString(cell.index).toPlainString();
+    default:
+        return cellTable.text(row, col).toPlainString();
+    }
 }
 
 /*!
@@ -626,15 +645,14 @@ bool Worksheet::writeString(int row, int column, const RichString &value, const
     //        error = -2;
     //    }
 
-    d->sharedStrings()->addSharedString(value);
+    CellData cell(Cell::SharedStringType, 0);
+    cell.index = d->sharedStrings()->addSharedString(value);
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     if (value.fragmentCount() == 1 && value.fragmentFormat(0).isValid())
         fmt.mergeFormat(value.fragmentFormat(0));
     d->workbook->styles()->addXfFormat(fmt);
-    QSharedPointer<Cell> cell =
-        QSharedPointer<Cell>(new Cell(value.toPlainString(), Cell::SharedStringType, fmt, this));
-    cell->d_ptr->richString = value;
-    d->cellTable[row][column] = cell;
+    cell.style = d->cellTable.addFormat(fmt);
+    d->cellTable.setCell(row, column, cell);
     return true;
 }
 
@@ -704,8 +722,9 @@ bool Worksheet::writeInlineString(int row, int column, const QString &value, con
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(value, Cell::InlineStringType, fmt, this));
+    d->cellTable.setCell(row, column,
+                         CellData(Cell::InlineStringType, d->cellTable.addFormat(fmt)));
+    d->cellTable.setText(row, column, RichString(value));
     return true;
 }
 
@@ -734,7 +753,9 @@ bool Worksheet::writeNumeric(int row, int column, double value, const Format &fo
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    CellData cell(Cell::NumberType, d->cellTable.addFormat(fmt));
+    cell.number = value;
+    d->cellTable.setCell(row, column, cell);
     return true;
 }
 
@@ -777,9 +798,10 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
         d->sharedFormulaMap[si] = formula;
     }
 
-    QSharedPointer<Cell> data = QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
-    data->d_ptr->formula = formula;
-    d->cellTable[row][column] = data;
+    CellData data(Cell::NumberType, d->cellTable.addFormat(fmt));
+    data.number = result;
+    d->cellTable.setCell(row, column, data);
+    d->cellTable.setFormula(row, column, formula);
 
     CellRange range = formula.reference();
     if (formula.formulaType() == CellFormula::SharedType) {
@@ -788,14 +810,11 @@ bool Worksheet::writeFormula(int row, int column, const CellFormula &formula_, c
         for (int r = range.firstRow(); r <= range.lastRow(); ++r) {
             for (int c = range.firstColumn(); c <= range.lastColumn(); ++c) {
                 if (!(r == row && c == column)) {
-                    if (Cell *cell = cellAt(r, c)) {
+                    if (!d->cellTable.cell(r, c))
+                        d->cellTable.setCell(r, c, data);
+                    d->cellTable.setFormula(r, c, sf);
+                    if (Cell *cell = d->cellTable.cachedCell(r, c))
                         cell->d_ptr->formula = sf;
-                    } else {
-                        QSharedPointer<Cell> newCell =
-                            QSharedPointer<Cell>(new Cell(result, Cell::NumberType, fmt, this));
-                        newCell->d_ptr->formula = sf;
-                        d->cellTable[r][c] = newCell;
-                    }
                 }
             }
         }
@@ -831,9 +850,10 @@ bool Worksheet::writeBlank(int row, int column, const Format &format)
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
 
-    // Note: NumberType with an invalid QVariant value means blank.
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(QVariant(), Cell::NumberType, fmt, this));
+    // Note: NumberType without a value means blank.
+    CellData cell(Cell::NumberType, d->cellTable.addFormat(fmt));
+    cell.flags = CellData::Blank;
+    d->cellTable.setCell(row, column, cell);
 
     return true;
 }
@@ -862,7 +882,9 @@ bool Worksheet::writeBool(int row, int column, bool value, const Format &format)
 
     Format fmt = format.isValid() ? format : d->cellFormat(row, column);
     d->workbook->styles()->addXfFormat(fmt);
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::BooleanType, fmt, this));
+    CellData cell(Cell::BooleanType, d->cellTable.addFormat(fmt));
+    cell.index = value ? 1 : 0;
+    d->cellTable.setCell(row, column, cell);
 
     return true;
 }
@@ -897,7 +919,9 @@ bool Worksheet::writeDateTime(int row, int column, const QDateTime &dt, const Fo
 
     double value = datetimeToNumber(dt, d->workbook->isDate1904());
 
-    d->cellTable[row][column] = QSharedPointer<Cell>(new Cell(value, Cell::NumberType, fmt, this));
+    CellData cell(Cell::NumberType, d->cellTable.addFormat(fmt));
+    cell.number = value;
+    d->cellTable.setCell(row, column, cell);
 
     return true;
 }
@@ -930,8 +954,9 @@ bool Worksheet::writeTime(int row, int column, const QTime &t, const Format &for
         fmt.setNumberFormat(QStringLiteral("hh:mm:ss"));
     d->workbook->styles()->addXfFormat(fmt);
 
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(timeToNumber(t), Cell::NumberType, fmt, this));
+    CellData cell(Cell::NumberType, d->cellTable.addFormat(fmt));
+    cell.number = timeToNumber(t);
+    d->cellTable.setCell(row, column, cell);
 
     return true;
 }
@@ -997,9 +1022,9 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
     d->workbook->styles()->addXfFormat(fmt);
 
     // Write the hyperlink string as normal string.
-    d->sharedStrings()->addSharedString(displayString);
-    d->cellTable[row][column] =
-        QSharedPointer<Cell>(new Cell(displayString, Cell::SharedStringType, fmt, this));
+    CellData cell(Cell::SharedStringType, d->cellTable.addFormat(fmt));
+    cell.index = d->sharedStrings()->addSharedString(displayString);
+    d->cellTable.setCell(row, column, cell);
 
     // Store the hyperlink data in a separate table
     d->urlTable[row][column] = QSharedPointer<XlsxHyperlinkData>(new XlsxHyperlinkData(
@@ -1008,6 +1033,139 @@ bool Worksheet::writeHyperlink(int row, int column, const QUrl &url, const Forma
     return true;
 }
 
+/*!
+    \enum Worksheet::ModelValueType
+
+    How writeModel() converts the values of a model column.
+
+    \value ModelAutoValue The value type decides, as write() does.
+    \value ModelStringValue Written as shared string.
+    \value ModelNumericValue Written as number.
+    \value ModelDateTimeValue Written as date time number, with the workbook's default
+            date format if the column format has no date time format.
+    \value ModelBoolValue Written as boolean.
+ */
+
+/*!
+    \class Worksheet::ModelColumn
+
+    One column of writeModel(): the \c modelColumn to read, the \c role of its data,
+    the \c type the value is converted to and the \c format of its cells.
+ */
+
+/*!
+    Write the rows \a firstModelRow to \a lastModelRow of \a model to the block of cells
+    starting at (\a row, \a column), one sheet column for every entry of \a columns.
+    If \a columns is empty, every model column is written with ModelAutoValue.
+    A \a lastModelRow of -1 means the last row of the model. Null values leave the cell empty.
+
+    Unlike writing the cells one at a time, each column format is registered once and
+    typed columns skip the QVariant type dispatch of write().
+
+    Returns false if the block does not fit into the sheet.
+ */
+bool Worksheet::writeModel(int row, int column, const QAbstractItemModel *model,
+                           const QList<ModelColumn> &columns, int firstModelRow, int lastModelRow)
+{
+    Q_D(Worksheet);
+    if (!model || row < 1 || column < 1)
+        return false;
+
+    QList<ModelColumn> specs = columns;
+    if (specs.isEmpty()) {
+        for (int i = 0; i < model->columnCount(); ++i)
+            specs.append(ModelColumn(i));
+    }
+    if (lastModelRow < 0 || lastModelRow >= model->rowCount())
+        lastModelRow = model->rowCount() - 1;
+    firstModelRow = qMax(0, firstModelRow);
+    if (specs.isEmpty() || firstModelRow > lastModelRow)
+        return true;
+
+    const int lastRow = row + lastModelRow - firstModelRow;
+    const int lastColumn = column + specs.size() - 1;
+    if (lastRow > XLSX_ROW_MAX || lastColumn > XLSX_COLUMN_MAX)
+        return false;
+    if (d->streaming && row <= d->streamedRow)
+        return false;
+
+    // Formats are registered once per column instead of once per cell
+    QVector<int> styles(specs.size());
+    for (int i = 0; i < specs.size(); ++i) {
+        ModelColumn &spec = specs[i];
+        if (spec.type == ModelDateTimeValue
+            && (!spec.format.isValid() || !spec.format.isDateTimeFormat()))
+            spec.format.setNumberFormat(d->workbook->defaultDateFormat());
+        if (spec.type != ModelAutoValue) {
+            d->workbook->styles()->addXfFormat(spec.format);
+            styles[i] = d->cellTable.addFormat(spec.format);
+        }
+    }
+
+    SharedStrings *sst = d->sharedStrings();
+    const bool is1904 = d->workbook->isDate1904();
+    int firstWrittenRow = -1;
+    int lastWrittenRow = -1;
+    int firstWrittenColumn = lastColumn + 1;
+    int lastWrittenColumn = column - 1;
+    for (int modelRow = firstModelRow; modelRow <= lastModelRow; ++modelRow) {
+        const int sheetRow = row + modelRow - firstModelRow;
+        bool rowWritten = false;
+        for (int i = 0; i < specs.size(); ++i) {
+            const ModelColumn &spec = specs.at(i);
+            const QVariant value = model->data(model->index(modelRow, spec.modelColumn), spec.role);
+            if (value.isNull())
+                continue;
+
+            const int sheetColumn = column + i;
+            CellData cell(Cell::NumberType, styles.at(i));
+            switch (spec.type) {
+            case ModelStringValue:
+                cell.type = Cell::SharedStringType;
+                cell.index = sst->addSharedString(value.toString());
+                d->cellTable.setCell(sheetRow, sheetColumn, cell);
+                break;
+            case ModelNumericValue:
+                cell.number = value.toDouble();
+                d->cellTable.setCell(sheetRow, sheetColumn, cell);
+                break;
+            case ModelDateTimeValue:
+                cell.number = datetimeToNumber(value.toDateTime(), is1904);
+                d->cellTable.setCell(sheetRow, sheetColumn, cell);
+                break;
+            case ModelBoolValue:
+                cell.type = Cell::BooleanType;
+                cell.index = value.toBool() ? 1 : 0;
+                d->cellTable.setCell(sheetRow, sheetColumn, cell);
+                break;
+            default:
+                if (!write(sheetRow, sheetColumn, value, spec.format))
+                    continue;
+                break;
+            }
+            rowWritten = true;
+            firstWrittenColumn = qMin(firstWrittenColumn, sheetColumn);
+            lastWrittenColumn = qMax(lastWrittenColumn, sheetColumn);
+        }
+        if (rowWritten) {
+            if (firstWrittenRow < 0)
+                firstWrittenRow = sheetRow;
+            lastWrittenRow = sheetRow;
+            // In streaming mode this also writes out the rows before
+            if (d->streaming
+                && (d->checkDimensions(sheetRow, firstWrittenColumn)
+                    || d->checkDimensions(sheetRow, lastWrittenColumn)))
+                return false;
+        }
+    }
+
+    if (firstWrittenRow > 0) {
+        d->checkDimensions(firstWrittenRow, firstWrittenColumn);
+        d->checkDimensions(lastWrittenRow, lastWrittenColumn);
+    }
+    return true;
+}
+
 /*!
  * Add one DataValidation \a validation to the sheet.
  * Returns true on success.
@@ -1122,10 +1280,12 @@ bool Worksheet::mergeCells(const CellRange &range, const Format &format)
     for (int row = range.firstRow(); row <= range.lastRow(); ++row) {
         for (int col = range.firstColumn(); col <= range.lastColumn(); ++col) {
             if (row == range.firstRow() && col == range.firstColumn()) {
-                Cell *cell = cellAt(row, col);
-                if (cell) {
-                    if (format.isValid())
-                        cell->d_ptr->format = format;
+                if (d->cellTable.cell(row, col)) {
+                    if (format.isValid()) {
+                        d->cellTable.setFormat(row, col, format);
+                        if (Cell *cell = d->cellTable.cachedCell(row, col))
+                            cell->d_ptr->format = format;
+                    }
                 } else {
                     writeBlank(row, col, format);
                 }
@@ -1168,10 +1328,28 @@ QList<CellRange> Worksheet::mergedCells() const
 void Worksheet::saveToXmlFile(QIODevice *device) const
 {
     Q_D(const Worksheet);
+    if (d->stream) {
+        qWarning("Streamed worksheets can only be saved as part of their document");
+        return;
+    }
     d->relationships->clear();
 
     QXmlStreamWriter writer(device);
 
+    d->saveXmlSheetHead(writer);
+    // The head ends with a closed element, so sheetData can be appended to the device directly
+    SheetDataWriter sheetData(device);
+    if (d->dimension.isValid())
+        d->saveXmlSheetData(sheetData);
+    sheetData.finish();
+    d->saveXmlSheetTail(writer);
+}
+
+/*
+  Everything in front of <sheetData>.
+ */
+void WorksheetPrivate::saveXmlSheetHead(QXmlStreamWriter &writer) const
+{
     writer.writeStartDocument(QStringLiteral("1.0"), true);
     writer.writeStartElement(QStringLiteral("worksheet"));
     writer.writeAttribute(
@@ -1188,56 +1366,58 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
     //    "http://schemas.microsoft.com/office/spreadsheetml/2009/9/ac");
     //    writer.writeAttribute("mc:Ignorable", "x14ac");
 
-    writer.writeStartElement(QStringLiteral("dimension"));
-    writer.writeAttribute(QStringLiteral("ref"), d->generateDimensionString());
-    writer.writeEndElement(); // dimension
+    // The dimension of a streamed sheet is not known before its end
+    if (!stream) {
+        writer.writeStartElement(QStringLiteral("dimension"));
+        writer.writeAttribute(QStringLiteral("ref"), generateDimensionString());
+        writer.writeEndElement(); // dimension
+    }
 
     writer.writeStartElement(QStringLiteral("sheetViews"));
     writer.writeStartElement(QStringLiteral("sheetView"));
-    if (d->windowProtection)
+    if (windowProtection)
         writer.writeAttribute(QStringLiteral("windowProtection"), QStringLiteral("1"));
-    if (d->showFormulas)
+    if (showFormulas)
         writer.writeAttribute(QStringLiteral("showFormulas"), QStringLiteral("1"));
-    if (!d->showGridLines)
+    if (!showGridLines)
         writer.writeAttribute(QStringLiteral("showGridLines"), QStringLiteral("0"));
-    if (!d->showRowColHeaders)
+    if (!showRowColHeaders)
         writer.writeAttribute(QStringLiteral("showRowColHeaders"), QStringLiteral("0"));
-    if (!d->showZeros)
+    if (!showZeros)
         writer.writeAttribute(QStringLiteral("showZeros"), QStringLiteral("0"));
-    if (d->rightToLeft)
+    if (rightToLeft)
         writer.writeAttribute(QStringLiteral("rightToLeft"), QStringLiteral("1"));
-    if (d->tabSelected)
+    if (tabSelected)
         writer.writeAttribute(QStringLiteral("tabSelected"), QStringLiteral("1"));
-    if (!d->showRuler)
+    if (!showRuler)
         writer.writeAttribute(QStringLiteral("showRuler"), QStringLiteral("0"));
-    if (!d->showOutlineSymbols)
+    if (!showOutlineSymbols)
         writer.writeAttribute(QStringLiteral("showOutlineSymbols"), QStringLiteral("0"));
-    if (!d->showWhiteSpace)
+    if (!showWhiteSpace)
         writer.writeAttribute(QStringLiteral("showWhiteSpace"), QStringLiteral("0"));
     writer.writeAttribute(QStringLiteral("workbookViewId"), QStringLiteral("0"));
     writer.writeEndElement(); // sheetView
     writer.writeEndElement(); // sheetViews
 
     writer.writeStartElement(QStringLiteral("sheetFormatPr"));
-    writer.writeAttribute(QStringLiteral("defaultRowHeight"),
-                          QString::number(d->default_row_height));
-    if (d->default_row_height != 15)
+    writer.writeAttribute(QStringLiteral("defaultRowHeight"), QString::number(default_row_height));
+    if (default_row_height != 15)
         writer.writeAttribute(QStringLiteral("customHeight"), QStringLiteral("1"));
-    if (d->default_row_zeroed)
+    if (default_row_zeroed)
         writer.writeAttribute(QStringLiteral("zeroHeight"), QStringLiteral("1"));
-    if (d->outline_row_level)
+    if (outline_row_level)
         writer.writeAttribute(QStringLiteral("outlineLevelRow"),
-                              QString::number(d->outline_row_level));
-    if (d->outline_col_level)
+                              QString::number(outline_row_level));
+    if (outline_col_level)
         writer.writeAttribute(QStringLiteral("outlineLevelCol"),
-                              QString::number(d->outline_col_level));
+                              QString::number(outline_col_level));
     // for Excel 2010
     //    writer.writeAttribute("x14ac:dyDescent", "0.25");
     writer.writeEndElement(); // sheetFormatPr
 
-    if (!d->colsInfo.isEmpty()) {
+    if (!colsInfo.isEmpty()) {
         writer.writeStartElement(QStringLiteral("cols"));
-        QMapIterator<int, QSharedPointer<XlsxColumnInfo>> it(d->colsInfo);
+        QMapIterator<int, QSharedPointer<XlsxColumnInfo>> it(colsInfo);
         while (it.hasNext()) {
             it.next();
             QSharedPointer<XlsxColumnInfo> col_info = it.value();
@@ -1263,157 +1443,263 @@ void Worksheet::saveToXmlFile(QIODevice *device) const
         }
         writer.writeEndElement(); // cols
     }
+}
 
-    writer.writeStartElement(QStringLiteral("sheetData"));
-    if (d->dimension.isValid())
-        d->saveXmlSheetData(writer);
-    writer.writeEndElement(); // sheetData
-
-    d->saveXmlMergeCells(writer);
-    foreach (const ConditionalFormatting cf, d->conditionalFormattingList)
+/*
+  Everything after </sheetData>.
+ */
+void WorksheetPrivate::saveXmlSheetTail(QXmlStreamWriter &writer) const
+{
+    saveXmlMergeCells(writer);
+    foreach (const ConditionalFormatting cf, conditionalFormattingList)
         cf.saveToXml(writer);
-    d->saveXmlDataValidations(writer);
-    d->saveXmlHyperlinks(writer);
-    d->saveXmlDrawings(writer);
+    saveXmlDataValidations(writer);
+    saveXmlHyperlinks(writer);
+    saveXmlDrawings(writer);
 
     writer.writeEndElement(); // worksheet
     writer.writeEndDocument();
 }
 
-void WorksheetPrivate::saveXmlSheetData(QXmlStreamWriter &writer) const
-{
-    calculateSpans();
-    for (int row_num = dimension.firstRow(); row_num <= dimension.lastRow(); row_num++) {
-        if (!(cellTable.contains(row_num) || comments.contains(row_num)
-              || rowsInfo.contains(row_num))) {
-            // Only process rows with cell data / comments / formatting
-            continue;
+/*
+  Only rows with cell data / comments / formatting are visited, taken in
+  order from the three tables, so the cost does not depend on the width
+  or the height of the dimension. The span of a block of rows is worked
+  out when its first row is written.
+ */
+void WorksheetPrivate::saveXmlSheetData(SheetDataWriter &writer) const
+{
+    int cellRow = cellTable.firstRow();
+    QMap<int, QMap<int, QString>>::const_iterator comment = comments.constBegin();
+    QMap<int, QSharedPointer<XlsxRowInfo>>::const_iterator info = rowsInfo.constBegin();
+
+    int spanBlock = -1;
+    QString span;
+    for (;;) {
+        int row_num = XLSX_ROW_MAX + 1;
+        if (cellRow != -1)
+            row_num = cellRow;
+        if (comment != comments.constEnd())
+            row_num = qMin(row_num, comment.key());
+        if (info != rowsInfo.constEnd())
+            row_num = qMin(row_num, info.key());
+        if (row_num > XLSX_ROW_MAX)
+            break;
+
+        if (row_num >= dimension.firstRow() && row_num <= dimension.lastRow()) {
+            if ((row_num - 1) / 16 != spanBlock) {
+                spanBlock = (row_num - 1) / 16;
+                span = calculateSpan(spanBlock);
+            }
+            saveXmlRow(writer, row_num, span);
         }
 
-        int span_index = (row_num - 1) / 16;
-        QString span;
-        if (row_spans.contains(span_index))
-            span = row_spans[span_index];
-
-        writer.writeStartElement(QStringLiteral("row"));
-        writer.writeAttribute(QStringLiteral("r"), QString::number(row_num));
+        if (cellRow == row_num)
+            cellRow = cellTable.nextRow(cellRow);
+        if (comment != comments.constEnd() && comment.key() == row_num)
+            ++comment;
+        if (info != rowsInfo.constEnd() && info.key() == row_num)
+            ++info;
+    }
+}
 
-        if (!span.isEmpty())
-            writer.writeAttribute(QStringLiteral("spans"), span);
+void WorksheetPrivate::saveXmlRow(SheetDataWriter &writer, int row_num, const QString &span) const
+{
+    writer.writeStartElement(QLatin1String("row"));
+    writer.writeAttribute(QLatin1String("r"), row_num);
 
-        if (rowsInfo.contains(row_num)) {
-            QSharedPointer<XlsxRowInfo> rowInfo = rowsInfo[row_num];
-            if (!rowInfo->format.isEmpty()) {
-                writer.writeAttribute(QStringLiteral("s"),
-                                      QString::number(rowInfo->format.xfIndex()));
-                writer.writeAttribute(QStringLiteral("customFormat"), QStringLiteral("1"));
-            }
-            //! Todo: support customHeight from info struct
-            //! Todo: where does this magic number '15' come from?
-            if (rowInfo->customHeight) {
-                writer.writeAttribute(QStringLiteral("ht"), QString::number(rowInfo->height));
-                writer.writeAttribute(QStringLiteral("customHeight"), QStringLiteral("1"));
-            } else {
-                writer.writeAttribute(QStringLiteral("customHeight"), QStringLiteral("0"));
-            }
+    if (!span.isEmpty())
+        writer.writeAttribute(QLatin1String("spans"), span);
 
-            if (rowInfo->hidden)
-                writer.writeAttribute(QStringLiteral("hidden"), QStringLiteral("1"));
-            if (rowInfo->outlineLevel > 0)
-                writer.writeAttribute(QStringLiteral("outlineLevel"),
-                                      QString::number(rowInfo->outlineLevel));
-            if (rowInfo->collapsed)
-                writer.writeAttribute(QStringLiteral("collapsed"), QStringLiteral("1"));
+    QMap<int, QSharedPointer<XlsxRowInfo>>::const_iterator info = rowsInfo.constFind(row_num);
+    if (info != rowsInfo.constEnd()) {
+        const QSharedPointer<XlsxRowInfo> &rowInfo = info.value();
+        if (!rowInfo->format.isEmpty()) {
+            writer.writeAttribute(QLatin1String("s"), rowInfo->format.xfIndex());
+            writer.writeAttribute(QLatin1String("customFormat"), QLatin1String("1"));
+        }
+        //! Todo: support customHeight from info struct
+        //! Todo: where does this magic number '15' come from?
+        if (rowInfo->customHeight) {
+            writer.writeAttribute(QLatin1String("ht"), QString::number(rowInfo->height));
+            writer.writeAttribute(QLatin1String("customHeight"), QLatin1String("1"));
+        } else {
+            writer.writeAttribute(QLatin1String("customHeight"), QLatin1String("0"));
         }
 
-        // Write cell data if row contains filled cells
-        if (cellTable.contains(row_num)) {
-            for (int col_num = dimension.firstColumn(); col_num <= dimension.lastColumn();
-                 col_num++) {
-                if (cellTable[row_num].contains(col_num)) {
-                    saveXmlCellData(writer, row_num, col_num, cellTable[row_num][col_num]);
-                }
-            }
+        if (rowInfo->hidden)
+            writer.writeAttribute(QLatin1String("hidden"), QLatin1String("1"));
+        if (rowInfo->outlineLevel > 0)
+            writer.writeAttribute(QLatin1String("outlineLevel"), int(rowInfo->outlineLevel));
+        if (rowInfo->collapsed)
+            writer.writeAttribute(QLatin1String("collapsed"), QLatin1String("1"));
+    }
+
+    // Write cell data if row contains filled cells
+    cellTable.forEachCellInRow(row_num, [&](int col_num, const CellData &cell) {
+        saveXmlCellData(writer, row_num, col_num, cell);
+    });
+    writer.writeEndElement(QLatin1String("row"));
+}
+
+/*
+  Writes the rows in front of \a row to the stream and drops them. The sheet
+  head is written together with the first row, so the columns are fixed from then on.
+ */
+bool WorksheetPrivate::streamRowsBefore(int row)
+{
+    for (;;) {
+        int next = row;
+        if (!cellTable.isEmpty())
+            next = qMin(next, cellTable.firstRow());
+        if (!rowsInfo.isEmpty())
+            next = qMin(next, rowsInfo.firstKey());
+        if (next >= row)
+            break;
+
+        if (!stream) {
+            QScopedPointer<DeflateStream> deflater(new DeflateStream);
+            if (!deflater->open())
+                return false;
+            stream.swap(deflater);
+            streamWriter.reset(new QXmlStreamWriter(stream.data()));
+            saveXmlSheetHead(*streamWriter);
+            streamSheetData.reset(new SheetDataWriter(stream.data()));
         }
-        writer.writeEndElement(); // row
+        // The rest of the block is not known yet, so streamed rows go without spans
+        saveXmlRow(*streamSheetData, next, QString());
+        cellTable.removeRow(next);
+        rowsInfo.remove(next);
     }
+    streamedRow = qMax(streamedRow, row - 1);
+    return !streamWriter || !(streamWriter->hasError() || streamSheetData->hasError());
 }
 
-void WorksheetPrivate::saveXmlCellData(QXmlStreamWriter &writer, int row, int col,
-                                       QSharedPointer<Cell> cell) const
+/*
+  Writes out the remaining rows and the end of the sheet, no more rows
+  can be written afterwards.
+ */
+bool WorksheetPrivate::finishStream()
 {
-    // This is the innermost loop so efficiency is important.
-    QString cell_pos = CellReference(row, col).toString();
+    if (stream->isFinished())
+        return true;
 
-    writer.writeStartElement(QStringLiteral("c"));
-    writer.writeAttribute(QStringLiteral("r"), cell_pos);
+    if (!streamRowsBefore(XLSX_ROW_MAX + 1))
+        return false;
+    relationships->clear();
+    streamSheetData->finish();
+    saveXmlSheetTail(*streamWriter);
+    const bool ok = !(streamWriter->hasError() || streamSheetData->hasError());
+    streamSheetData.reset();
+    streamWriter.reset();
+    return stream->finish() && ok;
+}
+
+void WorksheetPrivate::saveXmlCellData(SheetDataWriter &writer, int row, int col,
+                                       const CellData &cell) const
+{
+    // This is the innermost loop so efficiency is important.
+    writer.writeStartElement(QLatin1String("c"));
+    writer.writeCellReferenceAttribute(row, col);
 
     // Style used by the cell, row or col
-    if (!cell->format().isEmpty())
-        writer.writeAttribute(QStringLiteral("s"), QString::number(cell->format().xfIndex()));
-    else if (rowsInfo.contains(row) && !rowsInfo[row]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"),
-                              QString::number(rowsInfo[row]->format.xfIndex()));
-    else if (colsInfoHelper.contains(col) && !colsInfoHelper[col]->format.isEmpty())
-        writer.writeAttribute(QStringLiteral("s"),
-                              QString::number(colsInfoHelper[col]->format.xfIndex()));
-
-    if (cell->cellType() == Cell::SharedStringType) {
-        int sst_idx;
-        if (cell->isRichString())
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->d_ptr->richString);
-        else
-            sst_idx = sharedStrings()->getSharedStringIndex(cell->value().toString());
-
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("s"));
-        writer.writeTextElement(QStringLiteral("v"), QString::number(sst_idx));
-    } else if (cell->cellType() == Cell::InlineStringType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("inlineStr"));
-        writer.writeStartElement(QStringLiteral("is"));
-        if (cell->isRichString()) {
+    const Format *format = &cellTable.format(cell.style);
+    if (format->isEmpty() && !rowsInfo.isEmpty()) {
+        QMap<int, QSharedPointer<XlsxRowInfo>>::const_iterator it = rowsInfo.constFind(row);
+        if (it != rowsInfo.constEnd())
+            format = &it.value()->format;
+    }
+    if (format->isEmpty() && !colsInfoHelper.isEmpty()) {
+        QMap<int, QSharedPointer<XlsxColumnInfo>>::const_iterator it =
+            colsInfoHelper.constFind(col);
+        if (it != colsInfoHelper.constEnd())
+            format = &it.value()->format;
+    }
+    if (!format->isEmpty())
+        writer.writeAttribute(QLatin1String("s"), format->xfIndex());
+
+    if (cell.type == Cell::SharedStringType) {
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("s"));
+        if (!(cell.flags & CellData::Blank)) {
+            writer.writeStartElement(QLatin1String("v"));
+            writer.writeNumber(cell.index);
+            writer.writeEndElement(QLatin1String("v"));
+        }
+    } else if (cell.type == Cell::InlineStringType) {
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("inlineStr"));
+        writer.writeStartElement(QLatin1String("is"));
+        const RichString string = cellTable.text(row, col);
+        if (string.isRichString()) {
             // Rich text string
-            RichString string = cell->d_ptr->richString;
             for (int i = 0; i < string.fragmentCount(); ++i) {
-                writer.writeStartElement(QStringLiteral("r"));
+                writer.writeStartElement(QLatin1String("r"));
                 if (string.fragmentFormat(i).hasFontData()) {
-                    writer.writeStartElement(QStringLiteral("rPr"));
+                    writer.writeStartElement(QLatin1String("rPr"));
                     //:Todo
-                    writer.writeEndElement(); // rPr
+                    writer.writeEndElement(QLatin1String("rPr"));
                 }
-                writer.writeStartElement(QStringLiteral("t"));
+                writer.writeStartElement(QLatin1String("t"));
                 if (isSpaceReserveNeeded(string.fragmentText(i)))
-                    writer.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
+                    writer.writeAttribute(QLatin1String("xml:space"), QLatin1String("preserve"));
                 writer.writeCharacters(string.fragmentText(i));
-                writer.writeEndElement(); // t
-                writer.writeEndElement(); // r
+                writer.writeEndElement(QLatin1String("t"));
+                writer.writeEndElement(QLatin1String("r"));
             }
         } else {
-            writer.writeStartElement(QStringLiteral("t"));
-            QString string = cell->value().toString();
-            if (isSpaceReserveNeeded(string))
-                writer.writeAttribute(QStringLiteral("xml:space"), QStringLiteral("preserve"));
-            writer.writeCharacters(string);
-            writer.writeEndElement(); // t
+            writer.writeStartElement(QLatin1String("t"));
+            const QString text = string.toPlainString();
+            if (isSpaceReserveNeeded(text))
+                writer.writeAttribute(QLatin1String("xml:space"), QLatin1String("preserve"));
+            writer.writeCharacters(text);
+            writer.writeEndElement(QLatin1String("t"));
         }
-        writer.writeEndElement(); // is
-    } else if (cell->cellType() == Cell::NumberType) {
-        if (cell->hasFormula())
-            cell->formula().saveToXml(writer);
-        if (cell->value().isValid()) { // note that, invalid value means 'v' is blank
-            double value = cell->value().toDouble();
-            writer.writeTextElement(QStringLiteral("v"), QString::number(value, 'g', 15));
+        writer.writeEndElement(QLatin1String("is"));
+    } else if (cell.type == Cell::NumberType) {
+        if (cell.flags & CellData::HasFormula)
+            saveXmlCellFormula(writer, cellTable.formula(row, col));
+        if (!(cell.flags & CellData::Blank)) { // note that, a blank cell has no 'v'
+            writer.writeStartElement(QLatin1String("v"));
+            writer.writeNumber(cell.number);
+            writer.writeEndElement(QLatin1String("v"));
         }
-    } else if (cell->cellType() == Cell::StringType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("str"));
-        if (cell->hasFormula())
-            cell->formula().saveToXml(writer);
-        writer.writeTextElement(QStringLiteral("v"), cell->value().toString());
-    } else if (cell->cellType() == Cell::BooleanType) {
-        writer.writeAttribute(QStringLiteral("t"), QStringLiteral("b"));
-        writer.writeTextElement(QStringLiteral("v"),
-                                cell->value().toBool() ? QStringLiteral("1") : QStringLiteral("0"));
+    } else if (cell.type == Cell::StringType) {
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("str"));
+        if (cell.flags & CellData::HasFormula)
+            saveXmlCellFormula(writer, cellTable.formula(row, col));
+        writer.writeStartElement(QLatin1String("v"));
+        writer.writeCharacters(cellTable.text(row, col).toPlainString());
+        writer.writeEndElement(QLatin1String("v"));
+    } else if (cell.type == Cell::BooleanType) {
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("b"));
+        writer.writeStartElement(QLatin1String("v"));
+        writer.writeNumber(cell.index ? 1 : 0);
+        writer.writeEndElement(QLatin1String("v"));
     }
-    writer.writeEndElement(); // c
+    writer.writeEndElement(QLatin1String("c"));
+}
+
+/*
+  The same markup as CellFormula::saveToXml(), for the sheetData writer.
+ */
+void WorksheetPrivate::saveXmlCellFormula(SheetDataWriter &writer,
+                                          const CellFormula &formula) const
+{
+    writer.writeStartElement(QLatin1String("f"));
+    if (formula.d->type == CellFormula::ArrayType)
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("array"));
+    else if (formula.d->type == CellFormula::SharedType)
+        writer.writeAttribute(QLatin1String("t"), QLatin1String("shared"));
+    if (formula.d->reference.isValid())
+        writer.writeAttribute(QLatin1String("ref"), formula.d->reference.toString());
+    if (formula.d->ca)
+        writer.writeAttribute(QLatin1String("ca"), QLatin1String("1"));
+    if (formula.d->type == CellFormula::SharedType)
+        writer.writeAttribute(QLatin1String("si"), formula.d->si);
+
+    if (!formula.d->formula.isEmpty())
+        writer.writeCharacters(formula.d->formula);
+
+    writer.writeEndElement(QLatin1String("f"));
 }
 
 void WorksheetPrivate::saveXmlMergeCells(QXmlStreamWriter &writer) const
@@ -1621,6 +1907,9 @@ bool Worksheet::setColumnHidden(const CellRange &range, bool hidden)
 bool Worksheet::setColumnWidth(int colFirst, int colLast, double width)
 {
     Q_D(Worksheet);
+    // The columns are written out together with the first streamed row
+    if (d->stream)
+        return false;
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1637,6 +1926,9 @@ bool Worksheet::setColumnWidth(int colFirst, int colLast, double width)
 bool Worksheet::setColumnFormat(int colFirst, int colLast, const Format &format)
 {
     Q_D(Worksheet);
+    // The columns are written out together with the first streamed row
+    if (d->stream)
+        return false;
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1657,6 +1949,9 @@ bool Worksheet::setColumnFormat(int colFirst, int colLast, const Format &format)
 bool Worksheet::setColumnHidden(int colFirst, int colLast, bool hidden)
 {
     Q_D(Worksheet);
+    // The columns are written out together with the first streamed row
+    if (d->stream)
+        return false;
 
     QList<QSharedPointer<XlsxColumnInfo>> columnInfoList = d->getColumnInfoList(colFirst, colLast);
     foreach (QSharedPointer<XlsxColumnInfo> columnInfo, columnInfoList)
@@ -1852,6 +2147,9 @@ bool Worksheet::groupColumns(const CellRange &range, bool collapsed)
 bool Worksheet::groupColumns(int colFirst, int colLast, bool collapsed)
 {
     Q_D(Worksheet);
+    // The columns are written out together with the first streamed row
+    if (d->stream)
+        return false;
 
     d->splitColsInfo(colFirst, colLast);
 
@@ -1911,6 +2209,45 @@ CellRange Worksheet::dimension() const
     return d->dimension;
 }
 
+/*!
+    Enables the streaming mode of the worksheet if \a enable is true.
+
+    In streaming mode the rows have to be written in ascending order. A row is
+    written out to a compressed temporary file and dropped from memory as soon as a
+    cell of a later row is written, so the memory used does not grow with the number
+    of rows. Shared strings and formats are still collected for the whole document.
+
+    Rows that have been written out can neither be read nor changed any more, and
+    the columns can only be set up before the second row is started. Merged cells,
+    hyperlinks, data validations and conditional formatting work as usual.
+
+    Returns false if the mode can not be changed, as some rows have already been
+    written out.
+
+    \sa isStreamingEnabled()
+ */
+bool Worksheet::setStreamingEnabled(bool enable)
+{
+    Q_D(Worksheet);
+    if (d->stream)
+        return enable;
+
+    d->streaming = enable;
+    d->streamedRow = 0;
+    return true;
+}
+
+/*!
+    Returns whether the streaming mode of the worksheet is enabled.
+
+    \sa setStreamingEnabled()
+ */
+bool Worksheet::isStreamingEnabled() const
+{
+    Q_D(const Worksheet);
+    return d->streaming;
+}
+
 /*
  Convert the height of a cell from user's units to pixels. If the
  height hasn't been set by the user we use the default value. If
@@ -1952,7 +2289,6 @@ int WorksheetPrivate::colPixelsSize(int col) const
 
 void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
 {
-    Q_Q(Worksheet);
     Q_ASSERT(reader.name() == QLatin1String("sheetData"));
 
     while (!reader.atEnd()
@@ -2005,6 +2341,12 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                 QXmlStreamAttributes attributes = reader.attributes();
                 QString r = attributes.value(QLatin1String("r")).toString();
                 CellReference pos(r);
+                // A cell without a usable reference has nowhere to go
+                if (!pos.isValid() || pos.row() > XLSX_ROW_MAX
+                    || pos.column() > XLSX_COLUMN_MAX) {
+                    reader.skipCurrentElement();
+                    continue;
+                }
 
                 // get format
                 Format format;
@@ -2034,13 +2376,16 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         cellType = Cell::NumberType;
                 }
 
-                QSharedPointer<Cell> cell(new Cell(QVariant(), cellType, format, q));
+                // Blank until a value is read
+                CellData cell(cellType, cellTable.addFormat(format));
+                cell.flags = CellData::Blank;
+                CellFormula formula;
+                QString text;
                 while (!reader.atEnd()
                        && !(reader.name() == QLatin1String("c")
                             && reader.tokenType() == QXmlStreamReader::EndElement)) {
                     if (reader.readNextStartElement()) {
                         if (reader.name() == QLatin1String("f")) {
-                            CellFormula &formula = cell->d_func()->formula;
                             formula.loadFromXml(reader);
                             if (formula.formulaType() == CellFormula::SharedType
                                 && !formula.formulaText().isEmpty()) {
@@ -2048,19 +2393,18 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                             }
                         } else if (reader.name() == QLatin1String("v")) {
                             QString value = reader.readElementText();
+                            cell.flags = 0;
                             if (cellType == Cell::SharedStringType) {
                                 int sst_idx = value.toInt();
                                 sharedStrings()->incRefByStringIndex(sst_idx);
-                                RichString rs = sharedStrings()->getSharedString(sst_idx);
-                                cell->d_func()->value = rs.toPlainString();
-                                if (rs.isRichString())
-                                    cell->d_func()->richString = rs;
+                                cell.index = sst_idx;
                             } else if (cellType == Cell::NumberType) {
-                                cell->d_func()->value = value.toDouble();
+                                parseDouble(value.constData(), value.constData() + value.size(),
+                                            &cell.number);
                             } else if (cellType == Cell::BooleanType) {
-                                cell->d_func()->value = value.toInt() ? true : false;
+                                cell.index = value.toInt() ? 1 : 0;
                             } else { // Cell::ErrorType and Cell::StringType
-                                cell->d_func()->value = value;
+                                text = value;
                             }
                         } else if (reader.name() == QLatin1String("is")) {
                             while (!reader.atEnd()
@@ -2069,7 +2413,8 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                                 if (reader.readNextStartElement()) {
                                     //:Todo, add rich text read support
                                     if (reader.name() == QLatin1String("t")) {
-                                        cell->d_func()->value = reader.readElementText();
+                                        cell.flags = 0;
+                                        text = reader.readElementText();
                                     }
                                 }
                             }
@@ -2083,10 +2428,224 @@ void WorksheetPrivate::loadXmlSheetData(QXmlStreamReader &reader)
                         }
                     }
                 }
-                cellTable[pos.row()][pos.column()] = cell;
+                cellTable.setCell(pos.row(), pos.column(), cell);
+                if (formula.isValid())
+                    cellTable.setFormula(pos.row(), pos.column(), formula);
+                if (!(cell.flags & CellData::Blank) && cellType != Cell::SharedStringType
+                    && cellType != Cell::NumberType && cellType != Cell::BooleanType)
+                    cellTable.setText(pos.row(), pos.column(), RichString(text));
+            }
+        }
+    }
+}
+
+/*
+  Loads the content of <sheetData> from the raw UTF-8 bytes in [begin, end),
+  with the same results as the QXmlStreamReader based loader. Returns false,
+  with nothing loaded, when the data uses something SheetDataReader does
+  not handle.
+ */
+bool WorksheetPrivate::loadXmlSheetData(const char *begin, const char *end)
+{
+    SheetDataReader reader(begin, end);
+    QVector<int> formats; // 1 + cellTable format of each style index, 0 until looked up
+    QVector<int> sharedStringIndexes; // references are only counted once all went well
+    const char *first;
+    const char *last;
+
+    bool ok = true;
+    while (ok) {
+        const SheetDataReader::TokenType token = reader.readNext();
+        if (token == SheetDataReader::EndOfData || token == SheetDataReader::Invalid) {
+            ok = token == SheetDataReader::EndOfData;
+            break;
+        }
+        if (token != SheetDataReader::StartElement)
+            continue;
+
+        if (reader.isName("row")) {
+            if (reader.attribute("customFormat", &first, &last)
+                || reader.attribute("customHeight", &first, &last)
+                || reader.attribute("hidden", &first, &last)
+                || reader.attribute("outlineLevel", &first, &last)
+                || reader.attribute("collapsed", &first, &last)) {
+
+                QSharedPointer<XlsxRowInfo> info(new XlsxRowInfo);
+                int idx = 0;
+                if (reader.attribute("customFormat", &first, &last)
+                    && reader.attribute("s", &first, &last)) {
+                    SheetDataReader::parseInt(first, last, &idx);
+                    info->format = workbook->styles()->xfFormat(idx);
+                }
+
+                if (reader.attribute("customHeight", &first, &last)) {
+                    info->customHeight = last - first == 1 && *first == '1';
+                    // Row height is only specified when customHeight is set
+                    if (reader.attribute("ht", &first, &last))
+                        parseDouble(first, last, &info->height);
+                }
+
+                // both "hidden" and "collapsed" default are false
+                info->hidden = reader.attribute("hidden", &first, &last) && last - first == 1
+                    && *first == '1';
+                info->collapsed = reader.attribute("collapsed", &first, &last)
+                    && last - first == 1 && *first == '1';
+
+                int outlineLevel = 0;
+                if (reader.attribute("outlineLevel", &first, &last)
+                    && SheetDataReader::parseInt(first, last, &outlineLevel))
+                    info->outlineLevel = outlineLevel;
+
+                //"r" is optional too.
+                if (reader.attribute("r", &first, &last)) {
+                    int row = 0;
+                    SheetDataReader::parseInt(first, last, &row);
+                    rowsInfo[row] = info;
+                }
+            }
+
+        } else if (reader.isName("c")) { // Cell
+            int row;
+            int col;
+            if (!reader.attribute("r", &first, &last)
+                || !parseCellReference(first, last, &row, &col) || row < 1
+                || row > XLSX_ROW_MAX || col > XLSX_COLUMN_MAX) {
+                ok = false;
+                break;
+            }
+
+            int style = 0;
+            if (reader.attribute("s", &first, &last)) { //"s" == style index
+                int idx = 0;
+                SheetDataReader::parseInt(first, last, &idx);
+                if (idx >= 0 && idx < 0x10000) {
+                    if (idx >= formats.size())
+                        formats.resize(idx + 1);
+                    if (!formats.at(idx))
+                        formats[idx] = cellTable.addFormat(workbook->styles()->xfFormat(idx)) + 1;
+                    style = formats.at(idx) - 1;
+                } else {
+                    style = cellTable.addFormat(workbook->styles()->xfFormat(idx));
+                }
+            }
+
+            Cell::CellType cellType = Cell::NumberType;
+            if (reader.attribute("t", &first, &last)) {
+                const QByteArray typeString = QByteArray::fromRawData(first, int(last - first));
+                if (typeString == "s")
+                    cellType = Cell::SharedStringType;
+                else if (typeString == "inlineStr")
+                    cellType = Cell::InlineStringType;
+                else if (typeString == "str")
+                    cellType = Cell::StringType;
+                else if (typeString == "b")
+                    cellType = Cell::BooleanType;
+                else if (typeString == "e")
+                    cellType = Cell::ErrorType;
+            }
+
+            // Blank until a value is read
+            CellData cell(cellType, style);
+            cell.flags = CellData::Blank;
+            CellFormula formula;
+            QString text;
+            while (ok) {
+                const SheetDataReader::TokenType token = reader.readNext();
+                if (token == SheetDataReader::EndElement && reader.isName("c"))
+                    break;
+                if (token != SheetDataReader::StartElement) {
+                    ok = token == SheetDataReader::EndElement;
+                    continue;
+                }
+
+                if (reader.isName("f")) {
+                    CellFormula::FormulaType type = CellFormula::NormalType;
+                    if (reader.attribute("t", &first, &last)) {
+                        const QByteArray typeString =
+                            QByteArray::fromRawData(first, int(last - first));
+                        if (typeString == "array")
+                            type = CellFormula::ArrayType;
+                        else if (typeString == "shared")
+                            type = CellFormula::SharedType;
+                    }
+                    CellRange reference;
+                    if (reader.attribute("ref", &first, &last))
+                        reference = CellRange(QString::fromLatin1(first, int(last - first)));
+                    const bool ca = reader.attribute("ca", &first, &last)
+                        && parseXsdBoolean(QString::fromLatin1(first, int(last - first)));
+                    int si = 0;
+                    const bool hasSi = reader.attribute("si", &first, &last)
+                        && SheetDataReader::parseInt(first, last, &si);
+
+                    ok = reader.readElementText(&first, &last);
+                    formula = CellFormula(QString(), reference, type);
+                    formula.d->formula = QString::fromUtf8(first, int(last - first));
+                    formula.d->ca = ca;
+                    if (hasSi)
+                        formula.d->si = si;
+                    if (formula.formulaType() == CellFormula::SharedType
+                        && !formula.formulaText().isEmpty()) {
+                        sharedFormulaMap[formula.sharedIndex()] = formula;
+                    }
+                } else if (reader.isName("v")) {
+                    ok = reader.readElementText(&first, &last);
+                    cell.flags = 0;
+                    if (cellType == Cell::SharedStringType) {
+                        int sst_idx = 0;
+                        SheetDataReader::parseInt(first, last, &sst_idx);
+                        sharedStringIndexes.append(sst_idx);
+                        cell.index = sst_idx;
+                    } else if (cellType == Cell::NumberType) {
+                        parseDouble(first, last, &cell.number);
+                    } else if (cellType == Cell::BooleanType) {
+                        int value = 0;
+                        SheetDataReader::parseInt(first, last, &value);
+                        cell.index = value ? 1 : 0;
+                    } else { // Cell::ErrorType and Cell::StringType
+                        text = QString::fromUtf8(first, int(last - first));
+                    }
+                } else if (reader.isName("is")) {
+                    //:Todo, add rich text read support
+                    for (int depth = 1; ok && depth;) {
+                        const SheetDataReader::TokenType token = reader.readNext();
+                        if (token == SheetDataReader::StartElement && reader.isName("t")) {
+                            ok = reader.readElementText(&first, &last);
+                            cell.flags = 0;
+                            text = QString::fromUtf8(first, int(last - first));
+                        } else if (token == SheetDataReader::StartElement) {
+                            ++depth;
+                        } else if (token == SheetDataReader::EndElement) {
+                            --depth;
+                        } else {
+                            ok = false;
+                        }
+                    }
+                } else {
+                    // extLst and the like
+                    ok = reader.skipCurrentElement();
+                }
             }
+            if (!ok)
+                break;
+
+            cellTable.setCell(row, col, cell);
+            if (formula.isValid())
+                cellTable.setFormula(row, col, formula);
+            if (!(cell.flags & CellData::Blank) && cellType != Cell::SharedStringType
+                && cellType != Cell::NumberType && cellType != Cell::BooleanType)
+                cellTable.setText(row, col, RichString(text));
         }
     }
+
+    if (!ok) {
+        cellTable.clear();
+        rowsInfo.clear();
+        sharedFormulaMap.clear();
+        return false;
+    }
+    for (int i = 0; i < sharedStringIndexes.size(); ++i)
+        sharedStrings()->incRefByStringIndex(sharedStringIndexes.at(i));
+    return true;
 }
 
 void WorksheetPrivate::loadXmlColumnsInfo(QXmlStreamReader &reader)
@@ -2330,11 +2889,50 @@ QList<QSharedPointer<XlsxRowInfo>> WorksheetPrivate::getRowInfoList(int rowFirst
     return rowInfoList;
 }
 
+namespace {
+
+/*
+  Finds the content of the <sheetData> element in the bytes of a sheet. Only
+  UTF-8 documents without a DTD or comments in front of it qualify.
+ */
+bool findSheetData(const QByteArray &data, int *contentStart, int *contentEnd)
+{
+    const int start = data.indexOf("<sheetData");
+    if (start == -1 || start + 10 >= data.size() || !strchr(" \t\r\n/>", data.at(start + 10)))
+        return false;
+
+    const QByteArray head = QByteArray::fromRawData(data.constData(), start);
+    if (head.contains("<!"))
+        return false;
+    const int encoding = head.indexOf("encoding=");
+    if (encoding != -1 && head.mid(encoding + 10, 5).toLower() != "utf-8")
+        return false;
+
+    const int tagEnd = data.indexOf('>', start);
+    if (tagEnd == -1 || data.at(tagEnd - 1) == '/')
+        return false; // an empty sheetData leaves nothing to speed up
+    *contentStart = tagEnd + 1;
+    *contentEnd = data.indexOf("</sheetData>", *contentStart);
+    return *contentEnd != -1;
+}
+
+} // namespace
+
 bool Worksheet::loadFromXmlFile(QIODevice *device)
 {
     Q_D(Worksheet);
 
-    QXmlStreamReader reader(device);
+    // The cells, which make up nearly all of a sheet, are read by
+    // SheetDataReader, only the rest goes through QXmlStreamReader.
+    QByteArray data = device->readAll();
+    int contentStart;
+    int contentEnd;
+    if (findSheetData(data, &contentStart, &contentEnd)
+        && d->loadXmlSheetData(data.constData() + contentStart, data.constData() + contentEnd)) {
+        data = data.left(contentStart) + data.mid(contentEnd);
+    }
+
+    QXmlStreamReader reader(data);
     while (!reader.atEnd()) {
         reader.readNextStartElement();
         if (reader.tokenType() == QXmlStreamReader::StartElement) {
@@ -2390,20 +2988,17 @@ void WorksheetPrivate::validateDimension()
     if (dimension.isValid() || cellTable.isEmpty())
         return;
 
-    int firstRow = cellTable.constBegin().key();
-    int lastRow = (cellTable.constEnd() - 1).key();
+    int firstRow = cellTable.firstRow();
+    int lastRow = cellTable.lastRow();
     int firstColumn = -1;
     int lastColumn = -1;
 
-    for (QMap<int, QMap<int, QSharedPointer<Cell>>>::const_iterator it = cellTable.begin();
-         it != cellTable.end(); ++it) {
-        Q_ASSERT(!it.value().isEmpty());
-
-        if (firstColumn == -1 || it.value().constBegin().key() < firstColumn)
-            firstColumn = it.value().constBegin().key();
+    for (int row = firstRow; row != -1; row = cellTable.nextRow(row)) {
+        if (firstColumn == -1 || cellTable.firstColumn(row) < firstColumn)
+            firstColumn = cellTable.firstColumn(row);
 
-        if (lastColumn == -1 || (it.value().constEnd() - 1).key() > lastColumn)
-            lastColumn = (it.value().constEnd() - 1).key();
+        if (lastColumn == -1 || cellTable.lastColumn(row) > lastColumn)
+            lastColumn = cellTable.lastColumn(row);
     }
 
     CellRange cr(firstRow, firstColumn, lastRow, lastColumn);
@@ -38,6 +38,7 @@ class QIODevice;
 class QDateTime;
 class QUrl;
 class QImage;
+class QAbstractItemModel;
 class WorksheetTest;
 
 QT_BEGIN_NAMESPACE_XLSX
@@ -57,6 +58,31 @@ class Q_XLSX_EXPORT Worksheet : public AbstractSheet
 {
     Q_DECLARE_PRIVATE(Worksheet)
 public:
+    enum ModelValueType {
+        ModelAutoValue,
+        ModelStringValue,
+        ModelNumericValue,
+        ModelDateTimeValue,
+        ModelBoolValue
+    };
+
+    struct ModelColumn
+    {
+        ModelColumn(int modelColumn = 0, ModelValueType type = ModelAutoValue,
+                    const Format &format = Format(), int role = Qt::DisplayRole)
+            : modelColumn(modelColumn)
+            , type(type)
+            , format(format)
+            , role(role)
+        {
+        }
+
+        int modelColumn;
+        ModelValueType type;
+        Format format;
+        int role;
+    };
+
     bool write(const CellReference &row_column, const QVariant &value,
                const Format &format = Format());
     bool write(int row, int column, const QVariant &value, const Format &format = Format());
@@ -96,6 +122,10 @@ public:
     bool writeHyperlink(int row, int column, const QUrl &url, const Format &format = Format(),
                         const QString &display = QString(), const QString &tip = QString());
 
+    bool writeModel(int row, int column, const QAbstractItemModel *model,
+                    const QList<ModelColumn> &columns = QList<ModelColumn>(),
+                    int firstModelRow = 0, int lastModelRow = -1);
+
     bool addDataValidation(const DataValidation &validation);
     bool addConditionalFormatting(const ConditionalFormatting &cf);
 
@@ -132,6 +162,9 @@ public:
     bool groupColumns(const CellRange &range, bool collapsed = true);
     CellRange dimension() const;
 
+    bool setStreamingEnabled(bool enable);
+    bool isStreamingEnabled() const;
+
     bool isWindowProtected() const;
     void setWindowProtected(bool protect);
     bool isFormulasVisible() const;
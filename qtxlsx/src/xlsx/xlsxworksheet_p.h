@@ -42,9 +42,11 @@
 #include "xlsxdatavalidation.h"
 #include "xlsxconditionalformatting.h"
 #include "xlsxcellformula.h"
+#include "xlsxcelltable_p.h"
 
 #include <QImage>
 #include <QSharedPointer>
+#include <QScopedPointer>
 #include <QRegularExpression>
 
 class QXmlStreamWriter;
@@ -57,6 +59,8 @@ const int XLSX_COLUMN_MAX = 16384;
 const int XLSX_STRING_MAX = 32767;
 
 class SharedStrings;
+class DeflateStream;
+class SheetDataWriter;
 
 struct XlsxHyperlinkData
 {
@@ -162,14 +166,18 @@ public:
     ~WorksheetPrivate();
     int checkDimensions(int row, int col, bool ignore_row = false, bool ignore_col = false);
     Format cellFormat(int row, int col) const;
+    QVariant cellValue(int row, int col, const CellData &cell) const;
     QString generateDimensionString() const;
-    void calculateSpans() const;
+    QString calculateSpan(int block) const;
     void splitColsInfo(int colFirst, int colLast);
     void validateDimension();
 
-    void saveXmlSheetData(QXmlStreamWriter &writer) const;
-    void saveXmlCellData(QXmlStreamWriter &writer, int row, int col,
-                         QSharedPointer<Cell> cell) const;
+    void saveXmlSheetHead(QXmlStreamWriter &writer) const;
+    void saveXmlSheetTail(QXmlStreamWriter &writer) const;
+    void saveXmlSheetData(SheetDataWriter &writer) const;
+    void saveXmlRow(SheetDataWriter &writer, int row_num, const QString &span) const;
+    void saveXmlCellData(SheetDataWriter &writer, int row, int col, const CellData &cell) const;
+    void saveXmlCellFormula(SheetDataWriter &writer, const CellFormula &formula) const;
     void saveXmlMergeCells(QXmlStreamWriter &writer) const;
     void saveXmlHyperlinks(QXmlStreamWriter &writer) const;
     void saveXmlDrawings(QXmlStreamWriter &writer) const;
@@ -178,6 +186,7 @@ public:
     int colPixelsSize(int col) const;
 
     void loadXmlSheetData(QXmlStreamReader &reader);
+    bool loadXmlSheetData(const char *begin, const char *end);
     void loadXmlColumnsInfo(QXmlStreamReader &reader);
     void loadXmlMergeCells(QXmlStreamReader &reader);
     void loadXmlDataValidations(QXmlStreamReader &reader);
@@ -191,8 +200,10 @@ public:
     bool isColumnRangeValid(int colFirst, int colLast);
 
     SharedStrings *sharedStrings() const;
+    bool streamRowsBefore(int row);
+    bool finishStream();
 
-    QMap<int, QMap<int, QSharedPointer<Cell>>> cellTable;
+    CellTable cellTable;
     QMap<int, QMap<int, QString>> comments;
     QMap<int, QMap<int, QSharedPointer<XlsxHyperlinkData>>> urlTable;
     QList<CellRange> merges;
@@ -207,7 +218,6 @@ public:
     CellRange dimension;
     int previous_row;
 
-    mutable QMap<int, QString> row_spans;
     QMap<int, double> row_sizes;
     QMap<int, double> col_sizes;
 
@@ -232,6 +242,13 @@ public:
 
     QRegularExpression urlPattern;
 
+    // Streaming mode, rows up to streamedRow have been written out
+    bool streaming;
+    int streamedRow;
+    QScopedPointer<DeflateStream> stream;
+    QScopedPointer<QXmlStreamWriter> streamWriter;
+    QScopedPointer<SheetDataWriter> streamSheetData;
+
 private:
     static double calculateColWidth(int characters);
 };
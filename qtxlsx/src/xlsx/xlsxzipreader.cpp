@@ -27,17 +27,151 @@
 
 #include <private/qzipreader_p.h>
 #include <QtCore/qvector.h>
+#include <QFile>
+#include <QtEndian>
+
+#include <zlib.h>
 
 namespace QXlsx {
 
+namespace {
+const int ChunkSize = 64 * 1024;
+const quint16 StoredMethod = 0;
+const quint16 DeflatedMethod = 8;
+const int EndOfDirectorySize = 22;
+const int DirectoryEntrySize = 46;
+const int LocalHeaderSize = 30;
+
+quint16 readUInt16(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+
+quint32 readUInt32(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+}
+} // namespace
+
+class InflateStreamPrivate
+{
+public:
+    QIODevice *archive;
+    QScopedPointer<QIODevice> ownedArchive;
+    z_stream stream;
+    QByteArray input;
+    qint64 position;
+    qint64 remaining;
+    bool deflated;
+    bool initialized;
+    bool finished;
+};
+
+/*
+ * Reads \a compressedSize bytes of entry data starting at \a offset of
+ * \a archive. The archive is sought before each read, so it can be shared
+ * with other readers.
+ */
+InflateStream::InflateStream(QIODevice *archive, qint64 offset, qint64 compressedSize,
+                             bool deflated, bool ownsArchive)
+    : d(new InflateStreamPrivate)
+{
+    d->archive = archive;
+    if (ownsArchive)
+        d->ownedArchive.reset(archive);
+    d->position = offset;
+    d->remaining = compressedSize;
+    d->deflated = deflated;
+    d->finished = false;
+    d->initialized = false;
+    if (deflated) {
+        d->stream.zalloc = Z_NULL;
+        d->stream.zfree = Z_NULL;
+        d->stream.opaque = Z_NULL;
+        d->stream.next_in = Z_NULL;
+        d->stream.avail_in = 0;
+        // Raw deflate, zip entries carry no zlib header
+        d->initialized = inflateInit2(&d->stream, -MAX_WBITS) == Z_OK;
+        if (!d->initialized)
+            return;
+    }
+    QIODevice::open(QIODevice::ReadOnly);
+}
+
+InflateStream::~InflateStream()
+{
+    if (d->initialized)
+        inflateEnd(&d->stream);
+}
+
+qint64 InflateStream::readData(char *data, qint64 maxSize)
+{
+    if (!d->deflated) {
+        const qint64 size = qMin(maxSize, d->remaining);
+        if (size <= 0)
+            return 0;
+        if (!d->archive->seek(d->position))
+            return -1;
+        const qint64 read = d->archive->read(data, size);
+        if (read <= 0)
+            return -1;
+        d->position += read;
+        d->remaining -= read;
+        return read;
+    }
+
+    if (!d->initialized)
+        return -1;
+
+    qint64 produced = 0;
+    while (produced == 0 && !d->finished) {
+        if (d->stream.avail_in == 0 && d->remaining > 0) {
+            if (!d->archive->seek(d->position))
+                return -1;
+            d->input = d->archive->read(qMin<qint64>(d->remaining, ChunkSize));
+            if (d->input.isEmpty())
+                return -1;
+            d->position += d->input.size();
+            d->remaining -= d->input.size();
+            d->stream.next_in = reinterpret_cast<Bytef *>(d->input.data());
+            d->stream.avail_in = uInt(d->input.size());
+        }
+
+        const uInt room = uInt(qMin<qint64>(maxSize, ChunkSize));
+        d->stream.next_out = reinterpret_cast<Bytef *>(data);
+        d->stream.avail_out = room;
+        const int ret = inflate(&d->stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END)
+            d->finished = true;
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            return -1;
+        produced = room - d->stream.avail_out;
+        if (!produced && !d->finished && d->stream.avail_in == 0 && d->remaining <= 0)
+            return -1; // truncated entry
+    }
+    return produced;
+}
+
+qint64 InflateStream::writeData(const char *data, qint64 size)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    return -1;
+}
+
 ZipReader::ZipReader(const QString &filePath)
     : m_reader(new QZipReader(filePath))
+    , m_fileName(filePath)
+    , m_device(0)
+    , m_directoryRead(false)
 {
     init();
 }
 
 ZipReader::ZipReader(QIODevice *device)
     : m_reader(new QZipReader(device))
+    , m_device(device)
+    , m_directoryRead(false)
 {
     init();
 }
@@ -70,4 +204,95 @@ QByteArray ZipReader::fileData(const QString &fileName) const
     return m_reader->fileData(fileName);
 }
 
+/*
+ * Returns a device that inflates \a fileName while it is read, or 0 if there
+ * is no such entry. The caller takes ownership of the device, which must not
+ * outlive a device the reader was created on.
+ */
+QIODevice *ZipReader::openFile(const QString &fileName) const
+{
+    QScopedPointer<QFile> file;
+    QIODevice *archive = m_device;
+    if (!archive) {
+        file.reset(new QFile(m_fileName));
+        if (!file->open(QIODevice::ReadOnly))
+            return 0;
+        archive = file.data();
+    }
+
+    if (!m_directoryRead) {
+        m_directoryRead = true;
+        if (!readDirectory(archive))
+            m_entries.clear();
+    }
+    if (!m_entries.contains(fileName))
+        return 0;
+
+    const Entry entry = m_entries.value(fileName);
+    if (entry.method != StoredMethod && entry.method != DeflatedMethod)
+        return 0;
+    if (!archive->seek(entry.headerOffset))
+        return 0;
+    const QByteArray header = archive->read(LocalHeaderSize);
+    if (header.size() != LocalHeaderSize || readUInt32(header.constData()) != 0x04034b50)
+        return 0;
+    const qint64 dataOffset = entry.headerOffset + LocalHeaderSize
+        + readUInt16(header.constData() + 26) + readUInt16(header.constData() + 28);
+
+    return new InflateStream(archive, dataOffset, entry.compressedSize,
+                             entry.method == DeflatedMethod, file.take() != 0);
+}
+
+/*
+ * Collects the entry offsets from the central directory, which
+ * QZipReader does not expose.
+ */
+bool ZipReader::readDirectory(QIODevice *archive) const
+{
+    // The end of central directory record is followed by a comment of up to 64 KB
+    const qint64 size = archive->size();
+    const qint64 tailSize = qMin<qint64>(size, EndOfDirectorySize + 0xffff);
+    if (tailSize < EndOfDirectorySize || !archive->seek(size - tailSize))
+        return false;
+    const QByteArray tail = archive->read(tailSize);
+    int pos = tail.size() - EndOfDirectorySize;
+    while (pos >= 0 && readUInt32(tail.constData() + pos) != 0x06054b50)
+        --pos;
+    if (pos < 0)
+        return false;
+
+    const int entryCount = readUInt16(tail.constData() + pos + 10);
+    const qint64 directorySize = readUInt32(tail.constData() + pos + 12);
+    const qint64 directoryOffset = readUInt32(tail.constData() + pos + 16);
+    if (!archive->seek(directoryOffset))
+        return false;
+    const QByteArray directory = archive->read(directorySize);
+    if (directory.size() != directorySize)
+        return false;
+
+    const char *data = directory.constData();
+    int offset = 0;
+    for (int i = 0; i < entryCount; ++i) {
+        if (offset + DirectoryEntrySize > directory.size()
+            || readUInt32(data + offset) != 0x02014b50)
+            return false;
+        const int nameLength = readUInt16(data + offset + 28);
+        const int extraLength = readUInt16(data + offset + 30);
+        const int commentLength = readUInt16(data + offset + 32);
+        if (offset + DirectoryEntrySize + nameLength > directory.size())
+            return false;
+
+        Entry entry;
+        entry.method = readUInt16(data + offset + 10);
+        entry.compressedSize = readUInt32(data + offset + 20);
+        entry.headerOffset = readUInt32(data + offset + 42);
+        const QByteArray name(data + offset + DirectoryEntrySize, nameLength);
+        // Bit 11 of the flags marks UTF-8 names
+        const bool utf8 = readUInt16(data + offset + 8) & 0x0800;
+        m_entries.insert(utf8 ? QString::fromUtf8(name) : QString::fromLocal8Bit(name), entry);
+        offset += DirectoryEntrySize + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
 } // namespace QXlsx
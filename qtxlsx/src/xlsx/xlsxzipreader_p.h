@@ -38,13 +38,38 @@
 //
 
 #include "xlsxglobal.h"
+#include <QHash>
+#include <QIODevice>
 #include <QScopedPointer>
 #include <QStringList>
 class QZipReader;
-class QIODevice;
 
 namespace QXlsx {
 
+class InflateStreamPrivate;
+
+/*
+ * Read-only device that inflates one zip entry chunk by chunk, so that
+ * large entries can be parsed without holding them in memory.
+ */
+class XLSX_AUTOTEST_EXPORT InflateStream : public QIODevice
+{
+public:
+    InflateStream(QIODevice *archive, qint64 offset, qint64 compressedSize, bool deflated,
+                  bool ownsArchive = false);
+    ~InflateStream();
+
+    bool isSequential() const { return true; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    Q_DISABLE_COPY(InflateStream)
+    QScopedPointer<InflateStreamPrivate> d;
+};
+
 class XLSX_AUTOTEST_EXPORT ZipReader
 {
 public:
@@ -54,12 +79,26 @@ public:
     bool exists() const;
     QStringList filePaths() const;
     QByteArray fileData(const QString &fileName) const;
+    QIODevice *openFile(const QString &fileName) const;
 
 private:
     Q_DISABLE_COPY(ZipReader)
+    struct Entry
+    {
+        quint16 method;
+        qint64 compressedSize;
+        qint64 headerOffset;
+    };
+
     void init();
+    bool readDirectory(QIODevice *archive) const;
+
     QScopedPointer<QZipReader> m_reader;
     QStringList m_filePaths;
+    QString m_fileName;
+    QIODevice *m_device;
+    mutable QHash<QString, Entry> m_entries;
+    mutable bool m_directoryRead;
 };
 
 } // namespace QXlsx
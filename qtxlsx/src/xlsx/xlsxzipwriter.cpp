@@ -23,46 +23,408 @@
 **
 ****************************************************************************/
 #include "xlsxzipwriter_p.h"
-#include <QDebug>
-#include <private/qzipwriter_p.h>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QtEndian>
+
+#include <zlib.h>
 
 namespace QXlsx {
 
+namespace {
+const quint16 StoredMethod = 0;
+const quint16 DeflatedMethod = 8;
+// General purpose flag: file names are encoded in UTF-8
+const quint16 Utf8NameFlag = 0x0800;
+const quint16 ZipVersion = 20;
+const qint64 MaxEntrySize = 0xffffffffLL;
+const int MaxEntryCount = 0xffff;
+const int ChunkSize = 64 * 1024;
+
+void appendUInt16(QByteArray &data, quint16 value)
+{
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    data.append(bytes, 2);
+}
+
+void appendUInt32(QByteArray &data, quint32 value)
+{
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    data.append(bytes, 4);
+}
+
+// Raw deflate, as zip entries carry no zlib header
+bool initRawDeflate(z_stream *stream)
+{
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    return deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                        Z_DEFAULT_STRATEGY)
+        == Z_OK;
+}
+
+QByteArray deflateData(const QByteArray &data)
+{
+    z_stream stream;
+    if (!initRawDeflate(&stream))
+        return QByteArray();
+
+    QByteArray result;
+    result.resize(int(deflateBound(&stream, uLong(data.size()))));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(result.data());
+    stream.avail_out = uInt(result.size());
+    const int ret = deflate(&stream, Z_FINISH);
+    result.resize(int(stream.total_out));
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END ? result : QByteArray();
+}
+} // namespace
+
+class DeflateStreamPrivate
+{
+public:
+    bool flushOutput(int flush);
+
+    z_stream stream;
+    QTemporaryFile file;
+    QByteArray buffer;
+    quint32 crc = 0;
+    qint64 size = 0;
+    bool initialized = false;
+    bool finished = false;
+};
+
+bool DeflateStreamPrivate::flushOutput(int flush)
+{
+    int ret;
+    do {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = uInt(buffer.size());
+        ret = deflate(&stream, flush);
+        if (ret == Z_STREAM_ERROR)
+            return false;
+        const qint64 produced = buffer.size() - stream.avail_out;
+        if (produced && file.write(buffer.constData(), produced) != produced)
+            return false;
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+    return true;
+}
+
+DeflateStream::DeflateStream()
+    : d(new DeflateStreamPrivate)
+{
+}
+
+DeflateStream::~DeflateStream()
+{
+    if (d->initialized)
+        deflateEnd(&d->stream);
+}
+
+/*
+ * Creates the temporary file, only write-only mode is supported.
+ */
+bool DeflateStream::open(OpenMode mode)
+{
+    if (mode != QIODevice::WriteOnly || d->initialized || !d->file.open())
+        return false;
+    if (!initRawDeflate(&d->stream))
+        return false;
+    d->initialized = true;
+    d->buffer.resize(ChunkSize);
+    d->crc = ::crc32(0L, Z_NULL, 0);
+    return QIODevice::open(mode);
+}
+
+/*
+ * Flushes the compressor, nothing can be written afterwards.
+ */
+bool DeflateStream::finish()
+{
+    if (d->finished)
+        return true;
+    if (!d->initialized)
+        return false;
+
+    d->stream.next_in = Z_NULL;
+    d->stream.avail_in = 0;
+    const bool ok = d->flushOutput(Z_FINISH) && d->file.flush();
+    deflateEnd(&d->stream);
+    d->initialized = false;
+    d->buffer.clear();
+    d->finished = ok;
+    QIODevice::close();
+    return ok;
+}
+
+bool DeflateStream::isFinished() const
+{
+    return d->finished;
+}
+
+quint32 DeflateStream::crc() const
+{
+    return d->crc;
+}
+
+qint64 DeflateStream::uncompressedSize() const
+{
+    return d->size;
+}
+
+qint64 DeflateStream::compressedSize() const
+{
+    return d->file.size();
+}
+
+/*
+ * The deflated bytes, valid once finish() succeeded.
+ */
+QIODevice *DeflateStream::compressedData() const
+{
+    return &d->file;
+}
+
+qint64 DeflateStream::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+qint64 DeflateStream::writeData(const char *data, qint64 size)
+{
+    if (!d->initialized)
+        return -1;
+
+    qint64 written = 0;
+    while (written < size) {
+        const uInt chunk = uInt(qMin<qint64>(size - written, ChunkSize));
+        const Bytef *bytes = reinterpret_cast<const Bytef *>(data + written);
+        d->crc = ::crc32(d->crc, bytes, chunk);
+        d->stream.next_in = const_cast<Bytef *>(bytes);
+        d->stream.avail_in = chunk;
+        if (!d->flushOutput(Z_NO_FLUSH))
+            return -1;
+        written += chunk;
+    }
+    d->size += written;
+    return written;
+}
+
 ZipWriter::ZipWriter(const QString &filePath)
+    : m_file(new QFile(filePath))
+    , m_device(m_file.data())
 {
-    m_writer = new QZipWriter(filePath, QIODevice::WriteOnly);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    init();
+    if (!m_file->open(QIODevice::WriteOnly))
+        m_error = true;
 }
 
 ZipWriter::ZipWriter(QIODevice *device)
+    : m_device(device)
 {
-    m_writer = new QZipWriter(device);
-    m_writer->setCompressionPolicy(QZipWriter::AutoCompress);
+    init();
+    if (!m_device->isOpen() && !m_device->open(QIODevice::WriteOnly))
+        m_error = true;
+    else if (!m_device->isWritable())
+        m_error = true;
 }
 
 ZipWriter::~ZipWriter()
 {
-    delete m_writer;
+    close();
+}
+
+void ZipWriter::init()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    const QDate date = now.date();
+    const QTime time = now.time();
+    m_dosTime = quint16((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+    m_dosDate =
+        quint16(((qMax(date.year(), 1980) - 1980) << 9) | (date.month() << 5) | date.day());
+    m_offset = 0;
+    m_error = false;
+    m_closed = false;
 }
 
 bool ZipWriter::error() const
 {
-    return m_writer->status() != QZipWriter::NoError;
+    return m_error;
 }
 
 void ZipWriter::addFile(const QString &filePath, QIODevice *device)
 {
-    m_writer->addFile(filePath, device);
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+        m_error = true;
+        return;
+    }
+    addFile(filePath, device->readAll());
 }
 
 void ZipWriter::addFile(const QString &filePath, const QByteArray &data)
 {
-    m_writer->addFile(filePath, data);
+    addPreparedFile(filePath, prepareFile(data));
+}
+
+ZipWriter::PreparedFile ZipWriter::prepareFile(const QByteArray &data)
+{
+    PreparedFile file;
+    file.crc = ::crc32(::crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(data.constData()),
+                       uInt(data.size()));
+    file.size = data.size();
+    file.data = deflateData(data);
+    file.method = DeflatedMethod;
+
+    // Store the data as is when compression does not pay off
+    if (file.data.isEmpty() || file.data.size() >= data.size()) {
+        file.data = data;
+        file.method = StoredMethod;
+    }
+    return file;
+}
+
+void ZipWriter::addPreparedFile(const QString &filePath, const PreparedFile &file)
+{
+    if (addEntry(filePath, file.method, file.crc, file.data.size(), file.size))
+        write(file.data);
+}
+
+/*
+ * Copies the already deflated contents of \a stream into the package,
+ * the stream is finished first if needed.
+ */
+void ZipWriter::addDeflatedFile(const QString &filePath, DeflateStream *stream)
+{
+    if (!stream->finish()) {
+        m_error = true;
+        return;
+    }
+    if (!addEntry(filePath, DeflatedMethod, stream->crc(), stream->compressedSize(),
+                  stream->uncompressedSize()))
+        return;
+
+    QIODevice *data = stream->compressedData();
+    if (!data->seek(0)) {
+        m_error = true;
+        return;
+    }
+    // The entry header is written already, a short copy would leave it lying about the size
+    const qint64 size = stream->compressedSize();
+    qint64 copied = 0;
+    while (!m_error && copied < size) {
+        const QByteArray chunk = data->read(qMin<qint64>(size - copied, ChunkSize));
+        if (chunk.isEmpty())
+            break;
+        write(chunk);
+        copied += chunk.size();
+    }
+    if (copied != size)
+        m_error = true;
+}
+
+bool ZipWriter::addEntry(const QString &filePath, quint16 method, quint32 crc,
+                         qint64 compressedSize, qint64 size)
+{
+    // Zip64 is not supported, so each entry and the package are limited to 4 GB
+    if (m_error || m_closed || m_entries.size() >= MaxEntryCount || compressedSize > MaxEntrySize
+        || size > MaxEntrySize || m_offset > MaxEntrySize) {
+        m_error = true;
+        return false;
+    }
+
+    Entry entry;
+    entry.name = filePath.toUtf8();
+    entry.method = method;
+    entry.crc = crc;
+    entry.compressedSize = quint32(compressedSize);
+    entry.size = quint32(size);
+    entry.offset = quint32(m_offset);
+    m_entries.append(entry);
+
+    QByteArray header;
+    appendUInt32(header, 0x04034b50);
+    appendUInt16(header, ZipVersion);
+    appendUInt16(header, Utf8NameFlag);
+    appendUInt16(header, entry.method);
+    appendUInt16(header, m_dosTime);
+    appendUInt16(header, m_dosDate);
+    appendUInt32(header, entry.crc);
+    appendUInt32(header, entry.compressedSize);
+    appendUInt32(header, entry.size);
+    appendUInt16(header, quint16(entry.name.size()));
+    appendUInt16(header, 0); // extra field length
+    header.append(entry.name);
+    return write(header);
+}
+
+bool ZipWriter::write(const QByteArray &data)
+{
+    if (m_error)
+        return false;
+    if (m_device->write(data) != data.size()) {
+        m_error = true;
+        return false;
+    }
+    m_offset += data.size();
+    return true;
 }
 
 void ZipWriter::close()
 {
-    m_writer->close();
+    if (m_closed)
+        return;
+
+    if (!m_error) {
+        const qint64 directoryOffset = m_offset;
+        QByteArray directory;
+        foreach (const Entry &entry, m_entries) {
+            appendUInt32(directory, 0x02014b50);
+            appendUInt16(directory, ZipVersion); // version made by
+            appendUInt16(directory, ZipVersion); // version needed to extract
+            appendUInt16(directory, Utf8NameFlag);
+            appendUInt16(directory, entry.method);
+            appendUInt16(directory, m_dosTime);
+            appendUInt16(directory, m_dosDate);
+            appendUInt32(directory, entry.crc);
+            appendUInt32(directory, entry.compressedSize);
+            appendUInt32(directory, entry.size);
+            appendUInt16(directory, quint16(entry.name.size()));
+            appendUInt16(directory, 0); // extra field length
+            appendUInt16(directory, 0); // file comment length
+            appendUInt16(directory, 0); // disk number start
+            appendUInt16(directory, 0); // internal file attributes
+            appendUInt32(directory, 0); // external file attributes
+            appendUInt32(directory, entry.offset);
+            directory.append(entry.name);
+        }
+
+        const quint32 directorySize = quint32(directory.size());
+        if (directoryOffset + directorySize > MaxEntrySize) {
+            m_error = true;
+        } else {
+            appendUInt32(directory, 0x06054b50);
+            appendUInt16(directory, 0); // number of this disk
+            appendUInt16(directory, 0); // disk where the central directory starts
+            appendUInt16(directory, quint16(m_entries.size()));
+            appendUInt16(directory, quint16(m_entries.size()));
+            appendUInt32(directory, directorySize);
+            appendUInt32(directory, quint32(directoryOffset));
+            appendUInt16(directory, 0); // comment length
+            write(directory);
+        }
+    }
+
+    if (m_file)
+        m_file->close();
+    m_closed = true;
 }
 
 } // namespace QXlsx
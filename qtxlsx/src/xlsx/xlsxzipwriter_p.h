@@ -36,26 +36,108 @@
 // We mean it.
 //
 
+#include "xlsxglobal.h"
+#include <QIODevice>
+#include <QScopedPointer>
 #include <QString>
-class QIODevice;
-class QZipWriter;
+#include <QVector>
+
+class QFile;
 
 namespace QXlsx {
 
-class ZipWriter
+class DeflateStreamPrivate;
+
+/*
+ * Write-only device that deflates everything written to it into a temporary
+ * file, so that a zip entry can be produced piece by piece long before the
+ * package itself is written. See ZipWriter::addDeflatedFile().
+ */
+class XLSX_AUTOTEST_EXPORT DeflateStream : public QIODevice
+{
+public:
+    DeflateStream();
+    ~DeflateStream();
+
+    bool open(OpenMode mode = QIODevice::WriteOnly);
+    bool isSequential() const { return true; }
+    bool finish();
+    bool isFinished() const;
+
+    quint32 crc() const;
+    qint64 uncompressedSize() const;
+    qint64 compressedSize() const;
+    QIODevice *compressedData() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 size);
+
+private:
+    Q_DISABLE_COPY(DeflateStream)
+    QScopedPointer<DeflateStreamPrivate> d;
+};
+
+class XLSX_AUTOTEST_EXPORT ZipWriter
 {
 public:
+    /*
+     * The contents of an entry, compressed ahead of time by prepareFile().
+     * Preparing touches no ZipWriter, so it can run on any thread.
+     */
+    struct PreparedFile
+    {
+        PreparedFile()
+            : method(0)
+            , crc(0)
+            , size(0)
+        {
+        }
+
+        QByteArray data;
+        quint16 method;
+        quint32 crc;
+        qint64 size;
+    };
+
     explicit ZipWriter(const QString &filePath);
     explicit ZipWriter(QIODevice *device);
     ~ZipWriter();
 
+    static PreparedFile prepareFile(const QByteArray &data);
+
     void addFile(const QString &filePath, QIODevice *device);
     void addFile(const QString &filePath, const QByteArray &data);
+    void addPreparedFile(const QString &filePath, const PreparedFile &file);
+    void addDeflatedFile(const QString &filePath, DeflateStream *stream);
     bool error() const;
     void close();
 
 private:
-    QZipWriter *m_writer;
+    Q_DISABLE_COPY(ZipWriter)
+    struct Entry
+    {
+        QByteArray name;
+        quint16 method;
+        quint32 crc;
+        quint32 compressedSize;
+        quint32 size;
+        quint32 offset;
+    };
+
+    void init();
+    bool addEntry(const QString &filePath, quint16 method, quint32 crc, qint64 compressedSize,
+                  qint64 size);
+    bool write(const QByteArray &data);
+
+    QScopedPointer<QFile> m_file;
+    QIODevice *m_device;
+    QVector<Entry> m_entries;
+    qint64 m_offset;
+    quint16 m_dosTime;
+    quint16 m_dosDate;
+    bool m_error;
+    bool m_closed;
 };
 
 } // namespace QXlsx
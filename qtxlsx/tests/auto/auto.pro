@@ -13,4 +13,6 @@ SUBDIRS=\
     richstring \
     xlsxconditionalformatting \
     cellreference \
+    sheetreader \
+    numberconversion \
     cmake
@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += testlib xlsx #xlsx-private
+QT       += testlib xlsx xlsx-private
 CONFIG += testcase
 DEFINES += XLSX_TEST
 
@@ -1,6 +1,8 @@
 #include "xlsxcellreference.h"
+#include "private/xlsxcellreference_p.h"
 #include <QString>
 #include <QtTest>
+#include <limits.h>
 
 using namespace QXlsx;
 
@@ -16,6 +18,9 @@ private Q_SLOTS:
     void test_toString();
     void test_fromString_data();
     void test_fromString();
+    void test_parseBytes_data();
+    void test_parseBytes();
+    void test_format();
 };
 
 CellReferenceTest::CellReferenceTest()
@@ -50,6 +55,54 @@ void CellReferenceTest::test_fromString_data()
     QTest::newRow("IU2") << "IU2" << 2 << 255;
     QTest::newRow("XFD1") << "XFD1" << 1 << 16384;
     QTest::newRow("XFE1048577") << "XFE1048577" << 1048577 << 16385;
+    QTest::newRow("empty") << "" << -1 << -1;
+    QTest::newRow("lower case") << "a1" << -1 << -1;
+    QTest::newRow("no row") << "AB" << -1 << -1;
+    QTest::newRow("no column") << "12" << -1 << -1;
+    QTest::newRow("four letters") << "ABCD1" << -1 << -1;
+    QTest::newRow("trailing") << "A1 " << -1 << -1;
+    QTest::newRow("overflow") << "A2147483648" << -1 << -1;
+}
+
+void CellReferenceTest::test_parseBytes()
+{
+    QFETCH(QString, cell);
+    QFETCH(int, row);
+    QFETCH(int, col);
+
+    const QByteArray bytes = cell.toLatin1();
+    int parsedRow = -1;
+    int parsedColumn = -1;
+    const bool ok = parseCellReference(bytes.constData(), bytes.constData() + bytes.size(),
+                                       &parsedRow, &parsedColumn);
+    QCOMPARE(ok, row != -1);
+    QCOMPARE(parsedRow, row);
+    QCOMPARE(parsedColumn, col);
+}
+
+void CellReferenceTest::test_parseBytes_data()
+{
+    test_fromString_data();
+}
+
+void CellReferenceTest::test_format()
+{
+    for (int col = 1; col <= 18278; ++col) {
+        const int row = col * 57 % 1048576 + 1;
+        char buffer[CellReferenceBufferSize];
+        const int size = formatCellReference(row, col, buffer, true, true);
+        int parsedRow;
+        int parsedColumn;
+        QVERIFY(parseCellReference(buffer, buffer + size, &parsedRow, &parsedColumn));
+        QCOMPARE(parsedRow, row);
+        QCOMPARE(parsedColumn, col);
+    }
+
+    char buffer[CellReferenceBufferSize];
+    QCOMPARE(QByteArray(buffer, formatCellReference(1048576, 16384, buffer)),
+             QByteArray("XFD1048576"));
+    QCOMPARE(QByteArray(buffer, formatCellReference(INT_MAX, INT_MAX, buffer, true, true)),
+             QByteArray("$FXSHRXW$2147483647"));
 }
 
 void CellReferenceTest::test_toString()
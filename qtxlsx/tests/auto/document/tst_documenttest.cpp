@@ -2,6 +2,11 @@
 #include "xlsxcell.h"
 #include "xlsxformat.h"
 #include "xlsxcellformula.h"
+#include "xlsxworksheet.h"
+#include "xlsxworkbook.h"
+#include "private/xlsxzipreader_p.h"
+#include "private/xlsxrelationships_p.h"
+#include "private/xlsxsharedstrings_p.h"
 #include <QString>
 #include <QtTest>
 
@@ -24,10 +29,13 @@ private Q_SLOTS:
     void testReadWriteDateTime();
     void testReadWriteDate();
     void testReadWriteTime();
+    void testStreamedWorksheet();
+    void testSaveManySheets();
 
     void testMoveWorksheet();
     void testDeleteWorksheet();
     void testCopyWorksheet();
+    void testCopyWorksheetSharedStrings();
 };
 
 DocumentTest::DocumentTest()
@@ -306,6 +314,110 @@ void DocumentTest::testReadWriteTime()
     QCOMPARE(xlsx2.read("A2").toTime(), QTime(1, 22));
 }
 
+void DocumentTest::testStreamedWorksheet()
+{
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+
+    Document xlsx1;
+    Worksheet *sheet = xlsx1.currentWorksheet();
+    QVERIFY(sheet->setStreamingEnabled(true));
+    QVERIFY(sheet->isStreamingEnabled());
+
+    Format bold;
+    bold.setFontBold(true);
+    sheet->write(1, 1, "Name", bold);
+    sheet->write(1, 2, "Size", bold);
+    QVERIFY(sheet->setColumnWidth(1, 1, 40));
+    for (int row = 2; row <= 2000; ++row) {
+        sheet->write(row, 1, QString("file%1").arg(row % 100));
+        sheet->write(row, 2, row * 1.5);
+    }
+
+    // Rows before the last one have been written out
+    QVERIFY(!sheet->cellAt(1, 1));
+    QCOMPARE(sheet->read(2000, 2).toDouble(), 3000.0);
+    QVERIFY(!sheet->write(10, 3, 1));
+    QVERIFY(!sheet->setColumnWidth(2, 2, 20));
+    QVERIFY(!sheet->setStreamingEnabled(false));
+    QVERIFY(sheet->mergeCells(CellRange(2001, 1, 2001, 2)));
+
+    QVERIFY(xlsx1.saveAs(&device));
+    // The streamed sheet can be saved once more
+    QBuffer device2;
+    device2.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&device2));
+    QCOMPARE(device2.data().size(), device.data().size());
+
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2(&device);
+    QCOMPARE(xlsx2.read(1, 1).toString(), QString("Name"));
+    QVERIFY(xlsx2.cellAt(1, 2)->format().fontBold());
+    QCOMPARE(xlsx2.currentWorksheet()->columnWidth(1), 40.0);
+    QCOMPARE(xlsx2.read(2, 1).toString(), QString("file2"));
+    QCOMPARE(xlsx2.read(1234, 1).toString(), QString("file34"));
+    QCOMPARE(xlsx2.read(1234, 2).toDouble(), 1851.0);
+    QCOMPARE(xlsx2.read(2000, 2).toDouble(), 3000.0);
+    QCOMPARE(xlsx2.currentWorksheet()->mergedCells().size(), 1);
+    QCOMPARE(xlsx2.dimension(), CellRange(1, 1, 2001, 2));
+}
+
+void DocumentTest::testSaveManySheets()
+{
+    Document xlsx1;
+    for (int i = 1; i <= 24; ++i) {
+        xlsx1.addSheet(QString("Sheet%1").arg(i));
+        Worksheet *sheet = xlsx1.currentWorksheet();
+        for (int row = 1; row <= 500; ++row) {
+            sheet->write(row, 1, QString("item%1").arg(row % 37));
+            sheet->write(row, 2, row / 7.0 + i);
+        }
+        if (i % 3 == 0)
+            sheet->writeHyperlink(1, 3, QUrl("http://qtxlsx.debao.me"));
+    }
+
+    // The parts are saved on several threads, the package must not change
+    QBuffer device1;
+    device1.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&device1));
+    QBuffer device2;
+    device2.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&device2));
+
+    device1.open(QIODevice::ReadOnly);
+    device2.open(QIODevice::ReadOnly);
+    ZipReader reader1(&device1);
+    ZipReader reader2(&device2);
+    const QStringList paths = reader1.filePaths();
+    QCOMPARE(reader2.filePaths(), paths);
+    QCOMPARE(paths.at(0), QString("xl/worksheets/sheet1.xml"));
+    QCOMPARE(paths.at(1), QString("xl/worksheets/sheet2.xml"));
+    QCOMPARE(paths.at(2), QString("xl/worksheets/sheet3.xml"));
+    QCOMPARE(paths.at(3), QString("xl/worksheets/_rels/sheet3.xml.rels"));
+    QCOMPARE(paths.last(), QString("[Content_Types].xml"));
+    foreach (const QString &path, paths)
+        QCOMPARE(reader2.fileData(path), reader1.fileData(path));
+
+    // Same parts as saving the sheets one after the other
+    for (int i = 1; i <= 24; ++i) {
+        AbstractSheet *sheet = xlsx1.sheet(QString("Sheet%1").arg(i));
+        QCOMPARE(reader1.fileData(QString("xl/worksheets/sheet%1.xml").arg(i)),
+                 sheet->saveToXmlData());
+        const QString relsPath = QString("xl/worksheets/_rels/sheet%1.xml.rels").arg(i);
+        if (i % 3 == 0)
+            QCOMPARE(reader1.fileData(relsPath), sheet->relationships()->saveToXmlData());
+        else
+            QVERIFY(!paths.contains(relsPath));
+    }
+
+    device1.seek(0);
+    Document xlsx2(&device1);
+    QCOMPARE(xlsx2.sheetNames().size(), 24);
+    QVERIFY(xlsx2.selectSheet("Sheet24"));
+    QCOMPARE(xlsx2.read(500, 1).toString(), QString("item19"));
+    QCOMPARE(xlsx2.read(500, 2).toDouble(), 500 / 7.0 + 24);
+}
+
 void DocumentTest::testMoveWorksheet()
 {
     Document xlsx1;
@@ -342,6 +454,36 @@ void DocumentTest::testCopyWorksheet()
     QCOMPARE(xlsx1.read("A3").toBool(), true);
 }
 
+void DocumentTest::testCopyWorksheetSharedStrings()
+{
+    Document xlsx1;
+    xlsx1.addSheet();//Sheet1
+    xlsx1.write("A1", "String");
+    xlsx1.write("A2", "String");
+    xlsx1.write("A3", "Other");
+    SharedStrings *sst = xlsx1.workbook()->sharedStrings();
+    QCOMPARE(sst->count(), 3);
+
+    // The copy refers to the same plain strings, the table only counts them again
+    xlsx1.copySheet("Sheet1");
+    QCOMPARE(sst->count(), 6);
+    QCOMPARE(sst->getSharedStringIndex(QString("String")), 0);
+    QCOMPARE(sst->getSharedStringIndex(QString("Other")), 1);
+    QVERIFY(sst->getSharedString(2).toPlainString().isEmpty());
+
+    xlsx1.deleteSheet("Sheet1");
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+    QVERIFY(xlsx1.saveAs(&device));
+
+    device.open(QIODevice::ReadOnly);
+    Document xlsx2(&device);
+    QCOMPARE(xlsx2.sheetNames(), QStringList()<<"Sheet1(2)");
+    QCOMPARE(xlsx2.read("A1").toString(), QString("String"));
+    QCOMPARE(xlsx2.read("A2").toString(), QString("String"));
+    QCOMPARE(xlsx2.read("A3").toString(), QString("Other"));
+}
+
 void DocumentTest::testDeleteWorksheet()
 {
     Document xlsx1;
@@ -0,0 +1,178 @@
+#include "private/xlsxnumberconversion_p.h"
+#include <QString>
+#include <QtTest>
+#include <limits>
+#include <random>
+#include <string.h>
+
+using namespace QXlsx;
+
+class NumberConversionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    NumberConversionTest();
+
+private Q_SLOTS:
+    void test_formatDouble_data();
+    void test_formatDouble();
+
+    void test_parseDouble_data();
+    void test_parseDouble();
+
+    void test_roundTrip_data();
+    void test_roundTrip();
+    void test_randomRoundTrip();
+
+private:
+    static QByteArray format(double value);
+    static quint64 bits(double value);
+};
+
+NumberConversionTest::NumberConversionTest()
+{
+}
+
+QByteArray NumberConversionTest::format(double value)
+{
+    char buffer[DoubleBufferSize];
+    return QByteArray(buffer, formatDouble(value, buffer));
+}
+
+quint64 NumberConversionTest::bits(double value)
+{
+    quint64 result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+void NumberConversionTest::test_formatDouble_data()
+{
+    QTest::addColumn<double>("value");
+    QTest::addColumn<QByteArray>("text");
+
+    QTest::newRow("zero") << 0.0 << QByteArray("0");
+    QTest::newRow("negative zero") << -0.0 << QByteArray("-0");
+    QTest::newRow("integer") << 123.0 << QByteArray("123");
+    QTest::newRow("negative integer") << -42.0 << QByteArray("-42");
+    QTest::newRow("0.1") << 0.1 << QByteArray("0.1");
+    QTest::newRow("0.1 + 0.2") << 0.1 + 0.2 << QByteArray("0.30000000000000004");
+    QTest::newRow("1/3") << 1.0 / 3 << QByteArray("0.3333333333333333");
+    QTest::newRow("fraction") << -123.456 << QByteArray("-123.456");
+    QTest::newRow("small") << 0.0001 << QByteArray("0.0001");
+    QTest::newRow("smaller") << 1e-5 << QByteArray("1e-05");
+    QTest::newRow("2^53") << 9007199254740992.0 << QByteArray("9007199254740992");
+    QTest::newRow("1e16") << 1e16 << QByteArray("10000000000000000");
+    QTest::newRow("1e17") << 1e17 << QByteArray("1e+17");
+    QTest::newRow("1e20") << 1e20 << QByteArray("1e+20");
+    QTest::newRow("max") << std::numeric_limits<double>::max()
+                         << QByteArray("1.7976931348623157e+308");
+    QTest::newRow("min normal") << std::numeric_limits<double>::min()
+                                << QByteArray("2.2250738585072014e-308");
+    QTest::newRow("min subnormal") << std::numeric_limits<double>::denorm_min()
+                                   << QByteArray("5e-324");
+    QTest::newRow("inf") << std::numeric_limits<double>::infinity() << QByteArray("inf");
+    QTest::newRow("-inf") << -std::numeric_limits<double>::infinity() << QByteArray("-inf");
+    QTest::newRow("nan") << std::numeric_limits<double>::quiet_NaN() << QByteArray("nan");
+}
+
+void NumberConversionTest::test_formatDouble()
+{
+    QFETCH(double, value);
+    QFETCH(QByteArray, text);
+
+    QCOMPARE(format(value), text);
+}
+
+void NumberConversionTest::test_parseDouble_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<double>("value");
+
+    QTest::newRow("integer") << QString("123") << true << 123.0;
+    QTest::newRow("negative") << QString("-0.5") << true << -0.5;
+    QTest::newRow("plus") << QString("+.5") << true << 0.5;
+    QTest::newRow("trailing dot") << QString("5.") << true << 5.0;
+    QTest::newRow("exponent") << QString("1.5E+3") << true << 1500.0;
+    QTest::newRow("negative exponent") << QString("25e-1") << true << 2.5;
+    QTest::newRow("white space") << QString(" 12\n") << true << 12.0;
+    QTest::newRow("leading zeros") << QString("000.000125") << true << 0.000125;
+    QTest::newRow("long") << QString("0.30000000000000004") << true << 0.1 + 0.2;
+    QTest::newRow("large exponent") << QString("123e25") << true << 123e25;
+    QTest::newRow("empty") << QString() << false << 0.0;
+    QTest::newRow("text") << QString("abc") << false << 0.0;
+    QTest::newRow("missing exponent") << QString("1e") << false << 0.0;
+    QTest::newRow("two dots") << QString("1.2.3") << false << 0.0;
+    QTest::newRow("non-ascii") << QString::fromUtf8("1\xc2\xb2") << false << 0.0;
+}
+
+void NumberConversionTest::test_parseDouble()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, ok);
+    QFETCH(double, value);
+
+    double result = -1;
+    QCOMPARE(parseDouble(text.constData(), text.constData() + text.size(), &result), ok);
+    QCOMPARE(result, value);
+
+    const QByteArray utf8 = text.toUtf8();
+    result = -1;
+    QCOMPARE(parseDouble(utf8.constData(), utf8.constData() + utf8.size(), &result), ok);
+    QCOMPARE(result, value);
+}
+
+void NumberConversionTest::test_roundTrip_data()
+{
+    QTest::addColumn<double>("value");
+
+    QTest::newRow("0.1 + 0.2") << 0.1 + 0.2;
+    QTest::newRow("1/3") << 1.0 / 3;
+    QTest::newRow("2/3") << 2.0 / 3;
+    QTest::newRow("2^53 + 2") << 9007199254740994.0;
+    QTest::newRow("max") << std::numeric_limits<double>::max();
+    QTest::newRow("min normal") << std::numeric_limits<double>::min();
+    QTest::newRow("max subnormal") << 2.2250738585072009e-308;
+    QTest::newRow("min subnormal") << std::numeric_limits<double>::denorm_min();
+    QTest::newRow("epsilon") << std::numeric_limits<double>::epsilon();
+    QTest::newRow("1e23") << 1e23;
+    QTest::newRow("date") << 45123.456789012345;
+    QTest::newRow("negative zero") << -0.0;
+}
+
+void NumberConversionTest::test_roundTrip()
+{
+    QFETCH(double, value);
+
+    const QByteArray text = format(value);
+    double result = 0;
+    QVERIFY(parseDouble(text.constData(), text.constData() + text.size(), &result));
+    QCOMPARE(bits(result), bits(value));
+    // Other readers get the same value
+    QCOMPARE(bits(text.toDouble()), bits(value));
+}
+
+void NumberConversionTest::test_randomRoundTrip()
+{
+    std::mt19937_64 random(42);
+    for (int i = 0; i < 1000000; ++i) {
+        const quint64 pattern = random();
+        double value;
+        memcpy(&value, &pattern, sizeof(value));
+        if (qIsNaN(value))
+            continue;
+
+        const QByteArray text = format(value);
+        double result = 0;
+        QVERIFY2(parseDouble(text.constData(), text.constData() + text.size(), &result),
+                 text.constData());
+        QVERIFY2(bits(result) == pattern, text.constData());
+        QVERIFY2(bits(text.toDouble()) == pattern, text.constData());
+    }
+}
+
+QTEST_APPLESS_MAIN(NumberConversionTest)
+
+#include "tst_numberconversiontest.moc"
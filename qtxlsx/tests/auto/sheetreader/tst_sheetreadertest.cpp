@@ -0,0 +1,145 @@
+#include "xlsxdocument.h"
+#include "xlsxsheetreader.h"
+#include "xlsxworksheet.h"
+#include <QString>
+#include <QtTest>
+
+QTXLSX_USE_NAMESPACE
+
+class SheetReaderTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SheetReaderTest();
+
+private Q_SLOTS:
+    void testReadRows();
+    void testSelectSheet();
+    void testStreamedSheet();
+    void testInvalidDocument();
+};
+
+SheetReaderTest::SheetReaderTest()
+{
+}
+
+void SheetReaderTest::testReadRows()
+{
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+
+    Document xlsx1;
+    xlsx1.write("A1", "Hello Qt!");
+    xlsx1.write("B1", 12.5);
+    xlsx1.write("D1", true);
+    xlsx1.currentWorksheet()->writeInlineString(3, 2, "inline");
+    xlsx1.write("A3", QDate(2014, 5, 6));
+    xlsx1.write("C3", QDateTime(QDate(2014, 5, 6), QTime(7, 8, 9)));
+    xlsx1.write("A5", "=1+2");
+    xlsx1.saveAs(&device);
+
+    device.open(QIODevice::ReadOnly);
+    SheetReader reader(&device);
+    QVERIFY(reader.isValid());
+    QCOMPARE(reader.sheetNames(), QStringList() << "Sheet1");
+    QCOMPARE(reader.currentSheetName(), QString("Sheet1"));
+
+    QVERIFY(reader.readNextRow());
+    QCOMPARE(reader.row(), 1);
+    QCOMPARE(reader.columnCount(), 4);
+    QCOMPARE(reader.read(1).toString(), QString("Hello Qt!"));
+    QCOMPARE(reader.read(2).toDouble(), 12.5);
+    QVERIFY(!reader.read(3).isValid());
+    QCOMPARE(reader.read(4).toBool(), true);
+
+    // Row 2 is empty and not stored
+    QVERIFY(reader.readNextRow());
+    QCOMPARE(reader.row(), 3);
+    QCOMPARE(reader.read(1).toDate(), QDate(2014, 5, 6));
+    QCOMPARE(reader.read(2).toString(), QString("inline"));
+    QCOMPARE(reader.read(3).toDateTime(), QDateTime(QDate(2014, 5, 6), QTime(7, 8, 9)));
+
+    QVERIFY(reader.readNextRow());
+    QCOMPARE(reader.row(), 5);
+    QCOMPARE(reader.columnCount(), 1);
+
+    QVERIFY(!reader.readNextRow());
+    QVERIFY(!reader.readNextRow());
+    QVERIFY(!reader.hasError());
+}
+
+void SheetReaderTest::testSelectSheet()
+{
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+
+    Document xlsx1;
+    xlsx1.write("A1", 1);
+    xlsx1.addSheet("Second");
+    xlsx1.write("B2", "second");
+    xlsx1.saveAs(&device);
+
+    device.open(QIODevice::ReadOnly);
+    SheetReader reader(&device);
+    QCOMPARE(reader.sheetNames(), QStringList() << "Sheet1"
+                                                << "Second");
+    QVERIFY(!reader.selectSheet("Missing"));
+    QVERIFY(!reader.readNextRow());
+
+    QVERIFY(reader.selectSheet("Second"));
+    QVERIFY(reader.readNextRow());
+    QCOMPARE(reader.row(), 2);
+    QCOMPARE(reader.read(2).toString(), QString("second"));
+    QVERIFY(!reader.readNextRow());
+
+    // Selecting a sheet again starts from its first row
+    QVERIFY(reader.selectSheet("Sheet1"));
+    QVERIFY(reader.readNextRow());
+    QCOMPARE(reader.read(1).toInt(), 1);
+}
+
+void SheetReaderTest::testStreamedSheet()
+{
+    QBuffer device;
+    device.open(QIODevice::WriteOnly);
+
+    Document xlsx1;
+    Worksheet *sheet = xlsx1.currentWorksheet();
+    sheet->setStreamingEnabled(true);
+    for (int row = 1; row <= 5000; ++row) {
+        sheet->write(row, 1, QString("name%1").arg(row % 10));
+        sheet->write(row, 2, row);
+    }
+    xlsx1.saveAs(&device);
+
+    device.open(QIODevice::ReadOnly);
+    SheetReader reader(&device);
+    int rows = 0;
+    double sum = 0;
+    while (reader.readNextRow()) {
+        ++rows;
+        QCOMPARE(reader.row(), rows);
+        QCOMPARE(reader.read(1).toString(), QString("name%1").arg(rows % 10));
+        sum += reader.read(2).toDouble();
+    }
+    QVERIFY(!reader.hasError());
+    QCOMPARE(rows, 5000);
+    QCOMPARE(sum, 5000.0 * 5001 / 2);
+}
+
+void SheetReaderTest::testInvalidDocument()
+{
+    QByteArray data("not a zip file");
+    QBuffer device(&data);
+    device.open(QIODevice::ReadOnly);
+
+    SheetReader reader(&device);
+    QVERIFY(!reader.isValid());
+    QVERIFY(reader.sheetNames().isEmpty());
+    QVERIFY(!reader.readNextRow());
+}
+
+QTEST_APPLESS_MAIN(SheetReaderTest)
+
+#include "tst_sheetreadertest.moc"
@@ -1,6 +1,9 @@
 #include <QBuffer>
 #include <QtTest>
 #include <QXmlStreamReader>
+#include <QStandardItemModel>
+#include <random>
+#include <string.h>
 
 #include "xlsxworksheet.h"
 #include "xlsxcell.h"
@@ -25,12 +28,24 @@ private Q_SLOTS:
     void testSetColumn();
 
     void testWriteCells();
+    void testWriteSparseCells();
+    void testCellObjects();
+    void testWriteSpans();
+    void testWriteEscapedCells();
+    void testNumberRoundTrip();
     void testWriteHyperlinks();
+    void testWriteModel();
+    void testWriteModelRange();
     void testWriteDataValidations();
     void testMerge();
     void testUnMerge();
 
     void testReadSheetData();
+    void testReadSheetDataBytes();
+    void testReadSheetDataFallback();
+    void testReadSheetDataFallback_data();
+    void testReadSheetDataBadReference();
+    void testReadSheetDataBadReference_data();
     void testReadColsInfo();
     void testReadRowsInfo();
     void testReadMergeCells();
@@ -121,6 +136,205 @@ void WorksheetTest::testWriteCells()
     QCOMPARE(sheet.d_func()->sharedStrings()->getSharedString(0).toPlainString(), QStringLiteral("Hello"));
 }
 
+void WorksheetTest::testWriteSparseCells()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("C1", 3);
+    sheet.write("A1", 1);
+    sheet.write("XFD1", 16384); // row no longer fits a dense array
+    sheet.write("B1", 2);
+    sheet.write("B1", 22); // overwrite
+    for (int col = 1; col <= 40; ++col)
+        sheet.write(200, col, col);
+    sheet.write(200, 10000, 10000);
+
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 2);
+    QCOMPARE(sheet.cellAt("A1")->value().toInt(), 1);
+    QCOMPARE(sheet.cellAt("B1")->value().toInt(), 22);
+    QCOMPARE(sheet.cellAt("XFD1")->value().toInt(), 16384);
+    QVERIFY(!sheet.cellAt("D1"));
+    QVERIFY(!sheet.cellAt("A2"));
+    QCOMPARE(sheet.cellAt(200, 40)->value().toInt(), 40);
+    QCOMPARE(sheet.cellAt(200, 10000)->value().toInt(), 10000);
+    QVERIFY(!sheet.cellAt(200, 41));
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY(xmldata.contains("<c r=\"A1\"><v>1</v></c><c r=\"B1\"><v>22</v></c>"
+                             "<c r=\"C1\"><v>3</v></c><c r=\"XFD1\"><v>16384</v></c></row>"));
+    QVERIFY(xmldata.contains("<c r=\"AN200\"><v>40</v></c><c r=\"NTP200\"><v>10000</v></c>"));
+}
+
+void WorksheetTest::testCellObjects()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("A1", 1.5);
+    sheet.write("B1", "Hello");
+    sheet.write("C1", true);
+    sheet.writeBlank(1, 4);
+    sheet.writeInlineString(1, 5, "inline");
+
+    // Cells are kept as compact values, a Cell is created when asked for
+    QXlsx::Cell *cell = sheet.cellAt("A1");
+    QVERIFY(cell);
+    QCOMPARE(sheet.cellAt("A1"), cell);
+    QCOMPARE(cell->value(), QVariant(1.5));
+    QCOMPARE(sheet.cellAt("B1")->value(), QVariant(QStringLiteral("Hello")));
+    QCOMPARE(sheet.cellAt("C1")->value(), QVariant(true));
+    QVERIFY(!sheet.cellAt("D1")->value().isValid());
+    QCOMPARE(sheet.cellAt("E1")->cellType(), QXlsx::Cell::InlineStringType);
+    QCOMPARE(sheet.cellAt("E1")->value(), QVariant(QStringLiteral("inline")));
+
+    // The Cell follows changes made through the sheet
+    QXlsx::Format format;
+    format.setFontBold(true);
+    sheet.mergeCells("A1:B2", format);
+    QVERIFY(cell->format().fontBold());
+    QCOMPARE(sheet.read("A1"), QVariant(1.5));
+    QVERIFY(!sheet.cellAt("B1")->value().isValid());
+}
+
+void WorksheetTest::testWriteEscapedCells()
+{
+    QXlsx::Worksheet empty("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QVERIFY(empty.saveToXmlData().contains("<sheetData/>"));
+
+    const QString text = QString::fromUtf8("<a & \"b\"> \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.writeInlineString(1, 1, text);
+    sheet.write(2, 1, 0.1);
+    sheet.write(3, 1, -3);
+    sheet.write(4, 1, 1e20);
+    sheet.writeFormula(5, 1, QXlsx::CellFormula("A3&\"<\""), QXlsx::Format(), 7.5);
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY(xmldata.contains("<c r=\"A1\" t=\"inlineStr\"><is><t>&lt;a &amp; &quot;b&quot;&gt; "
+                             "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80</t></is></c>"));
+    QVERIFY(xmldata.contains("<c r=\"A2\"><v>0.1</v></c>"));
+    QVERIFY(xmldata.contains("<c r=\"A3\"><v>-3</v></c>"));
+    QVERIFY(xmldata.contains("<c r=\"A4\"><v>1e+20</v></c>"));
+    QVERIFY(xmldata.contains(
+        "<c r=\"A5\"><f ca=\"1\">A3&amp;&quot;&lt;&quot;</f><v>7.5</v></c>"));
+}
+
+void WorksheetTest::testNumberRoundTrip()
+{
+    QList<double> values;
+    values << 0.1 + 0.2 << 1.0 / 3 << -2.0 / 3 << 9007199254740993.0 << 1e23 << 5e-324
+           << 1.7976931348623157e308 << 45123.456789012345 << -0.0;
+    std::mt19937_64 random(1);
+    for (int i = 0; i < 1000; ++i) {
+        const quint64 pattern = random();
+        double value;
+        memcpy(&value, &pattern, sizeof(value));
+        if (qIsFinite(value))
+            values << value;
+    }
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    for (int i = 0; i < values.size(); ++i)
+        sheet.write(i + 1, 1, values.at(i));
+
+    QXmlStreamReader reader(sheet.saveToXmlData());
+    while (reader.readNextStartElement() && reader.name() != QLatin1String("sheetData")) {
+        if (reader.name() != QLatin1String("worksheet"))
+            reader.skipCurrentElement();
+    }
+    QXlsx::Worksheet sheet2("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    sheet2.d_func()->loadXmlSheetData(reader);
+
+    for (int i = 0; i < values.size(); ++i) {
+        const double expected = values.at(i);
+        const double loaded = sheet2.read(i + 1, 1).toDouble();
+        QVERIFY2(memcmp(&expected, &loaded, sizeof(double)) == 0,
+                 QByteArray::number(expected, 'g', 17).constData());
+    }
+}
+
+void WorksheetTest::testWriteSpans()
+{
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    sheet.write("B1", 1);
+    sheet.write("XFD3", 2);
+    sheet.write("C17", 3);
+    sheet.setRowHeight(20, 20, 30);
+    sheet.write("A21", 4);
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY(xmldata.contains("<row r=\"1\" spans=\"2:16384\">"));
+    QVERIFY(xmldata.contains("<row r=\"3\" spans=\"2:16384\">"));
+    QVERIFY(xmldata.contains("<row r=\"17\" spans=\"1:3\">"));
+    QVERIFY(xmldata.contains("<row r=\"20\" spans=\"1:3\" ht=\"30\" customHeight=\"1\"/>"));
+    QVERIFY(xmldata.contains("<row r=\"21\" spans=\"1:3\"><c r=\"A21\"><v>4</v></c></row>"));
+    QVERIFY(!xmldata.contains("<row r=\"2\""));
+}
+
+void WorksheetTest::testWriteModel()
+{
+    QStandardItemModel model(3, 4);
+    for (int row = 0; row < 3; ++row) {
+        model.setData(model.index(row, 0), QStringLiteral("file%1").arg(row));
+        model.setData(model.index(row, 1), QString::number(row * 1000));
+        model.setData(model.index(row, 2), QDateTime(QDate(2014, 1, row + 1), QTime(12, 0)));
+        model.setData(model.index(row, 3), row);
+    }
+    model.setData(model.index(1, 3), QVariant()); // left empty
+
+    QXlsx::Format numberFormat;
+    numberFormat.setNumberFormatIndex(3);
+    QList<QXlsx::Worksheet::ModelColumn> columns;
+    columns << QXlsx::Worksheet::ModelColumn(0, QXlsx::Worksheet::ModelStringValue)
+            << QXlsx::Worksheet::ModelColumn(1, QXlsx::Worksheet::ModelNumericValue, numberFormat)
+            << QXlsx::Worksheet::ModelColumn(2, QXlsx::Worksheet::ModelDateTimeValue)
+            << QXlsx::Worksheet::ModelColumn(3);
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QVERIFY(sheet.writeModel(2, 2, &model, columns));
+
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange(2, 2, 4, 5));
+    QCOMPARE(sheet.cellAt(2, 2)->cellType(), QXlsx::Cell::SharedStringType);
+    QCOMPARE(sheet.read(4, 2).toString(), QStringLiteral("file2"));
+    // The string "1000" is written as number in the numeric column
+    QCOMPARE(sheet.cellAt(3, 3)->cellType(), QXlsx::Cell::NumberType);
+    QCOMPARE(sheet.read(3, 3).toDouble(), 1000.0);
+    QCOMPARE(sheet.cellAt(3, 3)->format().numberFormatIndex(), 3);
+    QVERIFY(sheet.cellAt(2, 4)->isDateTime());
+    QCOMPARE(sheet.read(2, 4).toDateTime(), QDateTime(QDate(2014, 1, 1), QTime(12, 0)));
+    QCOMPARE(sheet.read(4, 5).toInt(), 2);
+    QVERIFY(!sheet.cellAt(3, 5));
+
+    QByteArray xmldata = sheet.saveToXmlData();
+    QVERIFY2(xmldata.contains("<c r=\"B2\" t=\"s\"><v>0</v></c>"), "string");
+    QCOMPARE(sheet.d_func()->sharedStrings()->getSharedString(1).toPlainString(), QStringLiteral("file1"));
+}
+
+void WorksheetTest::testWriteModelRange()
+{
+    QStandardItemModel model(10, 2);
+    for (int row = 0; row < 10; ++row) {
+        model.setData(model.index(row, 0), row);
+        model.setData(model.index(row, 1), row % 2 == 0);
+    }
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
+    QList<QXlsx::Worksheet::ModelColumn> columns;
+    columns << QXlsx::Worksheet::ModelColumn(1, QXlsx::Worksheet::ModelBoolValue)
+            << QXlsx::Worksheet::ModelColumn(0, QXlsx::Worksheet::ModelNumericValue);
+    QVERIFY(sheet.writeModel(1, 1, &model, columns, 4, 6));
+
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange(1, 1, 3, 2));
+    QCOMPARE(sheet.read(1, 1).toBool(), true);
+    QCOMPARE(sheet.read(2, 1).toBool(), false);
+    QCOMPARE(sheet.read(3, 2).toInt(), 6);
+
+    // Every model column when no columns are given
+    QVERIFY(sheet.writeModel(1, 4, &model));
+    QCOMPARE(sheet.read(10, 4).toInt(), 9);
+    QCOMPARE(sheet.cellAt(10, 5)->cellType(), QXlsx::Cell::BooleanType);
+
+    QVERIFY(!sheet.writeModel(1048576, 1, &model));
+    QVERIFY(!sheet.writeModel(1, 1, 0));
+}
+
 void WorksheetTest::testWriteHyperlinks()
 {
     QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_NewFromScratch);
@@ -202,7 +416,7 @@ void WorksheetTest::testReadSheetData()
     sheet.d_func()->sharedStrings()->addSharedString("Hello");
     sheet.d_func()->loadXmlSheetData(reader);
 
-    QCOMPARE(sheet.d_func()->cellTable.size(), 2);
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 2);
 
     //A1
     QCOMPARE(sheet.cellAt("A1")->cellType(), QXlsx::Cell::SharedStringType);
@@ -231,6 +445,108 @@ void WorksheetTest::testReadSheetData()
     QCOMPARE(sheet.cellAt("E3")->value().toString(), QStringLiteral("#DIV/0!"));
 }
 
+void WorksheetTest::testReadSheetDataBytes()
+{
+    const QByteArray xmlData =
+            "<row r=\"1\" spans=\"1:6\">"
+            "<c r=\"A1\" s=\"1\" t=\"s\"><v>0</v></c>"
+            "<c r=\"B1\"><f>44+33</f><v>77</v></c>"
+            "<c r=\"C1\" t=\"str\"><f ca=\"1\">44+33</f><v>77</v></c>"
+            "</row>"
+            "<row r=\"3\" spans=\"1:6\" ht=\"30.5\" customHeight=\"1\">"
+            "<c r=\"B3\" s=\"1\"><v>12345</v></c>"
+            "<c r=\"C3\" s=\"1\" t=\"inlineStr\"><is><t>a &amp; b&#x20AC;\r\nc</t></is></c>"
+            "<c r=\"D3\" t=\"b\"><v>1</v><extLst><x:ext uri=\"a&gt;b\"/></extLst></c>"
+            "<c r=\"E3\" t=\"e\"><f>1/0</f><v>#DIV/0!</v></c>"
+            "<c r=\"XFD1048576\"/>"
+            "</row>";
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    sheet.d_func()->sharedStrings()->addSharedString("Hello");
+    QVERIFY(sheet.d_func()->loadXmlSheetData(xmlData.constData(),
+                                             xmlData.constData() + xmlData.size()));
+
+    QCOMPARE(sheet.d_func()->cellTable.rowCount(), 3);
+    QCOMPARE(sheet.cellAt("A1")->value().toString(), QStringLiteral("Hello"));
+    QCOMPARE(sheet.cellAt("B1")->value().toInt(), 77);
+    QCOMPARE(sheet.cellAt("B1")->formula(), QXlsx::CellFormula("44+33"));
+    QCOMPARE(sheet.cellAt("C1")->cellType(), QXlsx::Cell::StringType);
+    QCOMPARE(sheet.d_func()->rowsInfo[3]->height, 30.5);
+    QCOMPARE(sheet.cellAt("B3")->value().toInt(), 12345);
+    QCOMPARE(sheet.cellAt("C3")->cellType(), QXlsx::Cell::InlineStringType);
+    QCOMPARE(sheet.cellAt("C3")->value().toString(), QString::fromUtf8("a & b\xe2\x82\xac\nc"));
+    QCOMPARE(sheet.cellAt("D3")->value().toBool(), true);
+    QCOMPARE(sheet.cellAt("E3")->value().toString(), QStringLiteral("#DIV/0!"));
+    QVERIFY(sheet.cellAt("XFD1048576"));
+    QVERIFY(sheet.saveToXmlData().contains("<c r=\"C1\" t=\"str\"><f ca=\"1\">44+33</f>"));
+
+    // Anything the tokenizer does not know leaves nothing behind
+    const QByteArray withComment = "<row r=\"1\"><c r=\"A1\"><v>1</v></c></row><!-- -->";
+    QXlsx::Worksheet sheet2("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    QVERIFY(!sheet2.d_func()->loadXmlSheetData(withComment.constData(),
+                                               withComment.constData() + withComment.size()));
+    QCOMPARE(sheet2.d_func()->cellTable.rowCount(), 0);
+}
+
+void WorksheetTest::testReadSheetDataFallback()
+{
+    QFETCH(QByteArray, xmlData);
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    QVERIFY(sheet.loadFromXmlData(xmlData));
+    QCOMPARE(sheet.read("A1").toInt(), 1);
+    QCOMPARE(sheet.read("B2").toString(), QStringLiteral("x<y"));
+    QCOMPARE(sheet.dimension().lastRow(), 2);
+}
+
+void WorksheetTest::testReadSheetDataFallback_data()
+{
+    QTest::addColumn<QByteArray>("xmlData");
+
+    const QByteArray ns =
+            "xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"";
+    const QByteArray cells = "<row r=\"1\"><c r=\"A1\"><v>1</v></c></row>"
+                             "<row r=\"2\"><c r=\"B2\" t=\"inlineStr\"><is><t>x&lt;y</t></is>"
+                             "</c></row>";
+    QTest::newRow("plain") << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
+                              "<worksheet " + ns + "><dimension ref=\"A1:B2\"/><sheetData>" + cells
+                              + "</sheetData></worksheet>";
+    QTest::newRow("comment") << "<worksheet " + ns + "><dimension ref=\"A1:B2\"/><sheetData>"
+                                "<!-- cells -->" + cells + "</sheetData></worksheet>";
+    QTest::newRow("prefix") << "<x:worksheet xmlns:x=\"http://schemas.openxmlformats.org/"
+                               "spreadsheetml/2006/main\"><x:dimension ref=\"A1:B2\"/>"
+                               "<x:sheetData>" + QByteArray(cells).replace("<", "<x:")
+                               .replace("<x:/", "</x:") + "</x:sheetData></x:worksheet>";
+}
+
+void WorksheetTest::testReadSheetDataBadReference()
+{
+    QFETCH(QByteArray, cell);
+
+    const QByteArray xmlData = "<worksheet xmlns=\"http://schemas.openxmlformats.org/"
+                               "spreadsheetml/2006/main\"><sheetData>"
+                               "<row r=\"1\"><c r=\"A1\"><v>1</v></c>" + cell + "</row>"
+                               "</sheetData></worksheet>";
+
+    QXlsx::Worksheet sheet("", 1, 0, QXlsx::Worksheet::F_LoadFromExists);
+    QVERIFY(sheet.loadFromXmlData(xmlData));
+    QCOMPARE(sheet.read("A1").toInt(), 1);
+    QCOMPARE(sheet.dimension(), QXlsx::CellRange("A1:A1"));
+}
+
+void WorksheetTest::testReadSheetDataBadReference_data()
+{
+    QTest::addColumn<QByteArray>("cell");
+
+    QTest::newRow("no r") << QByteArray("<c><v>2</v></c>");
+    QTest::newRow("empty r") << QByteArray("<c r=\"\"><v>2</v></c>");
+    QTest::newRow("garbage r") << QByteArray("<c r=\"1B\"><v>2</v></c>");
+    QTest::newRow("row 0") << QByteArray("<c r=\"B0\"><v>2</v></c>");
+    QTest::newRow("row too large") << QByteArray("<c r=\"B1048577\"><v>2</v></c>");
+    QTest::newRow("column too large") << QByteArray("<c r=\"XFE1\"><v>2</v></c>");
+    QTest::newRow("shared string") << QByteArray("<c t=\"s\"><v>0</v></c>");
+}
+
 void WorksheetTest::testReadColsInfo()
 {
     const QByteArray xmlData = "<cols>"
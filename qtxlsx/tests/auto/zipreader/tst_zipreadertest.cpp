@@ -1,4 +1,5 @@
 #include "private/xlsxzipreader_p.h"
+#include "private/xlsxzipwriter_p.h"
 #include <QString>
 #include <QtTest>
 #include <QBuffer>
@@ -14,6 +15,8 @@ public:
     
 private Q_SLOTS:
     void testFileList();
+    void testOpenFile();
+    void testOpenDeflatedFile();
 };
 
 ZipReaderTest::ZipReaderTest()
@@ -35,6 +38,60 @@ void ZipReaderTest::testFileList()
     QCOMPARE(reader.fileData("qt/xlsx.txt"), QByteArray("Xlsx"));
 }
 
+void ZipReaderTest::testOpenFile()
+{
+    QByteArray data(fileContent, sizeof(fileContent) - 1);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QXlsx::ZipReader reader(&buffer);
+    QScopedPointer<QIODevice> hello(reader.openFile("hello.txt"));
+    QScopedPointer<QIODevice> xlsx(reader.openFile("qt/xlsx.txt"));
+    QVERIFY(hello);
+    QVERIFY(xlsx);
+    QVERIFY(!reader.openFile("missing.txt"));
+    // Both entries can be read at the same time
+    QCOMPARE(hello->read(2), QByteArray("He"));
+    QCOMPARE(xlsx->readAll(), QByteArray("Xlsx"));
+    QCOMPARE(hello->readAll(), QByteArray("llo"));
+}
+
+void ZipReaderTest::testOpenDeflatedFile()
+{
+    QByteArray content;
+    for (int i = 0; i < 100000; ++i)
+        content.append(QByteArray::number(i * 7)).append(' ');
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    {
+        QXlsx::ZipWriter writer(&buffer);
+        writer.addFile("small.txt", QByteArray("Xlsx"));
+        QXlsx::DeflateStream stream;
+        QVERIFY(stream.open());
+        stream.write(content.left(1000));
+        stream.write(content.mid(1000));
+        writer.addDeflatedFile("big.txt", &stream);
+        writer.close();
+        QVERIFY(!writer.error());
+    }
+
+    buffer.close();
+    buffer.open(QIODevice::ReadOnly);
+    QXlsx::ZipReader reader(&buffer);
+    QCOMPARE(reader.fileData("big.txt"), content);
+    QScopedPointer<QIODevice> big(reader.openFile("big.txt"));
+    QVERIFY(big);
+    QByteArray streamed;
+    while (!big->atEnd()) {
+        const QByteArray chunk = big->read(4096);
+        if (chunk.isEmpty())
+            break;
+        streamed.append(chunk);
+    }
+    QCOMPARE(streamed, content);
+}
+
 QTEST_APPLESS_MAIN(ZipReaderTest)
 
 #include "tst_zipreadertest.moc"
@@ -1,3 +1,6 @@
 TEMPLATE = subdirs
 SUBDIRS += \
-    xmlspace
+    xmlspace \
+    celltable \
+    numberconversion \
+    cellreference
@@ -0,0 +1,123 @@
+#include <QtTest>
+#include <QVector>
+#include <QStringList>
+#include <random>
+
+#include "xlsxcellreference.h"
+#include "private/xlsxcellreference_p.h"
+
+using namespace QXlsx;
+
+class CellReferenceTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CellReferenceTest();
+
+private Q_SLOTS:
+    void testParse();
+    void testParse_data();
+    void testFormat();
+    void testFormat_data();
+
+private:
+    static QVector<CellReference> references();
+};
+
+CellReferenceTest::CellReferenceTest()
+{
+}
+
+/*
+ * 100000 cells of a sheet with 50 columns, in random order.
+ */
+QVector<CellReference> CellReferenceTest::references()
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> row(1, 2000);
+    std::uniform_int_distribution<int> column(1, 50);
+    QVector<CellReference> cells;
+    cells.reserve(100000);
+    for (int i = 0; i < 100000; ++i)
+        cells.append(CellReference(row(random), column(random)));
+    return cells;
+}
+
+void CellReferenceTest::testParse()
+{
+    QFETCH(bool, qt);
+
+    const QVector<CellReference> cells = references();
+    QStringList strings;
+    QList<QByteArray> bytes;
+    for (int i = 0; i < cells.size(); ++i) {
+        strings.append(cells.at(i).toString());
+        bytes.append(strings.last().toLatin1());
+    }
+
+    qint64 sum = 0;
+    if (qt) {
+        QBENCHMARK {
+            sum = 0;
+            for (int i = 0; i < strings.size(); ++i)
+                sum += CellReference(strings.at(i)).column();
+        }
+    } else {
+        QBENCHMARK {
+            sum = 0;
+            for (int i = 0; i < bytes.size(); ++i) {
+                int row;
+                int column;
+                const QByteArray &cell = bytes.at(i);
+                parseCellReference(cell.constData(), cell.constData() + cell.size(), &row,
+                                   &column);
+                sum += column;
+            }
+        }
+    }
+    QVERIFY(sum > cells.size());
+}
+
+void CellReferenceTest::testParse_data()
+{
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("CellReference(QString)") << true;
+    QTest::newRow("parseCellReference") << false;
+}
+
+void CellReferenceTest::testFormat()
+{
+    QFETCH(bool, qt);
+
+    const QVector<CellReference> cells = references();
+    qint64 size = 0;
+    if (qt) {
+        QBENCHMARK {
+            size = 0;
+            for (int i = 0; i < cells.size(); ++i)
+                size += cells.at(i).toString().size();
+        }
+    } else {
+        QBENCHMARK {
+            size = 0;
+            char buffer[CellReferenceBufferSize];
+            for (int i = 0; i < cells.size(); ++i)
+                size += formatCellReference(cells.at(i).row(), cells.at(i).column(), buffer);
+        }
+    }
+    QVERIFY(size > cells.size());
+}
+
+void CellReferenceTest::testFormat_data()
+{
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("toString") << true;
+    QTest::newRow("formatCellReference") << false;
+}
+
+QTEST_APPLESS_MAIN(CellReferenceTest)
+
+#include "tst_cellreferencetest.moc"
@@ -0,0 +1,13 @@
+QT       += testlib xlsx
+CONFIG += testcase
+DEFINES += XLSX_TEST
+
+TARGET = tst_celltabletest
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += tst_celltabletest.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
@@ -0,0 +1,182 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+#include <random>
+
+#include "xlsxdocument.h"
+#include "xlsxworksheet.h"
+
+class CellTableTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    CellTableTest();
+
+private Q_SLOTS:
+    void testRandomWrites();
+    void testRandomWrites_data();
+    void testRowOrderWrites();
+    void testRowOrderWrites_data();
+    void testFullScan();
+    void testFullScan_data();
+    void testSaveXml();
+    void testSaveXml_data();
+    void testLoadXml();
+    void testLoadXml_data();
+
+private:
+    void addSizes();
+};
+
+CellTableTest::CellTableTest()
+{
+}
+
+void CellTableTest::addSizes()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<int>("columns");
+
+    QTest::newRow("10000x10") << 10000 << 10;
+    QTest::newRow("1000x100") << 1000 << 100;
+    QTest::newRow("100000x2") << 100000 << 2;
+}
+
+void CellTableTest::testRandomWrites()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    QVector<QPair<int, int>> positions;
+    positions.reserve(rows * columns);
+    for (int row = 1; row <= rows; ++row) {
+        for (int col = 1; col <= columns; ++col)
+            positions.append(qMakePair(row, col));
+    }
+    std::shuffle(positions.begin(), positions.end(), std::mt19937(42));
+
+    QBENCHMARK {
+        QXlsx::Document xlsx;
+        QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+        for (int i = 0; i < positions.size(); ++i)
+            sheet->write(positions.at(i).first, positions.at(i).second, i);
+    }
+}
+
+void CellTableTest::testRandomWrites_data()
+{
+    addSizes();
+}
+
+void CellTableTest::testRowOrderWrites()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    QBENCHMARK {
+        QXlsx::Document xlsx;
+        QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= columns; ++col)
+                sheet->write(row, col, row + col);
+        }
+    }
+}
+
+void CellTableTest::testRowOrderWrites_data()
+{
+    addSizes();
+}
+
+void CellTableTest::testFullScan()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    for (int row = 1; row <= rows; ++row) {
+        for (int col = 1; col <= columns; ++col)
+            sheet->write(row, col, row + col);
+    }
+
+    double sum = 0;
+    QBENCHMARK {
+        sum = 0;
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= columns; ++col) {
+                sum += sheet->read(row, col).toDouble();
+            }
+        }
+    }
+    QVERIFY(sum > 0);
+}
+
+void CellTableTest::testFullScan_data()
+{
+    addSizes();
+}
+
+void CellTableTest::testSaveXml()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    QXlsx::Document xlsx;
+    QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+    for (int row = 1; row <= rows; ++row) {
+        for (int col = 1; col <= columns; ++col)
+            sheet->write(row, col, (col & 1) ? double(row * col) : row / 7.0 + col);
+    }
+
+    int size = 0;
+    QBENCHMARK {
+        size = sheet->saveToXmlData().size();
+    }
+    QVERIFY(size > rows * columns);
+}
+
+void CellTableTest::testSaveXml_data()
+{
+    addSizes();
+}
+
+void CellTableTest::testLoadXml()
+{
+    QFETCH(int, rows);
+    QFETCH(int, columns);
+
+    QByteArray data;
+    {
+        QXlsx::Document xlsx;
+        QXlsx::Worksheet *sheet = xlsx.currentWorksheet();
+        for (int row = 1; row <= rows; ++row) {
+            for (int col = 1; col <= columns; ++col)
+                sheet->write(row, col, (col & 1) ? double(row * col) : row / 7.0 + col);
+        }
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(xlsx.saveAs(&buffer));
+    }
+
+    double value = 0;
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QXlsx::Document xlsx(&buffer);
+        value = xlsx.read(rows, columns).toDouble();
+    }
+    QVERIFY(value > 0);
+}
+
+void CellTableTest::testLoadXml_data()
+{
+    addSizes();
+}
+
+QTEST_APPLESS_MAIN(CellTableTest)
+
+#include "tst_celltabletest.moc"
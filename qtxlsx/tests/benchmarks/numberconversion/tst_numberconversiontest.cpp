@@ -0,0 +1,128 @@
+#include <QtTest>
+#include <QVector>
+#include <random>
+#include <math.h>
+
+#include "private/xlsxnumberconversion_p.h"
+
+using namespace QXlsx;
+
+class NumberConversionTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    NumberConversionTest();
+
+private Q_SLOTS:
+    void testFormat();
+    void testFormat_data();
+    void testParse();
+    void testParse_data();
+
+private:
+    void addColumns();
+    static QVector<double> column(const QString &kind);
+};
+
+NumberConversionTest::NumberConversionTest()
+{
+}
+
+/*
+ * One numeric column of 100000 cells: whole numbers, prices with two
+ * decimals, or results of computations that need all 17 digits.
+ */
+QVector<double> NumberConversionTest::column(const QString &kind)
+{
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+    QVector<double> values;
+    values.reserve(100000);
+    for (int i = 0; i < 100000; ++i) {
+        const double value = distribution(random);
+        if (kind == QLatin1String("integers"))
+            values.append(floor(value));
+        else if (kind == QLatin1String("prices"))
+            values.append(floor(value * 100) / 100);
+        else
+            values.append(value);
+    }
+    return values;
+}
+
+void NumberConversionTest::addColumns()
+{
+    QTest::addColumn<QString>("kind");
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("integers, QString") << "integers" << true;
+    QTest::newRow("integers, shortest") << "integers" << false;
+    QTest::newRow("prices, QString") << "prices" << true;
+    QTest::newRow("prices, shortest") << "prices" << false;
+    QTest::newRow("measurements, QString") << "measurements" << true;
+    QTest::newRow("measurements, shortest") << "measurements" << false;
+}
+
+void NumberConversionTest::testFormat()
+{
+    QFETCH(QString, kind);
+    QFETCH(bool, qt);
+
+    const QVector<double> values = column(kind);
+    int size = 0;
+    QBENCHMARK {
+        size = 0;
+        char buffer[DoubleBufferSize];
+        for (int i = 0; i < values.size(); ++i) {
+            if (qt)
+                size += QString::number(values.at(i), 'g', 15).toUtf8().size();
+            else
+                size += formatDouble(values.at(i), buffer);
+        }
+    }
+    QVERIFY(size > 0);
+}
+
+void NumberConversionTest::testFormat_data()
+{
+    addColumns();
+}
+
+void NumberConversionTest::testParse()
+{
+    QFETCH(QString, kind);
+    QFETCH(bool, qt);
+
+    const QVector<double> values = column(kind);
+    QVector<QString> texts;
+    texts.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        char buffer[DoubleBufferSize];
+        texts.append(QString::fromLatin1(buffer, formatDouble(values.at(i), buffer)));
+    }
+
+    double sum = 0;
+    QBENCHMARK {
+        sum = 0;
+        for (int i = 0; i < texts.size(); ++i) {
+            const QString &text = texts.at(i);
+            double value;
+            if (qt)
+                value = text.toDouble();
+            else
+                parseDouble(text.constData(), text.constData() + text.size(), &value);
+            sum += value;
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void NumberConversionTest::testParse_data()
+{
+    addColumns();
+}
+
+QTEST_APPLESS_MAIN(NumberConversionTest)
+
+#include "tst_numberconversiontest.moc"